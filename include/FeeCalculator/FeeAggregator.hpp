@@ -0,0 +1,91 @@
+/*
+Cross-shard fee volume.
+
+Each engine shard owns a FeeCalculator and charges fees from it alone. Volume a shard
+accrues is also kept as unmerged per user, with the day it traded on. Merging never
+runs on the fill path: the shard's event loop calls maybe_merge between events and on
+a timed wake when its queue is quiet, so an idle shard still hands its volume over
+within max_staleness_ns. A merge takes the aggregator's mutex, books the unmerged
+volume into the global windows on the day it traded, publishes a new TierSnapshot and
+adopts it. Between merges a shard tiers each user on snapshot volume plus its own
+unmerged volume, so fee lookup stays thread-local and lock-free.
+
+A snapshot is a table of fixed-size chunks. Publishing copies the table of chunk
+pointers and only the chunks holding changed entries; the rest are shared with the
+previous snapshot. Readers hold a snapshot by shared_ptr, and a chunk is freed when
+the last snapshot holding it goes.
+
+Invariants:
+1. The published snapshot includes every merged volume; a shard's volume is in it or
+   still unmerged in that shard, never both and never neither.
+2. Snapshot epochs increase by one per publish.
+3. Another shard's fills reach a shard's tiers within two merge intervals, once the
+   other shard merges and this one next merges; timed wakes keep this true for idle
+   shards.
+4. touched[d % kWindowDays] lists every global window with volume on day d of the
+   current window. When a day leaves the window only those windows are rolled and
+   republished; the others have nothing to expire and roll lazily when next touched.
+*/
+
+#ifndef FEE_AGGREGATOR_HPP
+#define FEE_AGGREGATOR_HPP
+
+#include "FeeCalculator/FeeCalculator.hpp"
+#include<array>
+#include<atomic>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<unordered_map>
+#include<vector>
+
+namespace MatchEngine{
+
+struct FeeAggregator{
+    static constexpr uint64_t kDefaultStalenessNs = 100'000'000;   // 100 ms
+
+    uint64_t max_staleness_ns;
+
+    explicit FeeAggregator(uint64_t staleness_ns = kDefaultStalenessNs);
+
+    // Start tiering shard on global volume. Call from the shard's thread before it trades
+    void attach(FeeCalculator& shard);
+
+    // Shard thread, between events and on idle wakes: merge once the shard's view is
+    // max_staleness_ns old. With nothing to hand over, only adopts the latest snapshot
+    void maybe_merge(FeeCalculator& shard, uint64_t now_ns) {
+        if(now_ns < shard.last_merge_ns + max_staleness_ns) return;
+        if(!shard.dirty.empty()) {
+            merge(shard, now_ns);
+            return;
+        }
+        shard.tier_snapshot = current.load();
+        shard.last_merge_ns = now_ns;
+    }
+    // Shard thread: hand over unmerged volume, publish, adopt the new snapshot
+    void merge(FeeCalculator& shard, uint64_t now_ns);
+
+    std::shared_ptr<const TierSnapshot> snapshot() const { return current.load(); }
+
+    // Global window volume by name as of the last snapshot; 0 if never merged
+    uint64_t volume_of(const std::string& user_id) const;
+
+private:
+    mutable std::mutex mutex;                   // merges and lookups; never on the fill path
+    std::unordered_map<std::string, UserIndex> ids;
+    std::vector<VolumeWindow> windows;          // by global index
+    std::array<std::vector<UserIndex>, kWindowDays> touched;   // by day % kWindowDays
+    std::vector<UserIndex> changed;             // global indices to republish
+    uint32_t today = 0;
+    uint64_t epoch = 0;
+    std::atomic<std::shared_ptr<const TierSnapshot>> current;
+
+    UserIndex global_index(FeeCalculator& shard, UserIndex user);
+    void advance(uint32_t day);
+    void add(UserIndex global, uint32_t day, uint64_t notional);
+    void publish();
+};
+
+}// namespace MatchEngine
+
+#endif// FEE_AGGREGATOR_HPP
@@ -1,38 +1,207 @@
+/*
+Invariants:
+1. Money on the fee path is integer. Notional is ledger ticks × lots (price / tick_size,
+   rounded); a fee is notional × basis points, in fee units of tick_size / 10000.
+2. users[id].accrued_fees sums every fee unit charged to id; total_fees sums them all,
+   so the ledger reconciles exactly against Trade::maker_fee_units / taker_fee_units.
+3. Both sides are priced per fill on the same basis: the fill's volume is added first,
+   then the fee is charged at the resulting tier. A maker accrues per fill; a taker's
+   volume and fees build up in its TakerSweep and are committed once, when the sweep ends.
+4. Self-trades (maker == taker) pay fees but add no volume.
+5. rolling_volume is the sum of the user's daily buckets for the last kWindowDays days,
+   as of state.day. A state is rolled forward to today, and its tier re-evaluated in both
+   directions, only when the user is next touched; inactive users cost nothing.
+6. With a tier_snapshot attached (see FeeAggregator), a tier is chosen on the global
+   volume in the snapshot plus the user's unmerged local volume; every user with
+   unmerged > 0 is listed once in dirty. Without one, on rolling_volume alone.
+7. Unmerged volume keeps the day it traded on: when the day turns, what each dirty user
+   traded on the closing day is queued in carried (and counted in queued), so
+   unmerged - queued is always volume of today.
+*/
+
 #ifndef FEE_CALCULATOR_HPP
 #define FEE_CALCULATOR_HPP
 
+#include "utils/Types.hpp"
 #include<vector>
 #include<string>
 #include<unordered_map>
+#include<array>
 #include<cstdint>
+#include<cmath>
+#include<memory>
 
 namespace MatchEngine{
 
 struct FeeTier {
-    double min_volume;
-    double maker_fee_rate;
-    double taker_fee_rate;
+    uint64_t min_volume;    // ledger ticks × lots
+    int32_t maker_bps;      // negative = rebate
+    int32_t taker_bps;
 };
 
-struct UserFeeState {
-    double rolling_volume = 0.0;
+inline constexpr uint32_t kWindowDays = 30;
+inline constexpr uint64_t kDayNs = 86'400'000'000'000ULL;
+
+// Volume over the last kWindowDays days in a ring of daily buckets
+struct VolumeWindow {
+    uint64_t rolling_volume = 0;    // ledger ticks × lots, sum of buckets
+    uint32_t day = 0;               // day the buckets were last rolled to
+    std::array<uint64_t, kWindowDays> buckets{};    // volume by day % kWindowDays
+
+    // Expire buckets older than the window ending at today. O(kWindowDays) worst case
+    void roll(uint32_t today) {
+        if(today <= day) return;
+        if(today - day >= kWindowDays) {
+            buckets.fill(0);
+            rolling_volume = 0;
+        }
+        else {
+            for(uint32_t d = day + 1; d <= today; ++d) {
+                uint64_t& bucket = buckets[d % kWindowDays];
+                rolling_volume -= bucket;
+                bucket = 0;
+            }
+        }
+        day = today;
+    }
+
+    // Caller has rolled to today
+    void add(uint64_t notional) {
+        buckets[day % kWindowDays] += notional;
+        rolling_volume += notional;
+    }
+};
+
+struct UserFeeState : VolumeWindow {
+    int64_t accrued_fees = 0;       // fee units
     size_t tier_index = 0;
+    uint64_t unmerged = 0;          // volume not yet handed to the aggregator
+    uint64_t queued = 0;            // part of unmerged queued in carried, from earlier days
+    UserIndex global_index = kNoUser;   // index in the aggregator's snapshot
+    uint64_t epoch = 0;             // snapshot epoch tier_index was computed under
+};
+
+// Unmerged volume from a day before today, still to be handed to the aggregator
+struct PendingVolume {
+    UserIndex user;
+    uint32_t day;
+    uint64_t volume;
+};
+
+// Global window volume per participant, published by FeeAggregator. Immutable; a new
+// snapshot shares every chunk it does not change with the one before
+struct TierSnapshot {
+    static constexpr size_t kChunk = 1024;
+    using Chunk = std::array<uint64_t, kChunk>;
+
+    uint64_t epoch = 0;
+    uint32_t day = 0;
+    std::vector<std::shared_ptr<const Chunk>> chunks;   // volume by global index, kChunk each
+
+    uint64_t volume(UserIndex global) const {
+        size_t chunk = global / kChunk;
+        return chunk < chunks.size() ? (*chunks[chunk])[global % kChunk] : 0;
+    }
+};
+
+// Aggressor accrual for one matching sweep: promoted fill by fill like a maker, committed once
+struct TakerSweep {
+    UserIndex user;
+    const std::vector<FeeTier>* tiers;
+    size_t tier_index;
+    uint64_t base_volume;           // tier volume when the sweep began
+    uint64_t volume = 0;
+    int64_t fees = 0;
+
+    int64_t charge(uint64_t notional, bool counts_volume) {
+        if(counts_volume) {
+            volume += notional;
+            while(tier_index + 1 < tiers->size() && base_volume + volume >= (*tiers)[tier_index + 1].min_volume) {
+                ++tier_index;
+            }
+        }
+        int64_t fee = static_cast<int64_t>(notional) * (*tiers)[tier_index].taker_bps;
+        fees += fee;
+        return fee;
+    }
 };
 
 struct FeeCalculator{
+    static constexpr int64_t kBpsDenominator = 10000;
+
+    double tick_size;                   // ledger price grid
     std::vector<FeeTier> tiers;
-    std::unordered_map<std::string, UserFeeState> users;
 
-    FeeCalculator();
+    // Fee state per participant, indexed by the dense id from intern()
+    std::vector<UserFeeState> users;
+    int64_t total_fees = 0;             // fee units across all participants
+    uint32_t today = 0;                 // ledger day: UTC days since the epoch
+
+    // Set by FeeAggregator; null when this calculator is the only one
+    std::shared_ptr<const TierSnapshot> tier_snapshot;
+    std::vector<UserIndex> dirty;       // users with unmerged volume
+    std::vector<PendingVolume> carried; // unmerged volume of earlier days
+    std::vector<std::string> names;     // by UserIndex, for merging
+    uint64_t last_merge_ns = 0;
+
+    explicit FeeCalculator(double tick = 0.01);
+
+    // Dense id for user_id, assigned on first sight. Hashed once per order at entry;
+    // the matching path then works on ids only
+    UserIndex intern(const std::string& user_id);
+    // kNoUser if user_id was never interned
+    UserIndex find(const std::string& user_id) const;
+
+    uint64_t notional(double price, uint64_t qty) const {
+        return static_cast<uint64_t>(std::llround(price / tick_size)) * qty;
+    }
+    double to_currency(int64_t fee_units) const {
+        return static_cast<double>(fee_units) * tick_size / kBpsDenominator;
+    }
+
+    // Move the ledger day forward to the UTC day of wall_ns (wall clock, not engine time,
+    // so days turn at midnight and survive a restart); earlier times are ignored
+    void advance_to(uint64_t wall_ns) {
+        uint32_t day = static_cast<uint32_t>(wall_ns / kDayNs);
+        if(day <= today) return;
+        if(!dirty.empty()) carry_pending();
+        today = day;
+    }
+
+    // Roll user's window to today: expire stale buckets and re-tier. O(kWindowDays) worst case
+    void refresh(UserIndex user);
+
+    // Maker fill: add volume (unless a self-trade), then charge at the resulting tier.
+    // Returns the fee in fee units
+    int64_t accrue_maker(UserIndex maker, uint64_t notional, bool counts_volume);
+
+    TakerSweep begin_sweep(UserIndex taker) {
+        refresh(taker);
+        return TakerSweep{taker, &tiers, users[taker].tier_index, tier_volume(users[taker])};
+    }
+    void commit(const TakerSweep& sweep);
+
+    void update_volume(UserIndex user, uint64_t notional);
 
-    double maker_fee(const std::string& user_id,double price, uint64_t qty) const;
-    double taker_fee(const std::string& user_id,double price, uint64_t qty) const;
+    // Tier as of the user's last refresh
+    const FeeTier& tier_for(UserIndex user) const{
+        return tiers[users[user].tier_index];
+    }
 
+    // By name, for callers off the matching path; refreshes the user, and unknown users
+    // get the base tier. Fees and notional are in currency (notional = price × quantity)
+    double maker_fee(const std::string& user_id,double price, uint64_t qty);
+    double taker_fee(const std::string& user_id,double price, uint64_t qty);
     void update_volume(const std::string& user_id, double notional);
+    const FeeTier& tier_for(const std::string& user_id);
 
-    const FeeTier& tier_for(const std::string& user_id) const;
+private:
+    std::unordered_map<std::string, UserIndex> ids;
 
-    
+    void add_volume(UserIndex user, uint64_t notional);
+    void carry_pending();
+    void retier(UserFeeState& state) const;
+    uint64_t tier_volume(const UserFeeState& state) const;
 };
 
 }// namespace MatchEngine
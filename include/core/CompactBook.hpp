@@ -0,0 +1,170 @@
+/*
+Compact storage mode for one instrument's resting book.
+
+Orders and levels live in two pool-backed arrays and link to each other by 32-bit
+indices instead of pointers. Prices are integer ticks and quantities use the Qty type
+sized to the instrument (uint32_t for most equities, uint64_t when lots can exceed 4e9).
+Order IDs and user strings stay outside: callers keep their own id → Index map and a
+dense owner number (e.g. an interned user index).
+
+Invariants:
+1. Every link is an Index into orders / levels, kNil for none. Nothing stores a pointer,
+   so a CompactBook can be copied, relocated or mapped without fixups.
+2. Levels of one side form a best → worst list (better/worse); SideBook::best is the head.
+3. Orders at a level form a FIFO list (head = oldest); level.total == sum of remaining.
+4. A free order slot has level == kNil and chains through next; a free level chains
+   through worse. Freed slots are reused, so an Index is only valid while the order rests.
+5. SideBook::ladder[t - base] is the level at tick t or kNil; empty levels are freed.
+   Bit t - base of SideBook::occupied is set exactly when that slot holds a level.
+6. The ladder spans at most kMaxTicks. A level outside it is in SideBook::far instead,
+   each level in exactly one of the two; window_levels counts those in the ladder.
+*/
+
+#ifndef COMPACT_BOOK_HPP
+#define COMPACT_BOOK_HPP //CompactBook.hpp
+
+#include "utils/Types.hpp"
+#include<bit>
+#include<cassert>
+#include<cstddef>
+#include<cstdint>
+#include<map>
+#include<vector>
+
+namespace MatchEngine{
+
+template<class Qty>
+struct CompactBook{
+    using Index=uint32_t;
+    static constexpr Index kNil=~Index{0};
+    static constexpr size_t kMaxTicks=size_t{1}<<20;   // 4 MB of ladder per side at most
+
+    struct OrderSlot{
+        Index next=kNil;
+        Index prev=kNil;
+        Index level=kNil;
+        uint32_t owner=0;
+        Qty remaining=0;
+    };
+
+    struct LevelSlot{
+        int64_t tick=0;
+        Qty total=0;
+        uint32_t count=0;
+        Index head=kNil;
+        Index tail=kNil;
+        Index better=kNil;
+        Index worse=kNil;
+        Side side=Side::BUY;
+    };
+
+    struct SideBook{
+        int64_t base=0;                  // tick of ladder[0]
+        std::vector<Index> ladder;       // tick → level
+        std::vector<uint64_t> occupied;  // one bit per ladder slot holding a level
+        std::map<int64_t, Index> far;    // tick → level, outside the ladder
+        size_t window_levels=0;
+        Index best=kNil;
+        Index worst=kNil;
+    };
+
+    std::vector<OrderSlot> orders;
+    std::vector<LevelSlot> levels;
+    SideBook sides[2];                   // indexed by Side
+
+    // Rest qty at tick on side; returns the order's Index
+    Index add(Side side, int64_t tick, Qty qty, uint32_t owner);
+
+    // false if order is not resting
+    bool cancel(Index order);
+
+    // Reduce a resting order in place, keeping its queue position; qty < remaining
+    void reduce(Index order, Qty qty);
+
+    // Sweep the side opposite taker_side best first, FIFO within a level, while the level
+    // crosses limit_tick (ignored when !price_limited). Calls on_fill(order, owner, tick, qty)
+    // for each fill; fully filled orders are freed after the callback. Returns quantity filled.
+    template<class F>
+    Qty match(Side taker_side, int64_t limit_tick, bool price_limited, Qty qty, F&& on_fill);
+
+    // false if the side is empty
+    bool best_tick(Side side, int64_t& tick) const;
+    Qty quantity_at(Side side, int64_t tick) const;
+    Qty remaining(Index order) const{ return orders[order].remaining; }
+    bool is_resting(Index order) const{ return order<orders.size() && orders[order].level!=kNil; }
+
+    size_t order_count() const{ return live_orders; }
+    size_t level_count() const{ return live_levels; }
+    // Bytes held by the pools and ladders (capacity, not just live entries) plus far entries
+    size_t bytes_reserved() const;
+
+private:
+    Index free_order=kNil;
+    Index free_level=kNil;
+    size_t live_orders=0;
+    size_t live_levels=0;
+
+    static SideBook& side_of(CompactBook& b, Side s){ return b.sides[s==Side::BUY ? 0 : 1]; }
+    static bool better_tick(Side side, int64_t a, int64_t b){
+        return side==Side::BUY ? a>b : a<b;
+    }
+
+    Index level_at(const SideBook& sb, int64_t tick) const;
+    Index open_level(Side side, int64_t tick);
+    void close_level(Side side, Index level);
+    void unlink_order(Index order);
+    void free_order_slot(Index order);
+    static bool in_window(const SideBook& sb, int64_t tick){
+        return tick>=sb.base && tick-sb.base<static_cast<int64_t>(sb.ladder.size());
+    }
+    Index better_neighbour(Side side, const SideBook& sb, int64_t tick) const;
+    // Nearest occupied ladder slot strictly above / below slot i, or kNoSlot; 64 slots per word
+    static constexpr size_t kNoSlot=~size_t{0};
+    static size_t scan_up(const SideBook& sb, size_t i);
+    static size_t scan_down(const SideBook& sb, size_t i);
+    static void mark(SideBook& sb, size_t i, bool on){
+        if(on) sb.occupied[i>>6]|=uint64_t{1}<<(i&63);
+        else sb.occupied[i>>6]&=~(uint64_t{1}<<(i&63));
+    }
+    // false: tick stays outside the ladder, in far
+    bool ensure_range(SideBook& sb, int64_t tick);
+    void absorb_far(SideBook& sb);
+};
+
+template<class Qty>
+template<class F>
+Qty CompactBook<Qty>::match(Side taker_side, int64_t limit_tick, bool price_limited, Qty qty, F&& on_fill){
+    Side resting_side = taker_side==Side::BUY ? Side::SELL : Side::BUY;
+    SideBook& sb=side_of(*this, resting_side);
+    Qty filled=0;
+
+    while(filled<qty && sb.best!=kNil){
+        Index li=sb.best;
+        int64_t tick=levels[li].tick;
+        if(price_limited && better_tick(taker_side, tick, limit_tick)) break;
+
+        while(filled<qty && levels[li].head!=kNil){
+            Index oi=levels[li].head;
+            OrderSlot& o=orders[oi];
+            Qty take = (qty-filled<o.remaining) ? static_cast<Qty>(qty-filled) : o.remaining;
+            o.remaining=static_cast<Qty>(o.remaining-take);
+            levels[li].total=static_cast<Qty>(levels[li].total-take);
+            filled=static_cast<Qty>(filled+take);
+            on_fill(oi, o.owner, tick, take);
+            if(orders[oi].remaining==0){
+                unlink_order(oi);
+                free_order_slot(oi);
+            }
+        }
+        if(levels[li].head==kNil) close_level(resting_side, li);
+    }
+    return filled;
+}
+
+// Compiled once in CompactBook.cpp
+extern template struct CompactBook<uint32_t>;
+extern template struct CompactBook<uint64_t>;
+
+}// namespace MatchEngine
+
+#endif // COMPACT_BOOK_HPP
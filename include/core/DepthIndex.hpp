@@ -0,0 +1,72 @@
+/*
+Invariants:
+1. Fenwick tree over a contiguous tick ladder [base, base+capacity); capacity is a power of two
+   and at most kMaxTicks.
+2. raw[i] == resting quantity at tick base+i; tree holds Fenwick partial sums of raw.
+3. Ticks outside the ladder live in outliers (tick -> quantity, no zero entries); a tick is in
+   exactly one of the two. total == sum of raw + sum of outliers.
+4. The ladder grows (re-based and doubled) while that keeps it within kMaxTicks; it never
+   shrinks. An empty ladder moves to a new tick in O(1) and absorbs the outliers it covers.
+5. Queries are O(log T + K), T = ladder capacity, K = outlier ticks (none while prices stay
+   within kMaxTicks of each other); growth is O(T) amortised over inserts.
+*/
+
+#ifndef DEPTH_INDEX_HPP
+#define DEPTH_INDEX_HPP //DepthIndex.hpp
+
+#include<cstdint>
+#include<cstddef>
+#include<map>
+#include<vector>
+
+namespace MatchEngine{
+
+struct DepthIndex{
+    // Ladder cap: 4 MB of raw + tree; one far-off price cannot allocate more
+    static constexpr size_t kMaxTicks=size_t{1}<<18;
+
+    void add(int64_t tick, uint64_t qty);
+    void remove(int64_t tick, uint64_t qty);
+
+    uint64_t total() const{
+        return total_qty;
+    }
+
+    // Distinct ticks held outside the ladder
+    size_t outlier_ticks() const{
+        return outliers.size();
+    }
+
+    // Cumulative quantity at ticks <= tick / >= tick
+    uint64_t quantity_at_or_below(int64_t tick) const;
+    uint64_t quantity_at_or_above(int64_t tick) const;
+
+    // Lowest tick t with quantity_at_or_below(t) >= qty (ask side walk)
+    bool lowest_tick_covering(uint64_t qty, int64_t& tick) const;
+
+    // Highest tick t with quantity_at_or_above(t) >= qty (bid side walk)
+    bool highest_tick_covering(uint64_t qty, int64_t& tick) const;
+
+private:
+    int64_t base=0;
+    std::vector<uint64_t> tree;
+    std::vector<uint64_t> raw;
+    uint64_t total_qty=0;
+    std::map<int64_t, uint64_t> outliers;
+    uint64_t outlier_qty=0;
+
+    bool in_ladder(int64_t tick) const{
+        return !raw.empty() && tick>=base && tick-base<static_cast<int64_t>(raw.size());
+    }
+    // false: tick stays outside the ladder
+    bool ensure_range(int64_t tick);
+    void rebuild_tree();
+    void absorb_outliers();
+    void update(size_t index, uint64_t delta);
+    uint64_t prefix(size_t count) const; // sum of raw[0, count)
+    size_t first_index_exceeding(uint64_t target) const;
+};
+
+}// namespace MatchEngine
+
+#endif // DEPTH_INDEX_HPP
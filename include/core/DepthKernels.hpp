@@ -0,0 +1,44 @@
+/*
+Reductions over the flat per-side level arrays (LevelArray).
+
+Invariants:
+1. Every SIMD variant returns bit-identical integer sums and the same notional as scalar up to
+   floating-point reassociation.
+2. The variant is picked once at runtime from the CPU's features; SCALAR is always available.
+3. Kernels read [0, n) only and never write.
+*/
+
+#ifndef DEPTH_KERNELS_HPP
+#define DEPTH_KERNELS_HPP //DepthKernels.hpp
+
+#include<cstdint>
+#include<cstddef>
+
+namespace MatchEngine{
+
+enum class SimdLevel:uint8_t{
+    SCALAR,
+    AVX2,
+    AVX512
+};
+
+struct DepthKernels{
+    SimdLevel level;
+    // sum of qty[0, n)
+    uint64_t (*sum_quantity)(const uint64_t* qty, size_t n);
+    // sum of price[i]*qty[i] over [0, n)
+    double (*sum_notional)(const double* price, const uint64_t* qty, size_t n);
+};
+
+// Best level supported by this CPU
+SimdLevel detect_simd_level();
+
+// Kernels for a specific level; falls back to the best supported one at or below it
+const DepthKernels& depth_kernels(SimdLevel level);
+
+// Kernels for detect_simd_level(), resolved once
+const DepthKernels& depth_kernels();
+
+}// namespace MatchEngine
+
+#endif // DEPTH_KERNELS_HPP
@@ -1,5 +1,6 @@
 #pragma once
 #include "core/Order.hpp"
+#include "core/MassQuote.hpp"
 #include "utils/Types.hpp"
 
 namespace MatchEngine{
@@ -7,7 +8,23 @@ namespace MatchEngine{
 struct EngineEvent{
     EventType type;
     Order* order=nullptr;
-    std::string order_id;
+    std::string order_id{};
+    double price=0.0;        // MODIFY_ORDER: new limit price
+    uint64_t quantity=0;     // MODIFY_ORDER: new total quantity, filled included
+    MassQuote* mass_quote=nullptr;  // MASS_QUOTE: caller-owned quote set
+    std::string user_id{};          // MASS_CANCEL: owner whose resting orders are cancelled
+    Side side=Side::BUY;            // MASS_CANCEL: side, unless both_sides
+    bool both_sides=true;
+    SymbolId symbol=kNoSymbol;      // set by ShardRouter::submit
+    uint32_t shard=0;               // MIGRATE_OUT: destination shard
+    TimeUtils::Timestamp time_ns=0; // replay: recorded event time, fed to the engine's clock
+
+    // Same event, carrying its recorded time
+    EngineEvent at(TimeUtils::Timestamp t) const{
+        EngineEvent e=*this;
+        e.time_ns=t;
+        return e;
+    }
 
     static EngineEvent New(Order* order){
         return EngineEvent{EventType::NEW_ORDER,order,""};
@@ -17,9 +34,38 @@ struct EngineEvent{
         return EngineEvent{EventType::CANCEL_ORDER,nullptr,id};
     }
 
+    static EngineEvent Modify(const std::string& id, double new_price, uint64_t new_quantity){
+        return EngineEvent{EventType::MODIFY_ORDER,nullptr,id,new_price,new_quantity};
+    }
+
+    static EngineEvent Quotes(MassQuote* mq){
+        return EngineEvent{EventType::MASS_QUOTE,nullptr,"",0.0,0,mq};
+    }
+
+    // Cancel-on-disconnect: every resting order of the user
+    static EngineEvent MassCancel(const std::string& uid){
+        EngineEvent e{EventType::MASS_CANCEL};
+        e.user_id=uid;
+        return e;
+    }
+
+    static EngineEvent MassCancel(const std::string& uid, Side s){
+        EngineEvent e=MassCancel(uid);
+        e.side=s;
+        e.both_sides=false;
+        return e;
+    }
+
     static EngineEvent Stop(){
         return EngineEvent{EventType::STOP,nullptr,""};
     }
+
+    static EngineEvent Migrate(EventType type, SymbolId sym, uint32_t to=0){
+        EngineEvent e{type};
+        e.symbol=sym;
+        e.shard=to;
+        return e;
+    }
 };
 
 }// namespace MatchEngine
@@ -3,6 +3,7 @@
 #include<queue>
 #include<mutex>
 #include<condition_variable>
+#include<chrono>
 #include "core/Event.hpp"
 
 namespace MatchEngine{
@@ -13,6 +14,12 @@ public:// public API
 
     bool pop(EngineEvent& event);
 
+    // false if nothing arrived within timeout
+    bool pop_for(EngineEvent& event, std::chrono::nanoseconds timeout);
+
+    // Events waiting; a racy sample for telemetry
+    size_t size();
+
 private:// private implementation
     std::queue<EngineEvent> q;
     std::mutex mtx;
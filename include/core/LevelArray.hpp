@@ -0,0 +1,49 @@
+/*
+Invariants:
+1. Structure-of-arrays mirror of one book side: prices[i] and quantities[i] describe one PriceLevel.
+2. Sorted worst → best, so the best level is at the back (bids ascending, asks descending).
+3. quantities[i] > 0 for every entry and equals that PriceLevel's total_quantity.
+4. Updated by OrderBook on every level change; never mutated by readers.
+*/
+
+#ifndef LEVEL_ARRAY_HPP
+#define LEVEL_ARRAY_HPP //LevelArray.hpp
+
+#include "utils/Types.hpp"
+#include<cstdint>
+#include<cstddef>
+#include<vector>
+
+namespace MatchEngine{
+
+struct LevelArray{
+    Side side;
+    std::vector<double> prices;
+    std::vector<uint64_t> quantities;
+
+    explicit LevelArray(Side s)
+        : side(s) {}
+
+    size_t size() const{
+        return prices.size();
+    }
+
+    bool empty() const{
+        return prices.empty();
+    }
+
+    // Set the aggregate quantity at price; 0 removes the entry
+    void set(double price, uint64_t qty);
+
+    // Number of entries strictly worse than price (first index not worse than price)
+    size_t lower_index(double price) const;
+
+    // true if a is a better price than b on this side
+    bool better(double a, double b) const{
+        return side == Side::BUY ? a > b : a < b;
+    }
+};
+
+}// namespace MatchEngine
+
+#endif // LEVEL_ARRAY_HPP
@@ -0,0 +1,39 @@
+/*
+Invariants:
+1. A MassQuote replaces the participant's whole quote set: every order from the previous
+   set that still rests is cancelled before any new quote is processed.
+2. Every quote is a LIMIT order in CREATED state owned by user_id; any other quote is
+   CANCELLED without touching the book. The caller owns the Order objects (as with
+   EngineEvent::New) and must keep them alive while they rest.
+3. One MassQuoteAck is produced per MassQuote, after all its quotes are processed.
+*/
+
+#ifndef MASS_QUOTE_HPP
+#define MASS_QUOTE_HPP //MassQuote.hpp
+
+#include "Order.hpp"
+#include<cstdint>
+#include<string>
+#include<vector>
+
+namespace MatchEngine{
+
+struct MassQuote{
+    std::string user_id;
+    std::vector<Order*> quotes;     // bids and asks, any order; empty pulls all quotes
+};
+
+// Aggregated acknowledgement for one MassQuote
+struct MassQuoteAck{
+    std::string user_id;
+    uint32_t cancelled=0;           // previous quotes pulled from the book
+    uint32_t accepted=0;            // new quotes processed; off-tick or foreign quotes are CANCELLED instead
+    uint32_t resting=0;             // new quotes left on the book
+    uint32_t trades=0;              // fills in this step (new quotes and any stops they trigger)
+    uint64_t filled_quantity=0;     // quantity traded by the new quotes
+    uint64_t event_sequence=0;      // engine stamp shared by the whole step
+};
+
+}// namespace MatchEngine
+
+#endif // MASS_QUOTE_HPP
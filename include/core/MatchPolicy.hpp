@@ -0,0 +1,90 @@
+/*
+Compile-time traits for the specialised matching loops.
+
+Invariants:
+1. Every side/type decision the matching loop needs is a constexpr here, so
+   BasicMatchingEngine::execute<Side, Policy> contains no runtime side or type branch.
+2. Policies only describe behaviour; state lives in Order / OrderBook.
+3. SideTraits<S>::crosses(limit, level) agrees with MatchingEngine::cross.
+*/
+
+#ifndef MATCH_POLICY_HPP
+#define MATCH_POLICY_HPP //MatchPolicy.hpp
+
+#include "OrderBook.hpp"
+#include "utils/Types.hpp"
+
+namespace MatchEngine{
+
+template<Side S>
+struct SideTraits;
+
+template<>
+struct SideTraits<Side::BUY>{
+    static constexpr Side opposite=Side::SELL;
+
+    template<class Book>
+    static PriceLevel* best_opposite(Book& book){
+        return book.best_ask;
+    }
+
+    static bool crosses(double limit_price, double level_price){
+        return limit_price>=level_price;
+    }
+    // a is a strictly better resting price than b for this taker
+    static bool improves(double a, double b){
+        return a<b;
+    }
+};
+
+template<>
+struct SideTraits<Side::SELL>{
+    static constexpr Side opposite=Side::BUY;
+
+    template<class Book>
+    static PriceLevel* best_opposite(Book& book){
+        return book.best_bid;
+    }
+
+    static bool crosses(double limit_price, double level_price){
+        return limit_price<=level_price;
+    }
+    static bool improves(double a, double b){
+        return a>b;
+    }
+};
+
+// price_limited: stop the sweep at the first level that does not cross
+// rests:         unfilled remainder is inserted into the book
+// all_or_none:   run the depth pre-check and cancel with zero fills on failure
+struct LimitPolicy{
+    static constexpr OrderType type=OrderType::LIMIT;
+    static constexpr bool price_limited=true;
+    static constexpr bool rests=true;
+    static constexpr bool all_or_none=false;
+};
+
+struct MarketPolicy{
+    static constexpr OrderType type=OrderType::MARKET;
+    static constexpr bool price_limited=false;
+    static constexpr bool rests=false;
+    static constexpr bool all_or_none=false;
+};
+
+struct IocPolicy{
+    static constexpr OrderType type=OrderType::IOC;
+    static constexpr bool price_limited=true;
+    static constexpr bool rests=false;
+    static constexpr bool all_or_none=false;
+};
+
+struct FokPolicy{
+    static constexpr OrderType type=OrderType::FOK;
+    static constexpr bool price_limited=true;
+    static constexpr bool rests=false;
+    static constexpr bool all_or_none=true;
+};
+
+}// namespace MatchEngine
+
+#endif // MATCH_POLICY_HPP
@@ -2,6 +2,8 @@
 Invariants:
 1. Matching loop lives in this file.
 2. Matching Engine is a singleton.
+3. BasicMatchingEngine<Book> only uses the BasicOrderBook interface, so the same
+   loop runs over every price-level container policy.
 */
 
 #ifndef MATCHING_ENGINE_HPP
@@ -9,12 +11,18 @@ Invariants:
 
 #include "OrderBook.hpp"
 #include "FeeCalculator/FeeCalculator.hpp"
+#include "FeeCalculator/FeeAggregator.hpp"
 #include "publisher/TradePublisher.hpp"
+#include "publisher/ConflatingBBOPublisher.hpp"
 #include "utils/TimeUtils.hpp"
+#include "utils/Clock.hpp"
 #include "EventQueue.hpp"
+#include "MassQuote.hpp"
 #include<string>
 #include<vector>
+#include<unordered_map>
 #include<cstdint>
+#include<cassert>
 
 namespace MatchEngine{
 
@@ -24,7 +32,8 @@ Invariants
 1. Exactly one buy and one sell per trade.
 2. quantity>0
 3. price equals the resting order’s price.
-4. Timestamp is monotonic per incoming order
+4. engine_ts, wall_ts and event_sequence are the stamp of the event that caused the
+   fill, so every fill of one sweep shares them; event_sequence is monotonic.
 */
 struct Trade{
     std::string user_id;
@@ -35,9 +44,13 @@ struct Trade{
     const TimeUtils::Timestamp engine_ts;
     const TimeUtils::Timestamp wall_ts;
 
-    //Fees
+    //Fees in currency, and exact in fee units (see FeeCalculator)
     double maker_fee;
     double taker_fee;
+    int64_t maker_fee_units=0;
+    int64_t taker_fee_units=0;
+
+    uint64_t event_sequence=0;
 
     Trade(std::string uid, std::string buy_id,
           std::string sell_id, double p, uint64_t qty,
@@ -50,34 +63,100 @@ struct Trade{
           taker_fee(taker) {}
 };
 
-struct MatchingEngine{
-    OrderBook& order_book;
-    FeeCalculator& fees_calculator;
+template<class Book>
+struct BasicMatchingEngine{
+    Book& order_book;
+    FeeCalculator* fees_calculator;     // rebound only by rebind_fees
 
     // Last traded price for stop loss triggering
     double last_trade_price=0.0;
 
     std::vector<Trade> trades;
 
+    // One aggregated ack per mass quote, in processing order
+    std::vector<MassQuoteAck> mass_quote_acks;
+
+    // Cross-shard fee volume; null when this engine's FeeCalculator is the only one
+    FeeAggregator* fee_aggregator=nullptr;
+    void set_fee_aggregator(FeeAggregator* a){
+        fee_aggregator=a;
+        if(a) a->attach(*fees_calculator);
+    }
+
+    // Charge fees to another calculator from now on (a book migrating between shards).
+    // Participant ids cached on resting and pending orders belong to the old one, so they
+    // are dropped and re-interned on next use
+    void rebind_fees(FeeCalculator& fees){
+        fees_calculator=&fees;
+        order_book.for_each_order([](Order* o){ o->user_index=kNoUser; });
+        if(fee_aggregator) fee_aggregator->attach(fees);
+    }
+
     //Trade Publisher
     TradePublisher* trade_publisher=nullptr;
     void set_trade_publisher(TradePublisher* p){
         trade_publisher=p;
     }
 
+    //Market data (depth from the book, conflated BBO from the engine)
+    ConflatingBBOPublisher bbo_publisher;
+    void set_market_data_publisher(MarketDataPublisher* p){
+        order_book.set_market_data_publisher(p);
+        bbo_publisher.downstream=p;
+        bbo_publisher.reset();
+    }
+
+    // Events processed between begin_batch/end_batch share one BBO update
+    uint32_t batch_depth=0;
+    void begin_batch(){
+        ++batch_depth;
+    }
+    void end_batch(){
+        assert(batch_depth>0);
+        if(--batch_depth==0) publish_bbo();
+    }
+
+    // Each event is stamped once, when it first reaches the book (sequence, engine and wall
+    // time); nested entry points reuse the outer stamp, so fills, status changes and market
+    // data share it. Calls that change nothing take no sequence number
+    uint64_t event_sequence=0;      // last sequence handed out
+    EventStamp stamp;
+    uint32_t stamp_depth=0;
+
+    // Injected clock (e.g. VirtualClock for replay); null reads the thread's TSC clock.
+    // A new clock is a new time base, so stamps restart from it
+    TimeUtils::Clock* clock=nullptr;
+    void set_clock(TimeUtils::Clock* c){
+        clock=c;
+        stamp.engine_ns=0;
+    }
+    TimeUtils::Timestamp clock_now_ns(){
+        return clock ? clock->now_ns() : TimeUtils::now_ns();
+    }
+
     bool running=false;//Initially Matching Engine is not running
 
     // Last timestamp
     TimeUtils::Timestamp last_timestamp=0;
 
+    // Engine-clock time DAY orders expire at; DAY orders arriving at or after it are
+    // cancelled on arrival (so are DAY orders while it is unset)
+    TimeUtils::Timestamp session_close_ns=0;
+    void set_session_close(TimeUtils::Timestamp close_ns){
+        session_close_ns=close_ns;
+    }
+
+    // Resting DAY/GTD orders cancelled by expiry
+    uint64_t expired_orders=0;
+
     // Constructor
-    explicit MatchingEngine(OrderBook& book, FeeCalculator& fee_calculator);
+    explicit BasicMatchingEngine(Book& book, FeeCalculator& fee_calculator);
 
     // Run check
     void run(EventQueue& queue);
     void process_event(const EngineEvent& event);
 
-    // Matching Loop
+    // Matching Loop (dispatches once into the specialised loop for side/type)
     void matching_loop(Order* order);
 
     // Order type Dispatcher
@@ -88,6 +167,23 @@ struct MatchingEngine{
     void process_market_order(Order* order);
     void process_ioc_order(Order* order);
     void process_fok_order(Order* order);
+    void process_peg_order(Order* order);
+
+    // Modify a resting limit order. new_quantity is the new total, filled included.
+    // Same price and lower quantity: reduced in place, keeps queue position.
+    // Price change or higher quantity: atomic cancel-replace in this step; may trade at
+    // the new price and rests at the back of the queue. new_quantity <= filled cancels.
+    // Returns false if id is not a resting limit order (pegged orders are cancel-only), or
+    // if new_price is not a positive, finite price on the tick grid.
+    bool modify_order(const std::string& id, double new_price, uint64_t new_quantity);
+
+    // Replace the participant's quote set in one step: pull the previous quotes still
+    // resting, then match/rest the new ones. One BBO update and one ack for the whole set.
+    MassQuoteAck mass_quote(const MassQuote& mq);
+
+    // Cancel resting DAY/GTD orders due by now_ns, publishing one BBO for all of them.
+    // run() calls it between events while timers are armed; returns the count.
+    size_t expire_orders(TimeUtils::Timestamp now_ns);
 
     // Helper function 
     static bool cross(const Order* order, const PriceLevel* level);
@@ -98,9 +194,54 @@ struct MatchingEngine{
 
 
 private:
-    Trade generate_trades(uint64_t trade_qty, Order* incoming, Order* resting);
+    // Stamps on the outermost entry only; one clock read per event
+    struct EventScope{
+        BasicMatchingEngine& engine;
+        explicit EventScope(BasicMatchingEngine& e):engine(e){
+            if(engine.stamp_depth++==0) engine.begin_event();
+        }
+        ~EventScope(){ --engine.stamp_depth; }
+    };
+    void begin_event(){
+        TimeUtils::Timestamp previous=stamp.engine_ns;
+        stamp.sequence=++event_sequence;
+        if(clock) clock->read(stamp.engine_ns, stamp.wall_ns);
+        else{
+            TimeUtils::now_both(stamp.engine_ns, stamp.wall_ns);
+            // The TSC clock is monotonic per thread only; a book migrated to another
+            // shard's thread may read behind its last stamp
+            if(stamp.engine_ns<=previous) stamp.engine_ns=previous+1;
+        }
+        order_book.event_stamp=stamp;
+    }
+
+    // Side/type dispatch happens once here; everything below is specialised
+    template<class Policy> void dispatch(Order* order);
+    template<Side S, class Policy> void execute(Order* order);
+    template<Side S, bool PriceLimited> bool match(Order* order);
+    bool expired_on_arrival(Order* order);
+    bool off_tick(const Order* order) const;
+
+    // Dense fee id, interned on first use (orders placed straight into the book skip entry)
+    UserIndex participant(Order* order){
+        if(order->user_index==kNoUser) order->user_index=fees_calculator->intern(order->user_id);
+        return order->user_index;
+    }
+
+    template<Side S>
+    Trade generate_trades(uint64_t trade_qty, Order* incoming, Order* resting, TakerSweep& sweep);
+    void publish_bbo();
 };
 
+// Compiled once in MatchingEngine.cpp
+extern template struct BasicMatchingEngine<OrderBook>;
+extern template struct BasicMatchingEngine<FlatOrderBook>;
+extern template struct BasicMatchingEngine<TickLadderOrderBook>;
+
+using MatchingEngine=BasicMatchingEngine<OrderBook>;
+using FlatMatchingEngine=BasicMatchingEngine<FlatOrderBook>;
+using TickLadderMatchingEngine=BasicMatchingEngine<TickLadderOrderBook>;
+
 }// namespace MatchEngine
 
 #endif // MATCHING_ENGINE_HPP
\ No newline at end of file
@@ -3,10 +3,19 @@ Invariants:
 1. remaining quantity>=0
 2. filled quantity+remaining quantity==order quantity
 3. If order is in a Price Level, then price_level!=nullptr
-4. next/prev is valid iff order is resting
+4. next/prev (level FIFO) and user_next/user_prev (owner's per-side list) are valid iff order is resting
 5. Order is accessed via unordered_map with order_id
-6. price > 0 for limit orders; market orders do not rely on price.
-7. Order timestamp is immutable and defines FIFO priority within a PriceLevel.
+6. price > 0 for limit orders; market orders do not rely on price. A resting PEG order's
+   price is only its last execution price; its live price is its peg group's.
+7. Order timestamp defines FIFO priority within a PriceLevel; it only changes when a
+   modify re-queues the order (price change or quantity increase).
+8. expiry is linked in the book's timing wheel iff the order rests with tif != GTC;
+   expire_ns is on the engine clock (TimeUtils::now_ns).
+9. Constructing an Order reads no clock; wall_timestamp_ns is 0 until the engine
+   accepts the order and copies its event stamp's wall time.
+10. Members are laid out hot first: everything the matching loop and level FIFO touch
+    fits the first 64 bytes, one-byte fields share a word, and the strings (read only at
+    entry, cancel and trade reporting) come last.
 */
 
 #ifndef ORDER_HPP
@@ -14,6 +23,7 @@ Invariants:
 
 #include "utils/Types.hpp"
 #include "utils/TimeUtils.hpp"
+#include "core/TimingWheel.hpp"
 #include<string>
 #include<utility>
 #include<cstdint>
@@ -24,10 +34,7 @@ namespace MatchEngine{
 struct PriceLevel;
 
 struct Order{
-    std::string user_id="Shubh";
-    std::string order_id;
-    Side side;
-    OrderType type;
+    // Hot: matching and the level FIFO (first cache line)
     double price=0.0;
     uint64_t original_quantity=0;
     uint64_t filled_quantity=0;
@@ -35,21 +42,42 @@ struct Order{
     Order* prev=nullptr;
     PriceLevel* price_level=nullptr;
     TimeUtils::Timestamp timestamp_ns=0;
-    const TimeUtils::Timestamp wall_timestamp_ns;
+    UserIndex user_index=kNoUser;   // interned at order entry (or first fill)
+    Side side;
+    OrderType type;
     OrderStatus status=OrderStatus::CREATED;
+    //Time in force (DAY takes expire_ns from the engine's session close)
+    TimeInForce tif=TimeInForce::GTC;
 
-    //Stop loss
+    Order* user_next=nullptr;
+    Order* user_prev=nullptr;
+    TimeUtils::Timestamp wall_timestamp_ns=0;
+    TimeUtils::Timestamp expire_ns=0;
+
+    //Stop loss (trailing stops: stop_price is set to the trigger price when they fire)
     double stop_price=0.0;
+    double trail_offset=0.0;
+
+    //Pegged: price = reference - offset for buys, reference + offset for sells
+    double peg_offset=0.0;
+    PegReference peg_reference=PegReference::NONE;
+
     bool is_triggered=false;
+    //Entered through a MassQuote: while resting it belongs to its user's quote set
+    bool is_quote=false;
+
+    TimerNode expiry;
+
+    // Cold: identity strings
+    std::string user_id="Shubh";
+    std::string order_id;
 
     // Core Constructor
     Order(std::string uid, std::string id, Side s, OrderType t,
           double p, uint64_t qty, double stop_p, const TimeUtils::Timestamp& tstamp)
-        : user_id(std::move(uid)), order_id(std::move(id)),
-          side(s), type(t), price(p),
-          original_quantity(qty), timestamp_ns(tstamp),
-          wall_timestamp_ns(TimeUtils::wall_time_ns()), 
-          status(OrderStatus::CREATED), stop_price(stop_p) {
+        : price(p), original_quantity(qty), timestamp_ns(tstamp),
+          side(s), type(t), status(OrderStatus::CREATED), stop_price(stop_p),
+          user_id(std::move(uid)), order_id(std::move(id)) {
               assert(qty>0);
               if (type == OrderType::LIMIT) assert(price > 0.0);
               if (type == OrderType::STOP_LOSS || type == OrderType::STOP_LIMIT) assert(stop_price > 0.0);
@@ -79,6 +107,25 @@ struct Order{
         : Order("Shubh", std::move(id), s, t, p, qty, stop_p, tstamp) {}
 
 
+    // Pegged order (offset >= 0 is the distance away from the reference, never through it)
+    Order(std::string uid, std::string id, Side s, PegReference ref, double offset,
+        uint64_t qty, const TimeUtils::Timestamp& tstamp)
+        : Order(std::move(uid), std::move(id), s, OrderType::PEG, 0.0, qty, 0.0, tstamp) {
+            assert(ref != PegReference::NONE);
+            assert(offset >= 0.0);
+            peg_reference=ref;
+            peg_offset=offset;
+        }
+
+    // Trailing stop: triggers once the last trade price retraces trail from its best since
+    // entry (sell: below the high, buy: above the low), then executes as MARKET
+    Order(std::string uid, std::string id, Side s, uint64_t qty, double trail,
+        const TimeUtils::Timestamp& tstamp)
+        : Order(std::move(uid), std::move(id), s, OrderType::TRAILING_STOP, 0.0, qty, 0.0, tstamp) {
+            assert(trail > 0.0);
+            trail_offset=trail;
+        }
+
     uint64_t remaining_quantity() const{
         return original_quantity-filled_quantity;
     }
@@ -1,11 +1,25 @@
 /*
 Invariants:
-1. OrderBook comprises of two sides (bid(desc) and ask(asc))
+1. OrderBook comprises of two sides (bid(desc) and ask(asc)), each held in the
+   container chosen by the LevelPolicy (see PriceLevelContainers.hpp).
 2. Market Order never rests on the book
 3. Limit Order if qty remains, updated on the same side while matches done on opposite side.
-4. Cached BBO (best bid / best ask) always reflects the top of each side.
-5. Empty PriceLevel does not exist.
-6. Every resting order exists in exactly one PriceLevel and in the order_id map.
+4. best_bid / best_ask are the heads of each side's intrusive level list
+   (PriceLevel::next walks best → worst, prev walks back); the list holds
+   exactly the levels in the container, in price order.
+5. No empty PriceLevel is visible: emptied levels are either deleted or retained
+   (unlinked, kept in the container for reuse) up to level_cache_capacity per side.
+6. Every resting order exists in exactly one PriceLevel, in the order_id map and in its
+   user's per-side list (user_orders); DAY/GTD orders are also armed in expiry_wheel.
+   Resting orders with is_quote are also in their user's quotes, and only while resting.
+7. bid_depth/ask_depth hold the same per-tick quantities as the level containers (cumulative depth index).
+   Every displayed price is on the tick_size grid (on_tick), so one tick is one level.
+8. bid_levels/ask_levels mirror every level's price and total_quantity as flat arrays, best at the back.
+9. PEG orders are non-displayed: they rest in peg_groups, one virtual PriceLevel per
+   (side, reference, offset), never in the containers, level list, depth views or BBO.
+   A group's price is derived from best_bid/best_ask whenever it is read, except during
+   a sweep: freeze_pegs() fixes both references at the touch the sweep started from, so a
+   PRIMARY peg keeps its price while the levels it references are consumed.
 */
 
 #ifndef ORDERBOOK_HPP
@@ -13,31 +27,84 @@ Invariants:
 
 #include "Order.hpp"
 #include "PriceLevel.hpp"
+#include "DepthIndex.hpp"
+#include "LevelArray.hpp"
+#include "PriceLevelContainers.hpp"
+#include "TimingWheel.hpp"
+#include "TrailingStops.hpp"
 #include "market_data/BBO.hpp"
+#include "market_data/EventStamp.hpp"
 #include "market_data/L2Snapshot.hpp"
+#include "publisher/MarketDataPublisher.hpp"
 #include<string>
-#include<map>
 #include<unordered_map>
+#include<map>
+#include<cmath>
 
 namespace MatchEngine{
 
-struct OrderBook{
+// Resting orders of one user, one intrusive list per side (via Order::user_next/user_prev)
+struct UserOrders{
+    Order* head[2]={nullptr, nullptr};      // indexed by Side
+    size_t count[2]={0, 0};
+    std::unordered_map<std::string,Order*> quotes;  // resting mass-quote orders by id
+};
+
+// Empty-level retention counters (both sides)
+struct LevelCacheStats{
+    uint64_t hits=0;        // insert at a retained price, no allocation or container insert
+    uint64_t misses=0;      // new level allocated
+    uint64_t evictions=0;   // retained level dropped to stay within capacity
+};
+
+template<class LevelPolicy>
+struct BasicOrderBook{
+    using BidLevels=typename LevelPolicy::template SideLevels<Side::BUY>;
+    using AskLevels=typename LevelPolicy::template SideLevels<Side::SELL>;
+
     PriceLevel* best_bid;
     PriceLevel* best_ask;
 
     //Price lookup
-    std::map<double,PriceLevel*> bids;
-    std::map<double,PriceLevel*> asks;
+    BidLevels bids;
+    AskLevels asks;
 
     //Order lookup
     std::unordered_map<std::string,Order*> orders;
 
+    //Per-user resting orders; entries persist once a user has rested an order
+    std::unordered_map<std::string,UserOrders> user_orders;
+
     //Stop loss orders
     std::vector<Order*> pending_stops;
+    //Trailing stops, indexed by trigger relative to their water marks
+    TrailingStops trailing_stops;
+
+    //Depth deltas (BBO is published by the engine once per event)
+    MarketDataPublisher* market_data_publisher=nullptr;
+    void set_market_data_publisher(MarketDataPublisher* p){
+        market_data_publisher=p;
+    }
+    //Stamp of the engine event in progress, copied onto depth deltas
+    EventStamp event_stamp;
     
+    //Price grid used by the cumulative depth index
+    double tick_size;
+
+    //Flat per-side level mirror for SIMD depth analytics
+    LevelArray bid_levels;
+    LevelArray ask_levels;
+
+    //Recently emptied levels kept per side for reuse when liquidity flickers
+    static constexpr size_t kDefaultLevelCacheCapacity=8;
+    LevelCacheStats level_cache_stats;
+    size_t level_cache_capacity() const{ return cache_capacity; }
+    void set_level_cache_capacity(size_t capacity);
+
     //Constructor
-    OrderBook()
-        : best_bid(nullptr), best_ask(nullptr) {}
+    explicit BasicOrderBook(double tick=0.01)
+        : best_bid(nullptr), best_ask(nullptr), bids(tick), asks(tick),
+          tick_size(tick), bid_levels(Side::BUY), ask_levels(Side::SELL) {}
 
     //Insert limit order
     void insert_limit(Order* order);
@@ -45,6 +112,64 @@ struct OrderBook{
     //Cancel order
     bool cancel_order(std::string id);
 
+    //Lower a resting order's total quantity in place; keeps FIFO priority.
+    //filled_quantity < new_quantity < original_quantity
+    bool reduce_order(const std::string& id, uint64_t new_quantity);
+
+    //Take a resting order off the book without cancelling it (first half of cancel-replace)
+    Order* detach_order(const std::string& id);
+
+    //Cancel every resting order of a user, O(k) in that user's orders, and disarm the user's
+    //stop and trailing-stop orders, O(S) in armed stops; returns the count of both
+    size_t cancel_user_orders(const std::string& user_id);
+    size_t cancel_user_orders(const std::string& user_id, Side side);
+    size_t user_order_count(const std::string& user_id, Side side) const;
+
+    //Drop a resting order the matching loop has fully filled
+    void remove_filled(Order* order);
+
+    //Cancel every resting DAY/GTD order whose expire_ns is at or before now_ns.
+    //O(1) amortised per order; returns the count. before_cancel(order) runs ahead of each
+    //cancel, so a caller can stamp the event only once something actually expires.
+    //Expired orders leave exactly like cancels: depth deltas, status CANCELLED
+    template<class F>
+    size_t expire_orders(TimeUtils::Timestamp now_ns, F&& before_cancel){
+        return expiry_wheel.advance(now_ns, [&](TimerNode* node){
+            Order* order=node->order;
+            before_cancel(order);
+            orders.erase(order->order_id);
+            detach_resting(order);
+            order->status=OrderStatus::CANCELLED;
+        });
+    }
+    size_t expire_orders(TimeUtils::Timestamp now_ns){
+        return expire_orders(now_ns, [](Order*){});
+    }
+    size_t pending_expiries() const{ return expiry_wheel.size(); }
+
+    //Every order the book holds: resting (displayed and pegged), then pending and
+    //trailing stops
+    template<class F>
+    void for_each_order(F&& f){
+        for(auto& [id, order] : orders) f(order);
+        for(Order* order : pending_stops) f(order);
+        trailing_stops.for_each(f);
+    }
+
+    //Pegged orders, grouped by (side, reference, offset) into virtual levels. A BBO move
+    //reprices every group at once: nothing is rewritten, prices are resolved on read.
+    void insert_peg(Order* order);
+    //reference -/+ offset for side; false while the reference is undefined
+    bool peg_price(Side side, PegReference ref, double offset, double& price) const;
+    //Best active group on side with its price refreshed; nullptr if none.
+    //Equal prices go to the group with the older head order
+    PriceLevel* best_peg(Side side);
+    //Hold peg references at the current touch until thaw_pegs(); one sweep at a time
+    void freeze_pegs();
+    void thaw_pegs(){ pegs_frozen=false; }
+    size_t peg_order_count(Side side) const{ return peg_orders[static_cast<size_t>(side)]; }
+    size_t peg_group_count(Side side) const;
+
     //Get Best bid and ask price
     PriceLevel* get_best_bid();
     PriceLevel* get_best_ask();
@@ -56,6 +181,9 @@ struct OrderBook{
     //Remove Price Level if empty
     void remove_price_level(Side side, PriceLevel* level);
 
+    //Reduce resting quantity at a level after a fill
+    void reduce_level_quantity(Side side, PriceLevel* level, uint64_t qty);
+
     PriceLevel* get_best_opposite(Side side);
 
     // const overload
@@ -64,12 +192,96 @@ struct OrderBook{
     // Pre Scan loop
     bool can_fully_fill(const Order* order) const;
 
+    // Cumulative depth queries, O(log T) over the tick ladder
+    // Quantity a taker on taker_side can reach at limit_price or better
+    uint64_t available_quantity(Side taker_side, double limit_price) const;
+    // Worst price a taker on taker_side must reach to fill qty; false if the book is too thin
+    bool price_to_fill(Side taker_side, uint64_t qty, double& price) const;
+    // Total resting quantity on one side
+    uint64_t total_depth(Side side) const;
+
+    // Depth analytics over the flat level mirror, SIMD reductions
+    // Quantity resting on side within band of that side's best price
+    uint64_t depth_within(Side side, double band) const;
+    // (bid - ask) / (bid + ask) over the top `levels` levels of each side; 0 on an empty book
+    double imbalance(size_t levels) const;
+    // Average price a taker on taker_side would pay to fill qty; false if the book is too thin
+    bool vwap_to_fill(Side taker_side, uint64_t qty, double& vwap) const;
+
+    // Whether price sits on the tick grid. Off-grid prices are rejected at entry: two of them
+    // could round to one tick, and the depth index would count liquidity match never crosses
+    bool on_tick(double price) const{
+        double ticks=price/tick_size;
+        return std::fabs(ticks-std::nearbyint(ticks)) <= 1e-6;
+    }
+    int64_t price_to_tick(double price) const{
+        return std::llround(price/tick_size);
+    }
+    double tick_to_price(int64_t tick) const{
+        return static_cast<double>(tick)*tick_size;
+    }
+
+    // Visit levels of one side best first; f(const PriceLevel*) returns false to stop
+    template<class F>
+    void for_each_level(Side side, F&& f) const{
+        for(const PriceLevel* l=(side == Side::BUY) ? best_bid : best_ask; l; l=l->next){
+            if(!f(l)) return;
+        }
+    }
+
     // Snapshots and BBO calculation
     BBO get_bbo() const;
     L2Snapshot get_l2_snapshot(size_t depth)const;
 
+private:
+    DepthIndex bid_depth;
+    DepthIndex ask_depth;
+
+    // Retained empty levels, oldest first
+    size_t cache_capacity=kDefaultLevelCacheCapacity;
+    std::vector<PriceLevel*> retained_bids;
+    std::vector<PriceLevel*> retained_asks;
+
+    // Reuse a retained level at price or allocate one; returns it linked and holding order
+    PriceLevel* open_level(Order* order);
+    void evict_retained(Side side, size_t keep);
+
+    void level_changed(Side side, double price, uint64_t quantity);
+
+    // Resting DAY/GTD orders keyed by expire_ns
+    TimingWheel expiry_wheel;
+    void arm_expiry(Order* order);
+
+    // [side][reference == MID]: offset → group, smallest offset (best price) first
+    std::map<double, PriceLevel> peg_groups[2][2];
+    size_t peg_orders[2]={0, 0};
+    bool pegs_frozen=false;
+    double frozen_primary[2]={0.0, 0.0};    // by side; 0 = no reference
+    double frozen_mid=0.0;
+    std::map<double, PriceLevel>& groups_of(const Order* order){
+        return peg_groups[static_cast<size_t>(order->side)][order->peg_reference==PegReference::MID];
+    }
+    void detach_peg(Order* order);
+
+    void detach_resting(Order* order);
+    void link_user(Order* order);
+    void unlink_user(Order* order);
+
+    // Intrusive best-first level list; better==nullptr links as the new head
+    void link_level(Side side, PriceLevel* level, PriceLevel* better);
+    void unlink_level(Side side, PriceLevel* level);
+
 };
 
+// Compiled once in OrderBook.cpp
+extern template struct BasicOrderBook<TreeLevelPolicy>;
+extern template struct BasicOrderBook<FlatLevelPolicy>;
+extern template struct BasicOrderBook<TickLadderLevelPolicy>;
+
+using OrderBook=BasicOrderBook<TreeLevelPolicy>;
+using FlatOrderBook=BasicOrderBook<FlatLevelPolicy>;
+using TickLadderOrderBook=BasicOrderBook<TickLadderLevelPolicy>;
+
 }// namespace MatchEngine
 
 #endif // ORDERBOOK_HPP
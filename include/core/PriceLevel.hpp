@@ -4,8 +4,9 @@ Invariants:
 2. quantity is non-negative and equals the sum of remaining_quantity of all orders in this PriceLevel.
 3. Orders inside a PriceLevel are strictly FIFO (head = oldest, tail = newest).
 4. Each PriceLevel contains orders sorted with their arrival time in the order book.
-5. Empty PriceLevel does not exist
-6. prev/next pointers are updated accordingly to access O(1) insert/cancel.
+5. Empty PriceLevel is never linked into a side; OrderBook may retain it unlinked for reuse
+6. Order prev/next pointers are updated accordingly to access O(1) insert/cancel.
+   Level prev/next link the levels of one side best → worst (owned by OrderBook).
 7. head->prev == nullptr and tail->next == nullptr.
 8. Each Order in this PriceLevel has:
    - order->price == this->price
@@ -26,8 +27,8 @@ struct PriceLevel{
     double price;
     uint64_t total_quantity;
     uint64_t order_count;
-    PriceLevel* prev;
-    PriceLevel* next;
+    PriceLevel* prev;   // next better level on this side
+    PriceLevel* next;   // next worse level on this side
     Order* head;
     Order* tail;
 
@@ -0,0 +1,440 @@
+/*
+Price-level container policies for BasicOrderBook.
+
+Each policy exposes one container template per side, SideLevels<S>, with the interface:
+    explicit SideLevels(double tick_size);
+    PriceLevel* find(double price) const;            // nullptr if absent
+    PriceLevel* insert(double price, PriceLevel* level);  // price must be absent;
+                                                     // returns the nearest better live level, nullptr if new best
+    void erase(double price);                        // live level must be present
+    void retain(double price);                       // hide an emptied level, keep its entry
+    PriceLevel* restore(double price);               // re-show a retained level; neighbour as insert()
+    void evict(double price);                        // drop a retained level
+    bool empty() const;
+    size_t size() const;                             // live levels only
+
+Invariants:
+1. A level is live when non-empty and retained when empty. Retained levels are still
+   found by find() but are never returned as a neighbour and are not counted by size().
+2. Containers only index levels by price. Best-first order lives in the PriceLevel
+   prev/next list that BasicOrderBook links from the neighbour insert()/restore() return.
+3. Containers own no PriceLevel; BasicOrderBook allocates and deletes them.
+4. Neighbour searches skip at most the book's retention capacity of retained levels.
+5. The tick ladder's dense window is at most kMaxTicks wide; levels outside it are held in a
+   MapLevels (far) and each level is in exactly one of the two.
+
+Policies:
+- TreeLevelPolicy:       std::map, best at begin(). O(log P) insert/erase. Good for sparse books.
+- FlatLevelPolicy:       sorted vector, best at the back. O(1) touch updates, O(P) deep inserts.
+- TickLadderLevelPolicy: dense array indexed by tick plus an occupancy bitmap. O(1) find; a new
+                         level and an erased best scan the bitmap 64 ticks per word for their
+                         neighbour. Good for liquid, tightly-ticked products. Prices beyond
+                         the capped window fall back to the tree.
+*/
+
+#ifndef PRICE_LEVEL_CONTAINERS_HPP
+#define PRICE_LEVEL_CONTAINERS_HPP //PriceLevelContainers.hpp
+
+#include "PriceLevel.hpp"
+#include "utils/Types.hpp"
+#include<bit>
+#include<cassert>
+#include<cmath>
+#include<cstdint>
+#include<functional>
+#include<map>
+#include<type_traits>
+#include<utility>
+#include<vector>
+
+namespace MatchEngine{
+
+// true if a is a better price than b for resting side S
+template<Side S>
+constexpr bool better_price(double a, double b){
+    if constexpr(S==Side::BUY) return a>b;
+    else return a<b;
+}
+
+// ─── Tree ─────────────────────────────────────────────────────────────────────
+
+template<Side S>
+struct MapLevels{
+    using Compare=std::conditional_t<S==Side::BUY, std::greater<double>, std::less<double>>;
+    using Map=std::map<double,PriceLevel*,Compare>;
+    Map levels;
+
+    explicit MapLevels(double){}
+
+    PriceLevel* find(double price) const{
+        auto it=levels.find(price);
+        return it==levels.end() ? nullptr : it->second;
+    }
+
+    PriceLevel* insert(double price, PriceLevel* level){
+        return better_live(levels.emplace(price, level).first);
+    }
+
+    // Nearest live level strictly better than price; price need not be present
+    PriceLevel* better_than(double price) const{
+        return better_live(levels.lower_bound(price));
+    }
+
+    void erase(double price){
+        levels.erase(price);
+    }
+
+    void retain(double){
+        ++hidden;
+    }
+
+    PriceLevel* restore(double price){
+        --hidden;
+        return better_live(levels.find(price));
+    }
+
+    void evict(double price){
+        --hidden;
+        levels.erase(price);
+    }
+
+    bool empty() const{ return size()==0; }
+    size_t size() const{ return levels.size()-hidden; }
+
+private:
+    size_t hidden=0;                     // retained (empty) levels still in the map
+
+    PriceLevel* better_live(typename Map::const_iterator it) const{
+        while(it!=levels.begin()){
+            --it;
+            if(!it->second->is_empty()) return it->second;
+        }
+        return nullptr;
+    }
+};
+
+struct TreeLevelPolicy{
+    template<Side S> using SideLevels=MapLevels<S>;
+};
+
+// ─── Flat sorted vector ───────────────────────────────────────────────────────
+
+template<Side S>
+struct FlatLevels{
+    // worst → best, best at the back so touch inserts/erases move nothing
+    std::vector<std::pair<double,PriceLevel*>> levels;
+
+    explicit FlatLevels(double){}
+
+    // first index whose price is not worse than price
+    size_t lower_index(double price) const{
+        size_t lo=0;
+        size_t hi=levels.size();
+        while(lo<hi){
+            size_t mid=lo+(hi-lo)/2;
+            if(better_price<S>(price, levels[mid].first)) lo=mid+1;
+            else hi=mid;
+        }
+        return lo;
+    }
+
+    PriceLevel* find(double price) const{
+        if(!levels.empty() && levels.back().first==price) return levels.back().second;
+        size_t i=lower_index(price);
+        return (i<levels.size() && levels[i].first==price) ? levels[i].second : nullptr;
+    }
+
+    PriceLevel* insert(double price, PriceLevel* level){
+        if(levels.empty() || better_price<S>(price, levels.back().first)){
+            levels.emplace_back(price, level);
+            return nullptr;
+        }
+        size_t i=lower_index(price);
+        assert(i<levels.size() && levels[i].first!=price);
+        levels.insert(levels.begin()+static_cast<std::ptrdiff_t>(i), {price, level});
+        return better_live(i);
+    }
+
+    void erase(double price){
+        if(levels.back().first==price){
+            levels.pop_back();
+            return;
+        }
+        size_t i=lower_index(price);
+        assert(i<levels.size() && levels[i].first==price);
+        levels.erase(levels.begin()+static_cast<std::ptrdiff_t>(i));
+    }
+
+    void retain(double){
+        ++hidden;
+    }
+
+    PriceLevel* restore(double price){
+        --hidden;
+        size_t i=lower_index(price);
+        assert(i<levels.size() && levels[i].first==price);
+        return better_live(i);
+    }
+
+    void evict(double price){
+        --hidden;
+        erase(price);
+    }
+
+    bool empty() const{ return size()==0; }
+    size_t size() const{ return levels.size()-hidden; }
+
+private:
+    size_t hidden=0;                     // retained (empty) levels still in the vector
+
+    PriceLevel* better_live(size_t i) const{
+        for(++i;i<levels.size();++i){
+            if(!levels[i].second->is_empty()) return levels[i].second;
+        }
+        return nullptr;
+    }
+};
+
+struct FlatLevelPolicy{
+    template<Side S> using SideLevels=FlatLevels<S>;
+};
+
+// ─── Dense tick ladder ────────────────────────────────────────────────────────
+
+template<Side S>
+struct TickLadderLevels{
+    static constexpr size_t kInitialTicks=1024;
+    static constexpr size_t kMaxTicks=size_t{1}<<18;   // 2 MB of slots per side at most
+    static constexpr size_t npos=static_cast<size_t>(-1);
+
+    double tick_size;
+    int64_t base=0;                      // tick of slots[0]
+    std::vector<PriceLevel*> slots;
+    std::vector<uint64_t> occupied;      // one bit per live slot; retained levels keep the slot, not the bit
+    size_t count=0;                      // live slots
+    size_t filled=0;                     // non-null slots, live or retained
+    size_t best_slot=npos;
+    MapLevels<S> far;                    // levels outside the window
+
+    explicit TickLadderLevels(double tick)
+        : tick_size(tick), far(tick) {}
+
+    int64_t tick_of(double price) const{
+        return std::llround(price/tick_size);
+    }
+
+    PriceLevel* find(double price) const{
+        int64_t tick=tick_of(price);
+        if(!in_window(tick)) return far.find(price);
+        return slots[static_cast<size_t>(tick-base)];
+    }
+
+    PriceLevel* insert(double price, PriceLevel* level){
+        int64_t tick=tick_of(price);
+        if(!ensure_range(tick)) return far_neighbour(tick, far.insert(price, level));
+        size_t i=static_cast<size_t>(tick-base);
+        assert(slots[i]==nullptr);
+        slots[i]=level;
+        ++filled;
+        return activate(i, price);
+    }
+
+    void erase(double price){
+        int64_t tick=tick_of(price);
+        if(!in_window(tick)) return far.erase(price);
+        size_t i=slot_of(tick);
+        deactivate(i);
+        slots[i]=nullptr;
+        --filled;
+    }
+
+    void retain(double price){
+        int64_t tick=tick_of(price);
+        if(!in_window(tick)) return far.retain(price);
+        deactivate(slot_of(tick));
+    }
+
+    PriceLevel* restore(double price){
+        int64_t tick=tick_of(price);
+        if(!in_window(tick)) return far_neighbour(tick, far.restore(price));
+        return activate(slot_of(tick), price);
+    }
+
+    void evict(double price){
+        int64_t tick=tick_of(price);
+        if(!in_window(tick)) return far.evict(price);
+        size_t i=slot_of(tick);
+        assert(!(occupied[i>>6]&(uint64_t{1}<<(i&63))));
+        slots[i]=nullptr;
+        --filled;
+    }
+
+    bool empty() const{ return size()==0; }
+    size_t size() const{ return count+far.size(); }
+
+private:
+    bool in_window(int64_t tick) const{
+        return tick>=base && tick-base<static_cast<int64_t>(slots.size());
+    }
+
+    size_t slot_of(int64_t tick) const{
+        size_t i=static_cast<size_t>(tick-base);
+        assert(i<slots.size() && slots[i]!=nullptr);
+        return i;
+    }
+
+    PriceLevel* activate(size_t i, double price){
+        occupied[i>>6]|=uint64_t{1}<<(i&63);
+        ++count;
+        if(best_slot==npos || better_slot(i, best_slot)){
+            best_slot=i;
+            // anything better lies beyond the window's better edge
+            return far.better_than(price);
+        }
+        // bounded by the distance to the best slot
+        return slots[next_better(i)];
+    }
+
+    void deactivate(size_t i){
+        occupied[i>>6]&=~(uint64_t{1}<<(i&63));
+        --count;
+        if(i==best_slot) best_slot=count ? next_worse(i) : npos;
+    }
+
+    // A far level's better neighbour: the nearer of the far one and, when the window lies
+    // on its better side, the window's worst live level
+    PriceLevel* far_neighbour(int64_t tick, PriceLevel* outer) const{
+        bool window_better = (S==Side::BUY) ? tick<base : tick>=base+static_cast<int64_t>(slots.size());
+        if(!window_better || count==0) return outer;
+        PriceLevel* inner=slots[worst_live()];
+        if(!outer || better_price<S>(outer->price, inner->price)) return inner;
+        return outer;
+    }
+
+    size_t worst_live() const{
+        if constexpr(S==Side::BUY) return (occupied[0]&1) ? 0 : scan_up(0);
+        else{
+            size_t last=slots.size()-1;
+            return (occupied[last>>6]>>(last&63))&1 ? last : scan_down(last);
+        }
+    }
+
+    static bool better_slot(size_t a, size_t b){
+        if constexpr(S==Side::BUY) return a>b;
+        else return a<b;
+    }
+
+    // Nearest occupied slot strictly below / above i, or npos
+    size_t scan_down(size_t i) const{
+        if(i==0) return npos;
+        size_t pos=i-1;
+        size_t word=pos>>6;
+        uint64_t bits=occupied[word]&(~uint64_t{0}>>(63-(pos&63)));
+        while(true){
+            if(bits) return (word<<6)+63-static_cast<size_t>(std::countl_zero(bits));
+            if(word==0) return npos;
+            bits=occupied[--word];
+        }
+    }
+
+    size_t scan_up(size_t i) const{
+        size_t pos=i+1;
+        if(pos>=slots.size()) return npos;
+        size_t word=pos>>6;
+        uint64_t bits=occupied[word]&(~uint64_t{0}<<(pos&63));
+        while(true){
+            if(bits) return (word<<6)+static_cast<size_t>(std::countr_zero(bits));
+            if(++word==occupied.size()) return npos;
+            bits=occupied[word];
+        }
+    }
+
+    size_t next_worse(size_t i) const{
+        if constexpr(S==Side::BUY) return scan_down(i);
+        else return scan_up(i);
+    }
+
+    size_t next_better(size_t i) const{
+        if constexpr(S==Side::BUY) return scan_up(i);
+        else return scan_down(i);
+    }
+
+    // false: tick stays outside the window, in far
+    bool ensure_range(int64_t tick){
+        if(slots.empty()){
+            base=tick-static_cast<int64_t>(kInitialTicks/2);
+            slots.assign(kInitialTicks, nullptr);
+            occupied.assign(kInitialTicks/64, 0);
+            return true;
+        }
+        if(in_window(tick)) return true;
+
+        // No live level in the window: hand retained ones to far and move it
+        if(count==0){
+            if(filled){
+                for(PriceLevel*& slot: slots){
+                    if(!slot) continue;
+                    far.insert(slot->price, slot);
+                    far.retain(slot->price);
+                    slot=nullptr;
+                }
+                filled=0;
+            }
+            base=tick-static_cast<int64_t>(slots.size()/2);
+            absorb_far();
+            return true;
+        }
+
+        int64_t new_base=base;
+        size_t new_size=slots.size();
+        while(tick<new_base || tick>=new_base+static_cast<int64_t>(new_size)){
+            if(new_size>=kMaxTicks) return false;
+            if(tick<new_base) new_base-=static_cast<int64_t>(new_size);
+            new_size*=2;
+        }
+
+        std::vector<PriceLevel*> grown(new_size, nullptr);
+        size_t shift=static_cast<size_t>(base-new_base);
+        for(size_t i=0;i<slots.size();++i) grown[shift+i]=slots[i];
+        slots.swap(grown);
+        base=new_base;
+
+        occupied.assign(new_size/64, 0);
+        for(size_t i=0;i<new_size;++i){
+            if(slots[i] && !slots[i]->is_empty()) occupied[i>>6]|=uint64_t{1}<<(i&63);
+        }
+        if(best_slot!=npos) best_slot+=shift;
+        absorb_far();
+        return true;
+    }
+
+    // Move far levels the window now covers into it
+    void absorb_far(){
+        if(far.levels.empty()) return;
+        std::vector<PriceLevel*> moved;
+        for(auto& [price, level]: far.levels){
+            if(in_window(tick_of(price))) moved.push_back(level);
+        }
+        for(PriceLevel* level: moved){
+            size_t i=static_cast<size_t>(tick_of(level->price)-base);
+            slots[i]=level;
+            ++filled;
+            if(level->is_empty()){
+                far.evict(level->price);
+                continue;
+            }
+            far.erase(level->price);
+            occupied[i>>6]|=uint64_t{1}<<(i&63);
+            ++count;
+            if(best_slot==npos || better_slot(i, best_slot)) best_slot=i;
+        }
+    }
+};
+
+struct TickLadderLevelPolicy{
+    template<Side S> using SideLevels=TickLadderLevels<S>;
+};
+
+}// namespace MatchEngine
+
+#endif // PRICE_LEVEL_CONTAINERS_HPP
@@ -0,0 +1,189 @@
+/*
+Multi-instrument routing onto per-core engine shards.
+
+Every symbol is owned by exactly one EngineShard. A shard is one thread (pinned to a
+core when asked) with its own EventQueue and FeeCalculator. It holds one Instrument
+(OrderBook + MatchingEngine) per symbol it owns, created on the shard's thread at the
+symbol's first event. Shards share nothing on the matching path. Fee tiers meet across
+shards only through the router's FeeAggregator.
+
+Migration moves a symbol between shards without losing or reordering its events.
+Under the symbol's route lock the router queues MIGRATE_EXPECT on the destination,
+queues MIGRATE_OUT on the source, and repoints owner. The destination then parks the
+symbol's events, all of which sit behind the marker. When the source reaches
+MIGRATE_OUT, every earlier event has been applied. It hands the Instrument over through
+the destination's mailbox and queues MIGRATE_IN there. On MIGRATE_IN the destination
+installs the book and replays the parked events in arrival order.
+
+Invariants:
+1. owner[s] changes only under route_locks[s]. submit() reads it and pushes under the
+   same lock, so each event lands in the queue of the shard that owned s at the push.
+2. A shard applies its queue in FIFO order. Events for one symbol are applied in
+   submission order (per producer thread) across migrations, and Instrument::sequence
+   numbers them.
+3. At most one migration per symbol is in flight (migrating[s]); in_flight counts them.
+4. Instruments are only touched by their current shard's thread while the router runs;
+   instrument() is for use after stop(). Live output goes through the publishers set per
+   symbol with set_publishers(); they travel with the engine when the symbol migrates, so
+   one symbol's trades and depth reach them in sequence from one thread at a time.
+*/
+
+#ifndef SHARD_ROUTER_HPP
+#define SHARD_ROUTER_HPP //ShardRouter.hpp
+
+#include "MatchingEngine.hpp"
+#include "SymbolRegistry.hpp"
+#include "EventQueue.hpp"
+#include "FeeCalculator/FeeAggregator.hpp"
+#include<atomic>
+#include<chrono>
+#include<deque>
+#include<memory>
+#include<mutex>
+#include<optional>
+#include<string_view>
+#include<thread>
+#include<unordered_map>
+#include<utility>
+#include<vector>
+
+namespace MatchEngine{
+
+struct ShardRouter;
+
+// Where a symbol's trades and market data go; null for none
+struct InstrumentPublishers{
+    TradePublisher* trades=nullptr;
+    MarketDataPublisher* market_data=nullptr;
+};
+
+struct Instrument{
+    SymbolId symbol;
+    OrderBook book;
+    MatchingEngine engine;
+    uint64_t sequence=0;        // events applied to this symbol
+
+    Instrument(SymbolId s, FeeCalculator& fees) : symbol(s), engine(book, fees) {}
+};
+
+struct EngineShard{
+    uint32_t index;
+    int cpu=-1;                 // core to pin to; -1 leaves placement to the OS
+    // Clock of this shard's engines, fee merges and expiry polls (e.g. a VirtualClock for
+    // replay); null reads the thread's TSC clock. Set before start(), one per shard
+    TimeUtils::Clock* clock=nullptr;
+    EventQueue queue;
+    FeeCalculator fees;
+    ShardRouter& router;
+
+    std::vector<std::unique_ptr<Instrument>> instruments;  // by SymbolId, null if not here
+    std::vector<Instrument*> active;                       // non-null entries, for expiry
+    bool timers=false;          // some instrument may have DAY/GTD orders resting
+
+    std::atomic<uint64_t> processed{0};     // events applied, for telemetry
+
+    EngineShard(uint32_t i, ShardRouter& r) : index(i), router(r) {}
+
+    void run();                 // shard thread body; returns on STOP
+    TimeUtils::Timestamp now_ns(){ return clock ? clock->now_ns() : TimeUtils::now_ns(); }
+    Instrument& instrument(SymbolId symbol);
+
+private:
+    // Symbols migrating in: their events wait here until the book arrives
+    std::unordered_map<SymbolId, std::vector<EngineEvent>> parked;
+
+    // Books handed over by other shards, collected on MIGRATE_IN
+    std::mutex mailbox_mtx;
+    std::vector<std::pair<SymbolId, std::unique_ptr<Instrument>>> mailbox;
+
+    void apply(const EngineEvent& event);
+    void hand_off(SymbolId symbol, uint32_t to);
+    void adopt(SymbolId symbol);
+    void expire_orders();
+};
+
+struct ShardLoad{
+    uint64_t events;            // applied since start
+    double events_per_sec;      // over the last sample interval
+    size_t queue_depth;
+    size_t symbols;             // symbols owned
+};
+
+struct SymbolLoad{
+    SymbolId symbol;
+    uint32_t shard;             // owner when sampled
+    uint64_t events;
+    double events_per_sec;
+};
+
+struct LoadReport{
+    double interval_sec=0.0;
+    std::vector<ShardLoad> shards;
+    std::vector<SymbolLoad> symbols;
+};
+
+struct ShardRouter{
+    SymbolRegistry symbols;
+    FeeAggregator fee_aggregator;
+    std::vector<std::unique_ptr<EngineShard>> shards;
+
+    // pin_cores: shard i runs on core i % hardware_concurrency
+    explicit ShardRouter(size_t shard_count, bool pin_cores=true);
+    ~ShardRouter();
+
+    // Register a symbol and fix its initial shard. Before start()
+    SymbolId add_symbol(std::string_view name);
+    size_t shard_of(SymbolId symbol);
+
+    // Publish symbol's trades and market data. Before start(). Called on whichever shard
+    // owns the symbol, so a publisher shared by several symbols must be thread-safe
+    void set_publishers(SymbolId symbol, TradePublisher* trades, MarketDataPublisher* market_data);
+
+    void start();
+    // Wait for migrations in flight, drain every queue, then join the shards.
+    // Not concurrent with migrate()
+    void stop();
+    bool running() const{ return !threads.empty(); }
+
+    // Any thread. The event is applied on the symbol's shard, in submission order
+    void submit(SymbolId symbol, EngineEvent event);
+
+    // Move symbol's book to shard to. False if the symbol already lives there or a
+    // migration of it is still in flight. Any thread except the shards'
+    bool migrate(SymbolId symbol, uint32_t to);
+    size_t migrations_in_flight() const{ return in_flight.load(std::memory_order_acquire); }
+
+    // Event rates since the previous sample. One sampling thread at a time
+    LoadReport sample();
+
+    // The one move that most lowers the busiest shard's rate, if that shard runs
+    // more than tolerance above the mean
+    static std::optional<std::pair<SymbolId, uint32_t>> pick_move(const LoadReport& report, double tolerance);
+
+    // sample() + pick_move() + migrate(); returns whether a symbol moved
+    bool rebalance(double tolerance=0.2);
+
+    // After stop(): the symbol's book and engine, or null if it never saw an event
+    Instrument* instrument(SymbolId symbol);
+
+private:
+    friend struct EngineShard;
+
+    std::vector<uint32_t> owner;    // SymbolId -> shard
+    std::vector<InstrumentPublishers> publishers;   // by SymbolId; fixed once started
+    // By SymbolId; deques so add_symbol can grow them without moving elements
+    std::deque<std::mutex> route_locks;
+    std::deque<std::atomic<bool>> migrating;
+    std::deque<std::atomic<uint64_t>> symbol_events;    // written by the owning shard
+    std::atomic<size_t> in_flight{0};
+    std::vector<std::thread> threads;
+
+    // Counters at the previous sample
+    std::chrono::steady_clock::time_point last_sample;
+    std::vector<uint64_t> last_shard_events;
+    std::vector<uint64_t> last_symbol_events;
+};
+
+}// namespace MatchEngine
+
+#endif // SHARD_ROUTER_HPP
@@ -0,0 +1,38 @@
+/*
+Symbol registry: instrument names to dense SymbolIds.
+
+Invariants:
+1. Ids are assigned 0, 1, 2, ... in registration order and never reused.
+2. names[id] is the name id was interned from.
+3. Not synchronised: register every symbol before the router starts; lookups after
+   that are read-only and safe from any thread.
+*/
+
+#ifndef SYMBOL_REGISTRY_HPP
+#define SYMBOL_REGISTRY_HPP //SymbolRegistry.hpp
+
+#include "utils/Types.hpp"
+#include<string>
+#include<string_view>
+#include<unordered_map>
+#include<vector>
+
+namespace MatchEngine{
+
+struct SymbolRegistry{
+    // Id for name, assigned on first sight
+    SymbolId intern(std::string_view name);
+    // kNoSymbol if name was never interned
+    SymbolId find(std::string_view name) const;
+
+    const std::string& name(SymbolId id) const{ return names[id]; }
+    size_t size() const{ return names.size(); }
+
+private:
+    std::unordered_map<std::string, SymbolId> ids;
+    std::vector<std::string> names;
+};
+
+}// namespace MatchEngine
+
+#endif // SYMBOL_REGISTRY_HPP
@@ -0,0 +1,128 @@
+/*
+Hierarchical timing wheel for order expiry (GTD / DAY).
+
+Time is cut into ticks of tick_ns. Level k has kSlots slots of kSlots^k ticks each, so four
+levels of 256 cover 2^32 ticks (~49 days at 1 ms). A timer sits at the lowest level whose
+span still separates its deadline from the current tick; when the level below wraps, the
+slot that comes due is cascaded one level down. Each timer is cascaded at most kLevels-1
+times, so insert, remove and expiry are O(1) amortised.
+
+Invariants:
+1. A TimerNode is linked iff it sits in exactly one slot list; slot_index names that slot.
+2. A timer sits at level k only if its deadline tick and now_tick agree above level k's
+   digit, so a slot never holds timers from a later rotation of its level (except
+   parked ones, 3). occupied has a slot's bit set iff the slot list is non-empty.
+3. Deadlines beyond the top level are parked in the top level and re-filed on cascade.
+4. now_tick never moves backward; deadlines at or before it fire on the next advance.
+5. A deadline is filed at the first tick boundary at or after it, so a timer never fires
+   before deadline_ns (and at most one tick after it).
+*/
+
+#ifndef TIMING_WHEEL_HPP
+#define TIMING_WHEEL_HPP //TimingWheel.hpp
+
+#include<cstddef>
+#include<cstdint>
+
+namespace MatchEngine{
+
+struct Order;
+
+// Intrusive wheel entry, embedded in Order
+struct TimerNode{
+    TimerNode* next=nullptr;
+    TimerNode* prev=nullptr;
+    uint64_t deadline_ns=0;
+    Order* order=nullptr;
+    uint16_t slot_index=0;      // level*kSlots+slot, valid while linked
+    bool linked=false;
+
+    // Copies start unlinked; a node's links belong to the wheel it sits in
+    TimerNode()=default;
+    TimerNode(const TimerNode& o) : deadline_ns(o.deadline_ns) {}
+    TimerNode& operator=(const TimerNode& o){ deadline_ns=o.deadline_ns; return *this; }
+};
+
+struct TimingWheel{
+    static constexpr size_t kLevels=4;
+    static constexpr size_t kSlotBits=8;
+    static constexpr size_t kSlots=size_t{1}<<kSlotBits;
+    static constexpr uint64_t kDefaultTickNs=1'000'000;    // 1 ms
+
+    explicit TimingWheel(uint64_t tick=kDefaultTickNs, uint64_t start_ns=0)
+        : tick_ns(tick), now_tick(start_ns/tick) {}
+
+    TimingWheel(const TimingWheel&)=delete;
+    TimingWheel& operator=(const TimingWheel&)=delete;
+
+    // node->deadline_ns must be set; node must not be linked
+    void insert(TimerNode* node);
+    void remove(TimerNode* node);
+
+    // Move the wheel to now_ns, calling fire(TimerNode*) for every timer due by then.
+    // Each node is unlinked before fire runs; fire may insert or remove other timers.
+    // Idle stretches are skipped in one step: the wheel jumps to the next occupied slot.
+    template<class F>
+    size_t advance(uint64_t now_ns, F&& fire);
+
+    size_t size() const{ return count; }
+    bool empty() const{ return count==0; }
+    uint64_t tick() const{ return tick_ns; }
+    uint64_t now() const{ return now_tick*tick_ns; }
+
+private:
+    uint64_t tick_ns;
+    uint64_t now_tick;
+    size_t count=0;
+    TimerNode* slots[kLevels*kSlots]={};
+    uint64_t occupied[kLevels][kSlots/64]={};
+
+    void file(TimerNode* node, uint64_t deadline_tick);
+    // Rounded up: advance fires ticks whose start is <= now_ns
+    uint64_t deadline_tick(const TimerNode* node) const{
+        return node->deadline_ns/tick_ns+(node->deadline_ns%tick_ns!=0);
+    }
+    void link(TimerNode* node, size_t index);
+    // First tick after now_tick that fires or cascades an occupied slot
+    uint64_t next_due_tick() const;
+    size_t next_occupied(size_t level, size_t from) const;
+    void cascade();
+    template<class F>
+    size_t fire_slot(size_t slot, F& fire);
+};
+
+template<class F>
+size_t TimingWheel::advance(uint64_t now_ns, F&& fire){
+    uint64_t target=now_ns/tick_ns;
+    size_t fired=0;
+    while(now_tick<target){
+        if(count==0){
+            now_tick=target;
+            break;
+        }
+        uint64_t due=next_due_tick();
+        if(due>target){
+            now_tick=target;
+            break;
+        }
+        now_tick=due;
+        if((now_tick & (kSlots-1))==0) cascade();
+        fired+=fire_slot(static_cast<size_t>(now_tick & (kSlots-1)), fire);
+    }
+    return fired;
+}
+
+template<class F>
+size_t TimingWheel::fire_slot(size_t slot, F& fire){
+    size_t fired=0;
+    while(TimerNode* node=slots[slot]){
+        remove(node);
+        fire(node);
+        ++fired;
+    }
+    return fired;
+}
+
+}// namespace MatchEngine
+
+#endif // TIMING_WHEEL_HPP
@@ -0,0 +1,91 @@
+/*
+Trailing stop index.
+
+A sell trailing stop triggers when the price falls `trail` below the highest trade price
+seen since it was placed (its high-water mark); a buy stop mirrors this on the low-water
+mark. Buy stops are kept in the same structure on negated prices, so everything below is
+written for the sell (high-water) case.
+
+A stop's mark is the running max of trades since its placement, so stops placed between
+the same trades share one mark. They form a MarkClass, and classes stack oldest (highest
+mark) to newest (lowest mark). A trade at p lifts every class with mark <= p to p: those
+are the newest classes, and they merge into one (smaller into larger). No stop is
+rewritten. A class fires from its smallest trail, so `triggers` orders classes by
+mark - smallest trail and a trade inspects only classes that actually fire.
+
+Invariants:
+1. stack marks strictly decrease from front (oldest) to back (newest).
+2. Every non-empty class has exactly one entry in triggers, keyed by its key;
+   empty classes are erased.
+3. A stop's trigger price is its class mark - trail (negated back for buys).
+*/
+
+#ifndef TRAILING_STOPS_HPP
+#define TRAILING_STOPS_HPP //TrailingStops.hpp
+
+#include "Order.hpp"
+#include<cstdint>
+#include<initializer_list>
+#include<list>
+#include<map>
+#include<set>
+#include<string>
+#include<utility>
+#include<vector>
+
+namespace MatchEngine{
+
+struct TrailingStops{
+    // last_trade_price <= 0: no trade yet, the mark starts at the first trade
+    void add(Order* order, double last_trade_price);
+
+    // Lift marks to price, then append every stop it triggers to fired, setting each
+    // order's stop_price to its trigger price. O(log C) per fired stop plus merges.
+    void on_trade(double price, std::vector<Order*>& fired);
+
+    // Take every stop of user_id on side out of the index, appending them to removed.
+    // O(stops on that side); for mass cancel, not the trade path
+    void remove_user(const std::string& user_id, Side side, std::vector<Order*>& removed);
+
+    size_t size() const{ return sells.count+buys.count; }
+    bool empty() const{ return size()==0; }
+    size_t mark_classes() const{ return sells.stack.size()+buys.stack.size(); }
+
+    template<class F>
+    void for_each(F&& f) const{
+        for(const Index* index : {&sells, &buys}){
+            for(const MarkClass& c : index->stack){
+                for(const auto& stop : c.stops) f(stop.second);
+            }
+        }
+    }
+
+private:
+    struct MarkClass{
+        double mark;
+        double key;                                   // mark - smallest trail
+        std::map<std::pair<double, uint64_t>, Order*> stops;   // by (trail, placement), FIFO among equals
+        std::list<MarkClass>::iterator self;
+    };
+
+    // One direction in high-water form
+    struct Index{
+        std::list<MarkClass> stack;
+        std::set<std::pair<double, MarkClass*>> triggers;
+        size_t count=0;
+        uint64_t placed=0;                            // placement sequence; survives merges
+
+        void add(Order* order, double mark);
+        void lift(double value);
+        void fire(double value, double sign, std::vector<Order*>& fired);
+        void remove_user(const std::string& user_id, std::vector<Order*>& removed);
+        void rekey(MarkClass& c);
+    };
+
+    Index sells;    // prices
+    Index buys;     // negated prices
+};
+
+}// namespace MatchEngine
+
+#endif // TRAILING_STOPS_HPP
@@ -11,6 +11,18 @@ struct BBO {
     bool has_ask = false;
     double ask_price = 0.0;
     uint64_t ask_quantity = 0;
+
+    bool operator==(const BBO&) const = default;
+};
+
+// Published top of book. sequence increases by one per emitted update,
+// so consumers can detect gaps. event_sequence/engine_ts are the stamp of the
+// event (or last event of the batch) that moved it.
+struct BBOUpdate {
+    uint64_t sequence = 0;
+    BBO bbo;
+    uint64_t event_sequence = 0;
+    uint64_t engine_ts = 0;
 };
 
 }
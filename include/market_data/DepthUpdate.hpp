@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include "utils/Types.hpp"
+
+namespace MatchEngine {
+
+// Aggregated quantity at one price level after a change.
+// quantity == 0 means the level was removed from the book.
+struct DepthUpdate {
+    Side side = Side::BUY;
+    double price = 0.0;
+    uint64_t quantity = 0;
+    uint64_t event_sequence = 0;    // stamp of the engine event that changed the level
+    uint64_t engine_ts = 0;
+};
+
+}
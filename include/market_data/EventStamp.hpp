@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+
+namespace MatchEngine {
+
+// Taken once when an engine event enters processing and shared by everything it causes:
+// fills, order status changes, depth and BBO updates. sequence increases by one per
+// stamped event, so a consumer that sees every event can detect gaps.
+struct EventStamp {
+    uint64_t sequence = 0;      // 0: not stamped
+    uint64_t engine_ns = 0;     // engine clock (TimeUtils::now_ns)
+    uint64_t wall_ns = 0;       // UTC, same tick reading
+};
+
+}
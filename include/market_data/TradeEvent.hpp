@@ -27,7 +27,9 @@ struct TradeEvent{
     TimeUtils::Timestamp wall_ts;
 
     double maker_fee;
-    double taker_fee;    
+    double taker_fee;
+
+    uint64_t event_sequence = 0;    // shared by every fill of one engine event
 };
 
 } // namespace MatchEngine
@@ -0,0 +1,51 @@
+/*
+Invariants:
+1. An update is forwarded only if it differs from the last forwarded BBO (price or quantity, either side).
+2. Forwarded updates carry consecutive sequence numbers starting at 1.
+3. The first offer after construction or reset is always forwarded.
+4. No mutation of engine/book state.
+*/
+
+#ifndef CONFLATING_BBO_PUBLISHER_HPP
+#define CONFLATING_BBO_PUBLISHER_HPP
+
+#include "MarketDataPublisher.hpp"
+#include "../market_data/EventStamp.hpp"
+#include <cstdint>
+
+namespace MatchEngine{
+
+struct ConflatingBBOPublisher{
+    MarketDataPublisher* downstream=nullptr;
+
+    bool has_last=false;
+    BBO last{};
+    uint64_t sequence=0;
+
+    // Counters
+    uint64_t offered=0;
+    uint64_t suppressed=0;
+
+    // Returns true if the BBO changed and was forwarded, tagged with stamp
+    bool offer(const BBO& bbo, const EventStamp& stamp={}){
+        ++offered;
+        if(has_last && bbo==last){
+            ++suppressed;
+            return false;
+        }
+        has_last=true;
+        last=bbo;
+        ++sequence;
+        if(downstream) downstream->publish_bbo(BBOUpdate{sequence, bbo, stamp.sequence, stamp.engine_ns});
+        return true;
+    }
+
+    // Forget the last BBO so the next offer is forwarded (e.g. after a reader resync)
+    void reset(){
+        has_last=false;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,40 @@
+/*
+Invariants:
+1. Depth updates are emitted in the order the book mutates, one per level change.
+2. A depth update with quantity 0 is the last update for that level until it is re-created.
+3. BBO is emitted by the engine at most once per processed event (or batch), only when it changed.
+4. Publishers never mutate engine/book state.
+*/
+
+#ifndef MARKET_DATA_PUBLISHER_HPP
+#define MARKET_DATA_PUBLISHER_HPP
+
+#include "../market_data/BBO.hpp"
+#include "../market_data/DepthUpdate.hpp"
+#include <vector>
+
+namespace MatchEngine{
+
+struct MarketDataPublisher{
+    virtual ~MarketDataPublisher()=default;
+    virtual void publish_bbo(const BBOUpdate& update)=0;
+    virtual void publish_depth(const DepthUpdate& update)=0;
+};
+
+struct InMemoryMarketDataPublisher: public MarketDataPublisher{
+    std::vector<BBOUpdate> bbo_updates;
+    std::vector<DepthUpdate> depth_updates;
+
+    void publish_bbo(const BBOUpdate& update) override{
+        bbo_updates.push_back(update);
+    }
+
+    void publish_depth(const DepthUpdate& update) override{
+        depth_updates.push_back(update);
+    }
+};
+
+}
+
+
+#endif
@@ -0,0 +1,55 @@
+/*
+Invariants:
+1. Single writer: only the engine thread calls publish/publish_bbo/publish_depth.
+2. Each publish is one slot write; readers copy the slot, nothing else is allocated.
+3. The publisher owns the shm segment and unlinks it on close.
+*/
+
+#ifndef SHM_MARKET_DATA_PUBLISHER_HPP
+#define SHM_MARKET_DATA_PUBLISHER_HPP
+
+#include "TradePublisher.hpp"
+#include "MarketDataPublisher.hpp"
+#include "ShmRing.hpp"
+#include <string>
+
+namespace MatchEngine{
+
+struct ShmMarketDataPublisher: public TradePublisher, public MarketDataPublisher{
+    ShmMarketDataPublisher()=default;
+    ~ShmMarketDataPublisher() override;
+
+    ShmMarketDataPublisher(const ShmMarketDataPublisher&)=delete;
+    ShmMarketDataPublisher& operator=(const ShmMarketDataPublisher&)=delete;
+
+    // Create (or recreate) the named segment. capacity must be a power of two.
+    bool open(const std::string& name, uint32_t capacity);
+    void close();
+
+    bool is_open() const{
+        return header!=nullptr;
+    }
+
+    void publish(const TradeEvent& trade) override;
+    void publish_bbo(const BBOUpdate& update) override;
+    void publish_depth(const DepthUpdate& update) override;
+
+    uint64_t published() const{
+        return next_sequence;
+    }
+
+private:
+    ShmRingHeader* header=nullptr;
+    ShmSlot* slots=nullptr;
+    uint64_t mask=0;
+    uint64_t next_sequence=0;
+    size_t mapped_bytes=0;
+    std::string segment_name;
+
+    ShmMessage& begin_write(ShmMessageType type);
+    void commit_write();
+};
+
+}// namespace MatchEngine
+
+#endif // SHM_MARKET_DATA_PUBLISHER_HPP
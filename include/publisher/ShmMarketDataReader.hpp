@@ -0,0 +1,66 @@
+/*
+Invariants:
+1. A reader starts at the live edge of the ring on attach; history is not replayed.
+2. poll never blocks and never writes to ring slots.
+3. LAPPED is reported (and the cursor left in place) until resync is called.
+4. The reader's cursor is mirrored into its ShmReaderSlot after every successful read.
+*/
+
+#ifndef SHM_MARKET_DATA_READER_HPP
+#define SHM_MARKET_DATA_READER_HPP
+
+#include "ShmRing.hpp"
+#include <string>
+
+namespace MatchEngine{
+
+enum class ShmReadResult:uint8_t{
+    OK,
+    EMPTY,
+    LAPPED
+};
+
+struct ShmMarketDataReader{
+    ShmMarketDataReader()=default;
+    ~ShmMarketDataReader();
+
+    ShmMarketDataReader(const ShmMarketDataReader&)=delete;
+    ShmMarketDataReader& operator=(const ShmMarketDataReader&)=delete;
+
+    // Map an existing segment and claim a reader slot. Fails if the segment is
+    // missing, has an unexpected layout, or all reader slots are taken.
+    bool attach(const std::string& name);
+    void detach();
+
+    bool is_attached() const{
+        return header!=nullptr;
+    }
+
+    ShmReadResult poll(ShmMessage& out);
+
+    // Skip to the live edge after being lapped; returns the number of messages lost.
+    uint64_t resync();
+
+    uint64_t cursor() const{
+        return next_sequence;
+    }
+
+    // Messages lost to laps since attach: the sequence distance skipped by every resync
+    uint64_t lapped_messages() const{
+        return lapped;
+    }
+
+private:
+    ShmRingHeader* header=nullptr;
+    ShmSlot* slots=nullptr;
+    ShmReaderSlot* reader_slot=nullptr;
+    uint64_t capacity=0;
+    uint64_t mask=0;
+    uint64_t next_sequence=0;
+    uint64_t lapped=0;
+    size_t mapped_bytes=0;
+};
+
+}// namespace MatchEngine
+
+#endif // SHM_MARKET_DATA_READER_HPP
@@ -0,0 +1,149 @@
+/*
+Shared-memory ring layout shared by ShmMarketDataPublisher (single writer)
+and ShmMarketDataReader (any number of readers, up to kShmMaxReaders attached).
+
+Invariants:
+1. Exactly one writer per ring. Readers never write to slots.
+2. capacity is a power of two; message n lives in slot (n & (capacity-1)).
+3. slot.sequence == n+1 once message n is fully written, kShmSlotBusy while it is being written.
+4. header.write_sequence == number of committed messages; it only grows.
+5. A reader whose cursor falls more than capacity behind write_sequence has been lapped.
+6. The writer never waits on readers; reader cursors are published for monitoring only.
+*/
+
+#ifndef SHM_RING_HPP
+#define SHM_RING_HPP
+
+#include "../market_data/BBO.hpp"
+#include "../market_data/DepthUpdate.hpp"
+#include "../market_data/TradeEvent.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace MatchEngine{
+
+inline constexpr uint64_t kShmRingMagic=0x4D45524E47524E31ULL; // "MERNGRN1"
+inline constexpr uint32_t kShmRingVersion=3;
+inline constexpr uint32_t kShmMaxReaders=16;
+inline constexpr uint64_t kShmSlotBusy=~0ULL;
+inline constexpr size_t kShmIdLength=32;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shm ring needs lock-free 64-bit atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shm ring needs lock-free 32-bit atomics");
+
+enum class ShmMessageType:uint8_t{
+    TRADE,
+    BBO,
+    DEPTH
+};
+
+// Fixed-size, pointer-free mirrors of the market data structs.
+// Ids longer than kShmIdLength-1 characters are truncated.
+struct ShmTradeRecord{
+    char user_id[kShmIdLength];
+    char buy_order_id[kShmIdLength];
+    char sell_order_id[kShmIdLength];
+    double price;
+    uint64_t quantity;
+    uint64_t engine_ts;
+    uint64_t wall_ts;
+    double maker_fee;
+    double taker_fee;
+    uint64_t event_sequence;
+};
+
+struct ShmBBORecord{
+    uint64_t sequence;
+    uint8_t has_bid;
+    uint8_t has_ask;
+    double bid_price;
+    uint64_t bid_quantity;
+    double ask_price;
+    uint64_t ask_quantity;
+    uint64_t event_sequence;
+    uint64_t engine_ts;
+};
+
+struct ShmDepthRecord{
+    Side side;
+    double price;
+    uint64_t quantity;
+    uint64_t event_sequence;
+    uint64_t engine_ts;
+};
+
+struct ShmMessage{
+    ShmMessageType type;
+    union{
+        ShmTradeRecord trade;
+        ShmBBORecord bbo;
+        ShmDepthRecord depth;
+    };
+
+    TradeEvent to_trade_event() const{
+        return TradeEvent{
+            trade.user_id,
+            trade.buy_order_id,
+            trade.sell_order_id,
+            trade.price,
+            trade.quantity,
+            trade.engine_ts,
+            trade.wall_ts,
+            trade.maker_fee,
+            trade.taker_fee,
+            trade.event_sequence
+        };
+    }
+
+    BBOUpdate to_bbo_update() const{
+        BBOUpdate out{};
+        out.sequence=bbo.sequence;
+        out.bbo.has_bid=bbo.has_bid!=0;
+        out.bbo.bid_price=bbo.bid_price;
+        out.bbo.bid_quantity=bbo.bid_quantity;
+        out.bbo.has_ask=bbo.has_ask!=0;
+        out.bbo.ask_price=bbo.ask_price;
+        out.bbo.ask_quantity=bbo.ask_quantity;
+        out.event_sequence=bbo.event_sequence;
+        out.engine_ts=bbo.engine_ts;
+        return out;
+    }
+
+    DepthUpdate to_depth_update() const{
+        return DepthUpdate{depth.side, depth.price, depth.quantity, depth.event_sequence, depth.engine_ts};
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<ShmMessage>, "ShmMessage is copied with memcpy");
+
+struct alignas(64) ShmSlot{
+    std::atomic<uint64_t> sequence;
+    ShmMessage message;
+};
+
+struct alignas(64) ShmReaderSlot{
+    std::atomic<uint32_t> active;
+    std::atomic<uint64_t> cursor;
+};
+
+struct alignas(64) ShmRingHeader{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    alignas(64) std::atomic<uint64_t> write_sequence;
+    ShmReaderSlot readers[kShmMaxReaders];
+};
+
+inline size_t shm_ring_bytes(uint32_t capacity){
+    return sizeof(ShmRingHeader)+static_cast<size_t>(capacity)*sizeof(ShmSlot);
+}
+
+inline ShmSlot* shm_ring_slots(ShmRingHeader* header){
+    return reinterpret_cast<ShmSlot*>(reinterpret_cast<unsigned char*>(header)+sizeof(ShmRingHeader));
+}
+
+}// namespace MatchEngine
+
+#endif // SHM_RING_HPP
@@ -2,6 +2,7 @@
 
 #include "core/OrderBook.hpp"
 #include "core/MatchingEngine.hpp"
+#include "core/CompactBook.hpp"
 #include "FeeCalculator/FeeCalculator.hpp"
 #include "publisher/TradePublisher.hpp"
 #include "core/EventQueue.hpp"
@@ -37,6 +38,30 @@ public:
     void run_order_timestamp_test();
     void run_event_queue_engine_test();
     void run_combined_test();
+    void run_shm_market_data_test();
+    void run_bbo_conflation_test();
+    void run_depth_index_test();
+    void run_level_array_test();
+    void run_level_container_test();
+    void run_level_list_test();
+    void run_level_cache_test();
+    void run_compact_book_test();
+    void run_modify_order_test();
+    void run_mass_quote_test();
+    void run_mass_cancel_test();
+    void run_order_expiry_test();
+    void run_peg_order_test();
+    void run_trailing_stop_test();
+    void run_fee_interning_test();
+    void run_fee_ledger_test();
+    void run_rolling_volume_test();
+    void run_fee_aggregation_test();
+    void run_shard_router_test();
+    void run_shard_migration_test();
+    void run_tsc_clock_test();
+    void run_event_stamp_test();
+    void run_virtual_clock_test();
+    void run_iso8601_test();
 
 private:
     MatchEngine::FeeCalculator          fee_calculator;  // must precede engine
@@ -66,4 +91,28 @@ inline void run_all_tests() {
     OrderBookTest{}.run_order_timestamp_test();
     OrderBookTest{}.run_event_queue_engine_test();
     OrderBookTest{}.run_combined_test();
+    OrderBookTest{}.run_shm_market_data_test();
+    OrderBookTest{}.run_bbo_conflation_test();
+    OrderBookTest{}.run_depth_index_test();
+    OrderBookTest{}.run_level_array_test();
+    OrderBookTest{}.run_level_container_test();
+    OrderBookTest{}.run_level_list_test();
+    OrderBookTest{}.run_level_cache_test();
+    OrderBookTest{}.run_compact_book_test();
+    OrderBookTest{}.run_modify_order_test();
+    OrderBookTest{}.run_mass_quote_test();
+    OrderBookTest{}.run_mass_cancel_test();
+    OrderBookTest{}.run_order_expiry_test();
+    OrderBookTest{}.run_peg_order_test();
+    OrderBookTest{}.run_trailing_stop_test();
+    OrderBookTest{}.run_fee_interning_test();
+    OrderBookTest{}.run_fee_ledger_test();
+    OrderBookTest{}.run_rolling_volume_test();
+    OrderBookTest{}.run_fee_aggregation_test();
+    OrderBookTest{}.run_shard_router_test();
+    OrderBookTest{}.run_shard_migration_test();
+    OrderBookTest{}.run_tsc_clock_test();
+    OrderBookTest{}.run_event_stamp_test();
+    OrderBookTest{}.run_virtual_clock_test();
+    OrderBookTest{}.run_iso8601_test();
 }
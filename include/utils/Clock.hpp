@@ -0,0 +1,68 @@
+/*
+Injectable engine clock.
+
+An engine without a clock reads the thread's TSC clock (TimeUtils::now_both). A Clock
+set on it replaces every read the engine makes: event stamps and the expiry poll.
+VirtualClock only moves when told to, by the driver or by the recorded time of each
+replayed event (EngineEvent::time_ns), so a session replays at full CPU speed and
+produces the same stamps, and so the same outputs, on every run.
+
+Invariants:
+1. read() never goes backwards. VirtualClock may return the same time repeatedly;
+   FIFO priority comes from queue order, never from timestamps.
+2. A clock is read only by the engine thread that owns it.
+*/
+
+#ifndef CLOCK_HPP
+#define CLOCK_HPP // Clock.hpp
+
+#include "utils/TimeUtils.hpp"
+#include<cstdint>
+
+namespace MatchEngine::TimeUtils{
+
+struct Clock{
+    virtual ~Clock()=default;
+
+    // Engine and wall time of one reading
+    virtual void read(Timestamp& engine_ns, uint64_t& wall_ns)=0;
+
+    // Recorded time of a replayed event; live clocks ignore it
+    virtual void observe(Timestamp event_ns){ (void)event_ns; }
+
+    Timestamp now_ns(){
+        Timestamp engine_ns;
+        uint64_t wall_ns;
+        read(engine_ns, wall_ns);
+        return engine_ns;
+    }
+};
+
+// Time stands still between advances; wall time is engine time plus a fixed offset
+struct VirtualClock final: Clock{
+    Timestamp engine_ns=0;
+    int64_t wall_offset_ns=0;
+
+    explicit VirtualClock(Timestamp start_ns=0, int64_t wall_offset=0)
+        :engine_ns(start_ns), wall_offset_ns(wall_offset){}
+
+    // Never moves back: late or unordered replay times keep the current time
+    void advance_to(Timestamp t){
+        if(t>engine_ns) engine_ns=t;
+    }
+    void advance(Timestamp delta){
+        engine_ns+=delta;
+    }
+
+    void read(Timestamp& e, uint64_t& w) override{
+        e=engine_ns;
+        w=static_cast<uint64_t>(static_cast<int64_t>(engine_ns)+wall_offset_ns);
+    }
+    void observe(Timestamp event_ns) override{
+        advance_to(event_ns);
+    }
+};
+
+} // namespace MatchEngine::TimeUtils
+
+#endif // CLOCK_HPP
@@ -1,6 +1,9 @@
 /*
  Invariants:
-1. Monotonic for ordering :- Within a single process, event timestamps must not go backward.
+1. Monotonic for ordering :- Within a thread, readings strictly increase; an engine
+   clamps its event stamps so they strictly increase across threads too (see
+   TscClock.hpp). An engine given a VirtualClock (Clock.hpp) reads that instead, and
+   its timestamps never decrease (they may repeat).
 Required for:
     FIFO tie-breaking
     Trade sequencing
@@ -10,7 +13,8 @@ Required for:
     Internally: always UTC.
     API layer: output ISO-8601 in Z format.
     If business insists on IST → convert at serialization only.
-4. Format: YYYY-MM-DDTHH:MM:SS.ssssssZ
+4. Format: YYYY-MM-DDTHH:MM:SS.ssssssZ (nanosecond variant: .sssssssssZ), fixed width,
+   fraction truncated.
 */
 
 #pragma once
@@ -18,6 +22,7 @@ Required for:
 #include<chrono>
 #include<string>
 #include "utils/Types.hpp"
+#include "utils/TscClock.hpp"
 
 namespace MatchEngine::TimeUtils{
     
@@ -25,12 +30,41 @@ using EngineClock=std::chrono::steady_clock; // Monotonic time (for ordering)
 using WallClock=std::chrono::system_clock; // UTC time (for logging)
 using Timestamp=uint64_t;
 
-// Get current time in UTC
-Timestamp now_ns();
+// Engine time: steady_clock nanoseconds read off the thread's TSC clock
+inline Timestamp now_ns(){ return this_thread_clock.now_ns(); }
 
-uint64_t wall_time_ns();   // system_clock nanoseconds since epoch
+// system_clock nanoseconds since epoch, on the same tick reading
+inline uint64_t wall_time_ns(){ return this_thread_clock.wall_ns(); }
+
+// Both of the above for the price of one read
+inline void now_both(Timestamp& engine_ns, uint64_t& wall_ns){ this_thread_clock.now(engine_ns, wall_ns); }
 
 std::string to_iso8601(Timestamp timestamp_ns);// expects WALL clock timestamp
+std::string to_iso8601_ns(Timestamp timestamp_ns);
+
+inline constexpr size_t kIso8601Length=27;      // YYYY-MM-DDTHH:MM:SS.ssssssZ
+inline constexpr size_t kIso8601NsLength=30;    // YYYY-MM-DDTHH:MM:SS.sssssssssZ
+
+// Formats wall timestamps into a caller buffer: no allocation, no gmtime, no locale.
+// The "YYYY-MM-DDTHH:MM:SS" prefix of the last second seen is cached, so a stream of
+// timestamps within one second costs only the fraction digits. Not thread-safe: keep
+// one per writer (format_iso8601 uses a thread_local one).
+struct Iso8601Formatter{
+    uint64_t cached_second=~0ULL;
+    char prefix[19];
+
+    // Write exactly kIso8601Length / kIso8601NsLength chars (no terminator); return the count
+    size_t format(Timestamp wall_ns, char* out);
+    size_t format_ns(Timestamp wall_ns, char* out);
+
+private:
+    void refresh(uint64_t second);
+};
+
+inline thread_local Iso8601Formatter this_thread_iso8601;
+
+inline size_t format_iso8601(Timestamp wall_ns, char* out){ return this_thread_iso8601.format(wall_ns, out); }
+inline size_t format_iso8601_ns(Timestamp wall_ns, char* out){ return this_thread_iso8601.format_ns(wall_ns, out); }
 
 class OrderIdGenerator {
 private:
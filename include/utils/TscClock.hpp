@@ -0,0 +1,110 @@
+/*
+Per-thread TSC clock behind TimeUtils::now_ns / wall_time_ns.
+
+A read is one rdtsc, a multiply and an add against the calling thread's copy of a
+process-wide calibration: a (tsc, steady_clock, wall offset) anchor plus ns per tick.
+The first use calibrates over kInitialCalibrationNs. After that, whichever thread
+first finds the calibration kRecalibrationNs old refits the rate over the whole
+baseline since the first anchor and re-anchors to steady_clock and system_clock. Other
+threads pick the new calibration up at their next sync, every kSyncNs of their own
+reads. Without an invariant TSC the same code runs on steady_clock readings.
+
+Invariants:
+1. now_ns() is strictly increasing per thread; there is no shared "last" value. An
+   engine can move between shard threads, so it keeps its own last stamp and clamps
+   each new one above it (BasicMatchingEngine::begin_event).
+2. Threads map ticks with the same calibration, except for up to kSyncNs after a
+   recalibration, so cross-thread readings agree to within TSC skew plus that drift.
+3. The calibration mutex is taken only at sync, never per read.
+*/
+
+#ifndef TSC_CLOCK_HPP
+#define TSC_CLOCK_HPP // TscClock.hpp
+
+#include<cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include<x86intrin.h>
+#endif
+
+namespace MatchEngine::TimeUtils{
+
+inline constexpr uint64_t kInitialCalibrationNs=2'000'000;      // 2 ms
+inline constexpr uint64_t kRecalibrationNs=1'000'000'000;       // 1 s
+inline constexpr uint64_t kSyncNs=100'000'000;                  // 100 ms
+
+struct ClockCalibration{
+    uint64_t tsc=0;             // anchor tick
+    uint64_t steady_ns=0;       // steady_clock at the anchor
+    int64_t wall_offset_ns=0;   // system_clock - steady_clock at the anchor
+    double ns_per_tick=1.0;
+    uint64_t sync_ticks=0;      // kSyncNs in ticks
+    bool use_tsc=false;         // false: "ticks" are steady_clock nanoseconds
+};
+
+// True if the CPU reports an invariant TSC; decided once
+bool tsc_available();
+
+// Current calibration, recalibrating first if it is due (or forced)
+ClockCalibration current_calibration(bool force=false);
+
+inline uint64_t read_ticks(bool use_tsc);
+
+struct ThreadClock{
+    ClockCalibration cal;
+    uint64_t next_sync=0;       // tick at which to refresh cal
+    uint64_t last_ns=0;
+
+    uint64_t now_ns(){
+        uint64_t ticks=read_ticks(cal.use_tsc);
+        if(ticks>=next_sync) ticks=sync();
+        return advance(to_ns(ticks));
+    }
+
+    uint64_t wall_ns(){
+        uint64_t ticks=read_ticks(cal.use_tsc);
+        if(ticks>=next_sync) ticks=sync();
+        return static_cast<uint64_t>(static_cast<int64_t>(to_ns(ticks))+cal.wall_offset_ns);
+    }
+
+    // Engine and wall time off one tick reading (an event stamp)
+    void now(uint64_t& engine_ns, uint64_t& wall_ns){
+        uint64_t ticks=read_ticks(cal.use_tsc);
+        if(ticks>=next_sync) ticks=sync();
+        uint64_t t=to_ns(ticks);
+        wall_ns=static_cast<uint64_t>(static_cast<int64_t>(t)+cal.wall_offset_ns);
+        engine_ns=advance(t);
+    }
+
+    // Refresh cal; returns a fresh tick reading under it
+    uint64_t sync(bool force=false);
+
+private:
+    uint64_t advance(uint64_t t){
+        if(t<=last_ns) t=last_ns+1;
+        last_ns=t;
+        return t;
+    }
+
+    uint64_t to_ns(uint64_t ticks) const{
+        // Ticks read just before a re-anchor can precede it by a little
+        double delta=static_cast<double>(static_cast<int64_t>(ticks-cal.tsc));
+        return cal.steady_ns+static_cast<uint64_t>(static_cast<int64_t>(delta*cal.ns_per_tick));
+    }
+};
+
+inline thread_local ThreadClock this_thread_clock;
+
+uint64_t steady_ns();
+
+inline uint64_t read_ticks(bool use_tsc){
+#if defined(__x86_64__) || defined(__i386__)
+    if(use_tsc) return __rdtsc();
+#endif
+    (void)use_tsc;
+    return steady_ns();
+}
+
+} // namespace MatchEngine::TimeUtils
+
+#endif // TSC_CLOCK_HPP
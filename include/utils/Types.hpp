@@ -5,6 +5,15 @@
 #include <vector>
 
 namespace MatchEngine{
+
+// Dense participant id (FeeCalculator::intern); kNoUser until interned
+using UserIndex=uint32_t;
+inline constexpr UserIndex kNoUser=~UserIndex{0};
+
+// Dense instrument id (SymbolRegistry::intern); kNoSymbol for single-book use
+using SymbolId=uint32_t;
+inline constexpr SymbolId kNoSymbol=~SymbolId{0};
+
 enum class Side:uint8_t{
     BUY,
     SELL
@@ -16,9 +25,25 @@ enum class OrderType:uint8_t{
     IOC,
     FOK,
     STOP_LOSS,
-    STOP_LIMIT
+    STOP_LIMIT,
+    PEG,
+    TRAILING_STOP
+};
+
+// What a PEG order's price follows
+enum class PegReference:uint8_t{
+    NONE,
+    PRIMARY,     // same-side best (buy: best bid, sell: best ask)
+    MID          // midpoint of best bid and best ask
 };
     
+// Resting lifetime of a LIMIT or PEG order; other types never rest
+enum class TimeInForce:uint8_t{
+    GTC,         // good till cancelled
+    DAY,         // expires at the engine's session close
+    GTD          // expires at Order::expire_ns
+};
+
 enum class OrderStatus:uint8_t{
     CREATED,
     OPEN,        
@@ -30,7 +55,14 @@ enum class OrderStatus:uint8_t{
 enum class EventType{
     NEW_ORDER,
     CANCEL_ORDER,
-    STOP
+    MODIFY_ORDER,
+    MASS_QUOTE,
+    MASS_CANCEL,
+    STOP,
+    // Shard control (ShardRouter migration); never reach an engine
+    MIGRATE_EXPECT,
+    MIGRATE_OUT,
+    MIGRATE_IN
 };
 }// namespace MatchEngine
 
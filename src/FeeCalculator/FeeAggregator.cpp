@@ -0,0 +1,108 @@
+#include "FeeCalculator/FeeAggregator.hpp"
+
+#include <algorithm>
+
+namespace MatchEngine {
+
+FeeAggregator::FeeAggregator(uint64_t staleness_ns) : max_staleness_ns(staleness_ns) {
+    publish();
+}
+
+void FeeAggregator::attach(FeeCalculator& shard) {
+    shard.tier_snapshot = current.load();
+}
+
+// O(users the shard touched since its last merge), plus the chunks they fall in
+void FeeAggregator::merge(FeeCalculator& shard, uint64_t now_ns) {
+    std::lock_guard<std::mutex> lock(mutex);
+    advance(shard.today);
+
+    for(const PendingVolume& pending : shard.carried) {
+        add(global_index(shard, pending.user), pending.day, pending.volume);
+    }
+    shard.carried.clear();
+    for(UserIndex user : shard.dirty) {
+        UserFeeState& state = shard.users[user];
+        add(global_index(shard, user), shard.today, state.unmerged - state.queued);
+        state.unmerged = 0;
+        state.queued = 0;
+    }
+    shard.dirty.clear();
+
+    publish();
+    shard.tier_snapshot = current.load();
+    shard.last_merge_ns = now_ns;
+}
+
+UserIndex FeeAggregator::global_index(FeeCalculator& shard, UserIndex user) {
+    UserFeeState& state = shard.users[user];
+    if(state.global_index == kNoUser) {
+        auto [it, inserted] = ids.try_emplace(shard.names[user], static_cast<UserIndex>(windows.size()));
+        if(inserted) windows.emplace_back();
+        state.global_index = it->second;
+    }
+    return state.global_index;
+}
+
+// Move the global day forward, expiring the days that leave the window
+void FeeAggregator::advance(uint32_t day) {
+    if(day <= today) return;
+    uint32_t first = day - today >= kWindowDays ? day - kWindowDays + 1 : today + 1;
+    for(uint32_t d = first; d <= day; ++d) {
+        auto& expiring = touched[d % kWindowDays];
+        for(UserIndex global : expiring) {
+            windows[global].roll(day);
+            changed.push_back(global);
+        }
+        expiring.clear();
+    }
+    today = day;
+}
+
+// Book notional on the day it traded; volume already outside the window is dropped
+void FeeAggregator::add(UserIndex global, uint32_t day, uint64_t notional) {
+    VolumeWindow& window = windows[global];
+    window.roll(today);
+    if(notional == 0 || day + kWindowDays <= today) return;
+    uint64_t& bucket = window.buckets[day % kWindowDays];
+    if(bucket == 0) touched[day % kWindowDays].push_back(global);
+    bucket += notional;
+    window.rolling_volume += notional;
+    changed.push_back(global);
+}
+
+// Copies the chunk table, and only the chunks holding changed entries
+void FeeAggregator::publish() {
+    using Chunk = TierSnapshot::Chunk;
+    constexpr size_t kChunk = TierSnapshot::kChunk;
+
+    auto next = std::make_shared<TierSnapshot>();
+    next->epoch = ++epoch;
+    next->day = today;
+    if(auto prev = current.load()) next->chunks = prev->chunks;
+
+    const size_t shared = next->chunks.size();
+    std::vector<std::shared_ptr<Chunk>> copies((windows.size() + kChunk - 1) / kChunk);
+    next->chunks.resize(copies.size());
+    for(size_t c = shared; c < copies.size(); ++c) next->chunks[c] = copies[c] = std::make_shared<Chunk>();
+
+    for(UserIndex global : changed) {
+        auto& copy = copies[global / kChunk];
+        if(!copy) next->chunks[global / kChunk] = copy = std::make_shared<Chunk>(*next->chunks[global / kChunk]);
+        (*copy)[global % kChunk] = windows[global].rolling_volume;
+    }
+    changed.clear();
+    current.store(std::move(next));
+}
+
+uint64_t FeeAggregator::volume_of(const std::string& user_id) const {
+    UserIndex index = kNoUser;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = ids.find(user_id);
+        if(it != ids.end()) index = it->second;
+    }
+    return current.load()->volume(index);
+}
+
+}// namespace MatchEngine
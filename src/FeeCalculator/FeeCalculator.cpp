@@ -1,44 +1,120 @@
 #include "FeeCalculator/FeeCalculator.hpp"
 
+#include <cassert>
+
 namespace MatchEngine {
 
-FeeCalculator::FeeCalculator() {
+FeeCalculator::FeeCalculator(double tick) : tick_size(tick) {
     tiers = {
-        {0.0,       0.0000, 0.0005},//T0
-        {100000.0, -0.0001, 0.0004},//T1
-        {1000000.0,-0.0002, 0.0003},//T2
+        {notional(0.0, 1),        0, 5},//T0
+        {notional(100000.0, 1),  -1, 4},//T1
+        {notional(1000000.0, 1), -2, 3},//T2
     };
 }
 
+UserIndex FeeCalculator::intern(const std::string& user_id) {
+    auto [it, inserted] = ids.try_emplace(user_id, static_cast<UserIndex>(users.size()));
+    if(inserted) {
+        assert(users.size() < kNoUser);
+        users.emplace_back();
+        names.push_back(user_id);
+    }
+    return it->second;
+}
 
-void FeeCalculator::update_volume(const std::string& user_id, double notional) {
-    auto& state = users[user_id];
-    state.rolling_volume += notional;
+UserIndex FeeCalculator::find(const std::string& user_id) const {
+    auto it = ids.find(user_id);
+    return it == ids.end() ? kNoUser : it->second;
+}
 
-    // Promote tier if needed (monotonic)
-    while(state.tier_index + 1 < tiers.size() &&
-          state.rolling_volume >= tiers[state.tier_index + 1].min_volume) {
-        ++state.tier_index;
+void FeeCalculator::refresh(UserIndex user) {
+    auto& state = users[user];
+    uint64_t epoch = tier_snapshot ? tier_snapshot->epoch : 0;
+    if(state.day == today && state.epoch == epoch) return;
+
+    state.roll(today);
+    state.epoch = epoch;
+    retier(state);
+}
+
+int64_t FeeCalculator::accrue_maker(UserIndex maker, uint64_t notional, bool counts_volume) {
+    refresh(maker);
+    if(counts_volume) add_volume(maker, notional);
+    int64_t fee = static_cast<int64_t>(notional) * tiers[users[maker].tier_index].maker_bps;
+    users[maker].accrued_fees += fee;
+    total_fees += fee;
+    return fee;
+}
+
+void FeeCalculator::commit(const TakerSweep& sweep) {
+    refresh(sweep.user);
+    add_volume(sweep.user, sweep.volume);
+    users[sweep.user].accrued_fees += sweep.fees;
+    total_fees += sweep.fees;
+}
+
+void FeeCalculator::update_volume(UserIndex user, uint64_t notional) {
+    refresh(user);
+    add_volume(user, notional);
+}
+
+// Caller has refreshed user to today
+void FeeCalculator::add_volume(UserIndex user, uint64_t notional) {
+    auto& state = users[user];
+    assert(state.day == today);
+    state.add(notional);
+    if(tier_snapshot && notional > 0) {
+        if(state.unmerged == 0) dirty.push_back(user);
+        state.unmerged += notional;
     }
+    retier(state);
 }
 
-const FeeTier& FeeCalculator::tier_for(const std::string& user_id) const {
-    static FeeTier default_tier{0.0, 0.0000, 0.0005};
+// The day is about to turn with volume unmerged: queue what each user traded today
+void FeeCalculator::carry_pending() {
+    for(UserIndex user : dirty) {
+        auto& state = users[user];
+        uint64_t fresh = state.unmerged - state.queued;
+        if(fresh > 0) carried.push_back(PendingVolume{user, today, fresh});
+        state.queued = state.unmerged;
+    }
+}
 
-    auto it = users.find(user_id);
-    if(it == users.end()) return default_tier;
+uint64_t FeeCalculator::tier_volume(const UserFeeState& state) const {
+    if(!tier_snapshot) return state.rolling_volume;
+    return tier_snapshot->volume(state.global_index) + state.unmerged;
+}
+
+// Highest tier the window volume qualifies for; promotes or demotes
+void FeeCalculator::retier(UserFeeState& state) const {
+    uint64_t volume = tier_volume(state);
+    while(state.tier_index + 1 < tiers.size() && volume >= tiers[state.tier_index + 1].min_volume) {
+        ++state.tier_index;
+    }
+    while(state.tier_index > 0 && volume < tiers[state.tier_index].min_volume) {
+        --state.tier_index;
+    }
+}
+
+// Currency to ledger ticks × lots, the same scale as notional(price, qty)
+void FeeCalculator::update_volume(const std::string& user_id, double notional) {
+    assert(notional >= 0.0);
+    update_volume(intern(user_id), static_cast<uint64_t>(std::llround(notional / tick_size)));
+}
 
-    return tiers[it->second.tier_index];
+const FeeTier& FeeCalculator::tier_for(const std::string& user_id) {
+    UserIndex user = find(user_id);
+    if(user == kNoUser) return tiers[0];
+    refresh(user);
+    return tier_for(user);
 }
 
-double FeeCalculator::maker_fee(const std::string& user_id,double price,uint64_t qty) const {
-    const FeeTier& t = tier_for(user_id);
-    return price * (double)qty * t.maker_fee_rate;
+double FeeCalculator::maker_fee(const std::string& user_id,double price,uint64_t qty) {
+    return to_currency(static_cast<int64_t>(notional(price, qty)) * tier_for(user_id).maker_bps);
 }
 
-double FeeCalculator::taker_fee(const std::string& user_id,double price,uint64_t qty) const {
-    const FeeTier& t = tier_for(user_id);
-    return price * (double)qty * t.taker_fee_rate;
+double FeeCalculator::taker_fee(const std::string& user_id,double price,uint64_t qty) {
+    return to_currency(static_cast<int64_t>(notional(price, qty)) * tier_for(user_id).taker_bps);
 }
 
 
@@ -0,0 +1,163 @@
+// Matching-loop microbenchmark.
+//
+// Seeds both sides of the book, then fires a random mix of LIMIT / MARKET / IOC / FOK
+// aggressors on random sides so side and type branches are unpredictable. Only the
+// aggressive phase is measured. Reports ns, instructions and branch misses per fill
+// (hardware counters via perf_event_open; "n/a" where the kernel does not expose them)
+// and the empty-level cache hit rate; reseeding every round re-opens the same prices.
+//
+// Usage: bench_matching [rounds] [tree|flat|ladder]
+
+#include "core/MatchingEngine.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace MatchEngine;
+
+namespace {
+
+constexpr int kLevels=64;
+constexpr int kOrdersPerLevel=4;
+constexpr int kAggressors=400;
+
+struct PerfCounter{
+    int fd=-1;
+
+    explicit PerfCounter(uint64_t config){
+        perf_event_attr attr{};
+        attr.type=PERF_TYPE_HARDWARE;
+        attr.size=sizeof(attr);
+        attr.config=config;
+        attr.disabled=1;
+        attr.exclude_kernel=1;
+        attr.exclude_hv=1;
+        fd=static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~PerfCounter(){ if(fd>=0) close(fd); }
+
+    void start(){ if(fd>=0) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0); }
+    void stop(){ if(fd>=0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0); }
+    bool read_value(uint64_t& out) const{
+        return fd>=0 && read(fd, &out, sizeof(out))==static_cast<ssize_t>(sizeof(out));
+    }
+};
+
+template<class Book>
+void seed(Book& book, std::vector<Order>& resting, int round){
+    resting.clear();
+    for(int l=0;l<kLevels;++l){
+        for(int k=0;k<kOrdersPerLevel;++k){
+            std::string tag=std::to_string(round)+"_"+std::to_string(l)+"_"+std::to_string(k);
+            resting.emplace_back("maker", "S"+tag, Side::SELL, OrderType::LIMIT, 1000.0+l, 2, 1);
+            book.insert_limit(&resting.back());
+            resting.emplace_back("maker", "B"+tag, Side::BUY, OrderType::LIMIT, 999.0-l, 2, 1);
+            book.insert_limit(&resting.back());
+        }
+    }
+}
+
+void print_per_fill(const char* name, bool ok, uint64_t value, uint64_t fills){
+    if(ok) std::printf("  %-18s %10.2f\n", name, static_cast<double>(value)/static_cast<double>(fills));
+    else std::printf("  %-18s %10s\n", name, "n/a");
+}
+
+template<class Book>
+int run(int rounds, const char* container){
+    Book book;
+    FeeCalculator fees;
+    BasicMatchingEngine<Book> engine(book, fees);
+
+    std::mt19937 rng(42);
+    std::vector<Order> resting;
+    std::vector<Order> aggressors;
+    resting.reserve(2*kLevels*kOrdersPerLevel);
+    aggressors.reserve(kAggressors);
+
+    PerfCounter instructions(PERF_COUNT_HW_INSTRUCTIONS);
+    PerfCounter branch_misses(PERF_COUNT_HW_BRANCH_MISSES);
+
+    uint64_t fills=0;
+    std::chrono::nanoseconds elapsed{0};
+
+    // The first clock read calibrates the TSC (2 ms); keep it out of the timed region
+    TimeUtils::now_ns();
+
+    for(int r=0;r<rounds;++r){
+        seed(book, resting, r);
+
+        aggressors.clear();
+        for(int i=0;i<kAggressors;++i){
+            Side side=(rng()&1) ? Side::BUY : Side::SELL;
+            OrderType type=static_cast<OrderType>(rng()%4); // LIMIT, MARKET, IOC, FOK
+            double price=side==Side::BUY ? 1000.0+kLevels : 999.0-kLevels;
+            uint64_t qty=1+rng()%3;
+            std::string id="A"+std::to_string(r)+"_"+std::to_string(i);
+            if(type==OrderType::MARKET) aggressors.emplace_back(id, side, type, qty, 1);
+            else aggressors.emplace_back("taker", id, side, type, price, qty, 1);
+        }
+
+        size_t t0=engine.trades.size();
+        instructions.start();
+        branch_misses.start();
+        auto begin=std::chrono::steady_clock::now();
+        for(auto& o: aggressors) engine.process_order(&o);
+        auto end=std::chrono::steady_clock::now();
+        branch_misses.stop();
+        instructions.stop();
+
+        elapsed+=end-begin;
+        fills+=engine.trades.size()-t0;
+        engine.trades.clear();
+
+        for(auto& o: resting){
+            if(o.price_level) book.cancel_order(o.order_id);
+        }
+        for(auto& o: aggressors){
+            if(o.price_level) book.cancel_order(o.order_id);
+        }
+    }
+
+    uint64_t ins=0;
+    uint64_t misses=0;
+    bool have_ins=instructions.read_value(ins);
+    bool have_misses=branch_misses.read_value(misses);
+
+    std::printf("bench_matching: %s book, %d rounds, %llu fills\n", container, rounds,
+                static_cast<unsigned long long>(fills));
+    std::printf("  %-18s %10.2f\n", "ns/fill",
+                static_cast<double>(elapsed.count())/static_cast<double>(fills));
+    print_per_fill("instructions/fill", have_ins, ins, fills);
+    print_per_fill("branch-miss/fill", have_misses, misses, fills);
+
+    const LevelCacheStats& cache=book.level_cache_stats;
+    uint64_t opened=cache.hits+cache.misses;
+    std::printf("  %-18s %9.1f%%  (%llu hits, %llu misses, %llu evictions)\n", "level-cache hits",
+                opened ? 100.0*static_cast<double>(cache.hits)/static_cast<double>(opened) : 0.0,
+                static_cast<unsigned long long>(cache.hits), static_cast<unsigned long long>(cache.misses),
+                static_cast<unsigned long long>(cache.evictions));
+    return 0;
+}
+
+}// namespace
+
+int main(int argc, char** argv){
+    int rounds=argc>1 ? std::atoi(argv[1]) : 200;
+    const char* container=argc>2 ? argv[2] : "tree";
+
+    if(std::strcmp(container, "tree")==0) return run<OrderBook>(rounds, container);
+    if(std::strcmp(container, "flat")==0) return run<FlatOrderBook>(rounds, container);
+    if(std::strcmp(container, "ladder")==0) return run<TickLadderOrderBook>(rounds, container);
+    std::fprintf(stderr, "unknown container '%s' (tree|flat|ladder)\n", container);
+    return 1;
+}
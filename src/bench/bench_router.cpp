@@ -0,0 +1,52 @@
+// Multi-instrument throughput benchmark.
+//
+// Queues a random LIMIT flow over many symbols, then starts the router and times how
+// long the shards take to drain it. Producers are kept out of the measurement, so the
+// result is engine throughput per shard count; it should scale with cores until shards
+// outnumber them.
+//
+// Usage: bench_router [shards] [symbols] [events]
+
+#include "core/ShardRouter.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <string>
+
+using namespace MatchEngine;
+
+int main(int argc, char** argv){
+    size_t shard_count=argc>1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+    size_t symbol_count=argc>2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+    size_t events=argc>3 ? std::strtoul(argv[3], nullptr, 10) : 1'000'000;
+
+    ShardRouter router(shard_count);
+    for(size_t s=0;s<symbol_count;++s) router.add_symbol("SYM"+std::to_string(s));
+
+    std::deque<Order> orders;
+    std::mt19937 rng(7);
+    for(size_t i=0;i<events;++i){
+        Side side=rng()%2 ? Side::BUY : Side::SELL;
+        double px=100.0+static_cast<double>(rng()%20)*0.01;
+        orders.emplace_back("U"+std::to_string(rng()%64), std::to_string(i), side, OrderType::LIMIT, px, 1+rng()%10, 0);
+        router.submit(static_cast<SymbolId>(rng()%symbol_count), EngineEvent::New(&orders.back()));
+    }
+
+    auto t0=std::chrono::steady_clock::now();
+    router.start();
+    router.stop();
+    auto t1=std::chrono::steady_clock::now();
+
+    double secs=std::chrono::duration<double>(t1-t0).count();
+    size_t trades=0;
+    for(size_t s=0;s<symbol_count;++s){
+        if(Instrument* inst=router.instrument(static_cast<SymbolId>(s))) trades+=inst->engine.trades.size();
+    }
+    std::printf("shards %zu, symbols %zu, cores %u\n", shard_count, symbol_count, std::thread::hardware_concurrency());
+    std::printf("  events/s         %12.0f\n", static_cast<double>(events)/secs);
+    std::printf("  trades           %12zu\n", trades);
+    return 0;
+}
@@ -0,0 +1,294 @@
+#include "core/CompactBook.hpp"
+
+#include <iterator>
+#include <limits>
+
+namespace MatchEngine{
+
+template<class Q>
+typename CompactBook<Q>::Index CompactBook<Q>::add(Side side, int64_t tick, Q qty, uint32_t owner){
+    assert(qty>0);
+
+    Index oi;
+    if(free_order!=kNil){
+        oi=free_order;
+        free_order=orders[oi].next;
+    }
+    else{
+        assert(orders.size()<kNil);
+        oi=static_cast<Index>(orders.size());
+        orders.emplace_back();
+    }
+
+    Index li=level_at(side_of(*this, side), tick);
+    if(li==kNil) li=open_level(side, tick);
+    LevelSlot& l=levels[li];
+    assert(l.total<=std::numeric_limits<Q>::max()-qty);
+
+    OrderSlot& o=orders[oi];
+    o.next=kNil;
+    o.prev=l.tail;
+    o.level=li;
+    o.owner=owner;
+    o.remaining=qty;
+    if(l.tail!=kNil) orders[l.tail].next=oi;
+    else l.head=oi;
+    l.tail=oi;
+    l.total=static_cast<Q>(l.total+qty);
+    ++l.count;
+    ++live_orders;
+    return oi;
+}
+
+template<class Q>
+bool CompactBook<Q>::cancel(Index order){
+    if(!is_resting(order)) return false;
+    Index li=orders[order].level;
+    levels[li].total=static_cast<Q>(levels[li].total-orders[order].remaining);
+    unlink_order(order);
+    free_order_slot(order);
+    if(levels[li].head==kNil) close_level(levels[li].side, li);
+    return true;
+}
+
+template<class Q>
+void CompactBook<Q>::reduce(Index order, Q qty){
+    assert(is_resting(order));
+    OrderSlot& o=orders[order];
+    assert(qty>0 && qty<o.remaining);
+    o.remaining=static_cast<Q>(o.remaining-qty);
+    levels[o.level].total=static_cast<Q>(levels[o.level].total-qty);
+}
+
+template<class Q>
+bool CompactBook<Q>::best_tick(Side side, int64_t& tick) const{
+    const SideBook& sb=sides[side==Side::BUY ? 0 : 1];
+    if(sb.best==kNil) return false;
+    tick=levels[sb.best].tick;
+    return true;
+}
+
+template<class Q>
+Q CompactBook<Q>::quantity_at(Side side, int64_t tick) const{
+    Index li=level_at(sides[side==Side::BUY ? 0 : 1], tick);
+    return li==kNil ? Q{0} : levels[li].total;
+}
+
+template<class Q>
+size_t CompactBook<Q>::bytes_reserved() const{
+    // a far entry is a red-black node: three links, a colour word, key and value
+    constexpr size_t kFarNode=4*sizeof(void*)+sizeof(int64_t)+sizeof(Index);
+    return orders.capacity()*sizeof(OrderSlot)+levels.capacity()*sizeof(LevelSlot)
+         + (sides[0].ladder.capacity()+sides[1].ladder.capacity())*sizeof(Index)
+         + (sides[0].occupied.capacity()+sides[1].occupied.capacity())*sizeof(uint64_t)
+         + (sides[0].far.size()+sides[1].far.size())*kFarNode;
+}
+
+template<class Q>
+typename CompactBook<Q>::Index CompactBook<Q>::level_at(const SideBook& sb, int64_t tick) const{
+    if(!in_window(sb, tick)){
+        auto it=sb.far.find(tick);
+        return it==sb.far.end() ? kNil : it->second;
+    }
+    return sb.ladder[static_cast<size_t>(tick-sb.base)];
+}
+
+// Nearest existing level better than tick, kNil if tick would be the new best.
+// In the ladder: scan the occupancy bitmap toward the better edge, O(gap / 64), then the
+// nearest far level past it.
+// Outside: the far map, or the list from the nearest worse level when the ladder lies between.
+template<class Q>
+typename CompactBook<Q>::Index CompactBook<Q>::better_neighbour(Side side, const SideBook& sb, int64_t tick) const{
+    if(sb.best==kNil || better_tick(side, tick, levels[sb.best].tick)) return kNil;
+
+    bool buy = side==Side::BUY;
+    auto above=sb.far.upper_bound(tick);                 // first far tick > tick
+    auto nearest_far_better=[&]() -> Index{
+        if(buy) return above==sb.far.end() ? kNil : above->second;
+        auto below=sb.far.lower_bound(tick);
+        return below==sb.far.begin() ? kNil : std::prev(below)->second;
+    };
+
+    if(in_window(sb, tick)){
+        size_t i=static_cast<size_t>(tick-sb.base);
+        size_t slot = buy ? scan_up(sb, i) : scan_down(sb, i);
+        return slot!=kNoSlot ? sb.ladder[slot] : nearest_far_better();
+    }
+
+    bool ladder_better = buy ? tick<sb.base : tick>=sb.base+static_cast<int64_t>(sb.ladder.size());
+    if(!ladder_better || sb.window_levels==0) return nearest_far_better();
+
+    // The ladder's levels are all better, so none sits between tick and its worse neighbour
+    Index worse;
+    if(buy){
+        auto below=sb.far.lower_bound(tick);
+        worse = below==sb.far.begin() ? kNil : std::prev(below)->second;
+    }
+    else worse = above==sb.far.end() ? kNil : above->second;
+    return worse!=kNil ? levels[worse].better : sb.worst;
+}
+
+// Allocates a level at tick and links it into the side's best-first list
+template<class Q>
+typename CompactBook<Q>::Index CompactBook<Q>::open_level(Side side, int64_t tick){
+    SideBook& sb=side_of(*this, side);
+    bool windowed=ensure_range(sb, tick);
+    Index better=better_neighbour(side, sb, tick);
+
+    Index li;
+    if(free_level!=kNil){
+        li=free_level;
+        free_level=levels[li].worse;
+    }
+    else{
+        assert(levels.size()<kNil);
+        li=static_cast<Index>(levels.size());
+        levels.emplace_back();
+    }
+    levels[li]=LevelSlot{};
+    levels[li].tick=tick;
+    levels[li].side=side;
+    if(windowed){
+        sb.ladder[static_cast<size_t>(tick-sb.base)]=li;
+        mark(sb, static_cast<size_t>(tick-sb.base), true);
+        ++sb.window_levels;
+    }
+    else sb.far.emplace(tick, li);
+    ++live_levels;
+
+    LevelSlot& l=levels[li];
+    l.better=better;
+    l.worse = better!=kNil ? levels[better].worse : sb.best;
+    if(l.worse!=kNil) levels[l.worse].better=li;
+    else sb.worst=li;
+    if(better!=kNil) levels[better].worse=li;
+    else sb.best=li;
+    return li;
+}
+
+template<class Q>
+void CompactBook<Q>::close_level(Side side, Index li){
+    SideBook& sb=side_of(*this, side);
+    LevelSlot& l=levels[li];
+    assert(l.head==kNil && l.total==0);
+
+    if(l.better!=kNil) levels[l.better].worse=l.worse;
+    else sb.best=l.worse;
+    if(l.worse!=kNil) levels[l.worse].better=l.better;
+    else sb.worst=l.better;
+
+    if(in_window(sb, l.tick)){
+        sb.ladder[static_cast<size_t>(l.tick-sb.base)]=kNil;
+        mark(sb, static_cast<size_t>(l.tick-sb.base), false);
+        --sb.window_levels;
+    }
+    else sb.far.erase(l.tick);
+    l.better=kNil;
+    l.worse=free_level;
+    free_level=li;
+    --live_levels;
+}
+
+template<class Q>
+void CompactBook<Q>::unlink_order(Index oi){
+    OrderSlot& o=orders[oi];
+    LevelSlot& l=levels[o.level];
+    if(o.prev!=kNil) orders[o.prev].next=o.next;
+    else l.head=o.next;
+    if(o.next!=kNil) orders[o.next].prev=o.prev;
+    else l.tail=o.prev;
+    --l.count;
+}
+
+template<class Q>
+void CompactBook<Q>::free_order_slot(Index oi){
+    OrderSlot& o=orders[oi];
+    o.level=kNil;
+    o.prev=kNil;
+    o.remaining=0;
+    o.next=free_order;
+    free_order=oi;
+    --live_orders;
+}
+
+template<class Q>
+bool CompactBook<Q>::ensure_range(SideBook& sb, int64_t tick){
+    constexpr size_t kInitialTicks=1024;
+    if(sb.ladder.empty()){
+        sb.base=tick-static_cast<int64_t>(kInitialTicks/2);
+        sb.ladder.assign(kInitialTicks, kNil);
+        sb.occupied.assign(kInitialTicks/64, 0);
+        return true;
+    }
+    if(in_window(sb, tick)) return true;
+
+    // An empty ladder just moves
+    if(sb.window_levels==0){
+        sb.base=tick-static_cast<int64_t>(sb.ladder.size()/2);
+        absorb_far(sb);
+        return true;
+    }
+
+    int64_t new_base=sb.base;
+    size_t new_size=sb.ladder.size();
+    while(tick<new_base || tick>=new_base+static_cast<int64_t>(new_size)){
+        if(new_size>=kMaxTicks) return false;
+        if(tick<new_base) new_base-=static_cast<int64_t>(new_size);
+        new_size*=2;
+    }
+
+    // Sizes are powers of two from kInitialTicks, so the shift is whole bitmap words
+    std::vector<Index> grown(new_size, kNil);
+    std::vector<uint64_t> grown_bits(new_size/64, 0);
+    size_t shift=static_cast<size_t>(sb.base-new_base);
+    for(size_t i=0;i<sb.ladder.size();++i) grown[shift+i]=sb.ladder[i];
+    for(size_t w=0;w<sb.occupied.size();++w) grown_bits[shift/64+w]=sb.occupied[w];
+    sb.ladder.swap(grown);
+    sb.occupied.swap(grown_bits);
+    sb.base=new_base;
+    absorb_far(sb);
+    return true;
+}
+
+// Move far levels the ladder now covers into it; list links are unchanged
+template<class Q>
+void CompactBook<Q>::absorb_far(SideBook& sb){
+    auto it=sb.far.lower_bound(sb.base);
+    while(it!=sb.far.end() && in_window(sb, it->first)){
+        sb.ladder[static_cast<size_t>(it->first-sb.base)]=it->second;
+        mark(sb, static_cast<size_t>(it->first-sb.base), true);
+        ++sb.window_levels;
+        it=sb.far.erase(it);
+    }
+}
+
+template<class Q>
+size_t CompactBook<Q>::scan_up(const SideBook& sb, size_t i){
+    size_t pos=i+1;
+    if(pos>=sb.ladder.size()) return kNoSlot;
+    size_t word=pos>>6;
+    uint64_t bits=sb.occupied[word]&(~uint64_t{0}<<(pos&63));
+    while(true){
+        if(bits) return (word<<6)+static_cast<size_t>(std::countr_zero(bits));
+        if(++word==sb.occupied.size()) return kNoSlot;
+        bits=sb.occupied[word];
+    }
+}
+
+template<class Q>
+size_t CompactBook<Q>::scan_down(const SideBook& sb, size_t i){
+    if(i==0) return kNoSlot;
+    size_t pos=i-1;
+    size_t word=pos>>6;
+    uint64_t bits=sb.occupied[word]&(~uint64_t{0}>>(63-(pos&63)));
+    while(true){
+        if(bits) return (word<<6)+63-static_cast<size_t>(std::countl_zero(bits));
+        if(word==0) return kNoSlot;
+        bits=sb.occupied[--word];
+    }
+}
+
+template struct CompactBook<uint32_t>;
+template struct CompactBook<uint64_t>;
+
+}// namespace MatchEngine
@@ -0,0 +1,187 @@
+#include "core/DepthIndex.hpp"
+
+#include <cassert>
+
+namespace MatchEngine{
+
+static constexpr size_t kInitialTicks=1024;
+
+// total_qty is bumped after ensure_range so it sees whether the ladder was empty
+void DepthIndex::add(int64_t tick, uint64_t qty){
+    bool fits=ensure_range(tick);
+    total_qty+=qty;
+    if(!fits){
+        outliers[tick]+=qty;
+        outlier_qty+=qty;
+        return;
+    }
+    size_t index=static_cast<size_t>(tick-base);
+    raw[index]+=qty;
+    update(index, qty);
+}
+
+void DepthIndex::remove(int64_t tick, uint64_t qty){
+    total_qty-=qty;
+    if(!in_ladder(tick)){
+        auto it=outliers.find(tick);
+        assert(it!=outliers.end() && it->second>=qty);
+        outlier_qty-=qty;
+        if((it->second-=qty)==0) outliers.erase(it);
+        return;
+    }
+    size_t index=static_cast<size_t>(tick-base);
+    assert(raw[index]>=qty);
+    raw[index]-=qty;
+    update(index, ~qty+1); // two's complement: unsigned partial sums stay exact
+}
+
+uint64_t DepthIndex::quantity_at_or_below(int64_t tick) const{
+    uint64_t sum=0;
+    for(auto it=outliers.begin();it!=outliers.end() && it->first<=tick;++it) sum+=it->second;
+    if(raw.empty() || tick<base) return sum;
+    int64_t offset=tick-base;
+    if(offset>=static_cast<int64_t>(raw.size())) return sum+(total_qty-outlier_qty);
+    return sum+prefix(static_cast<size_t>(offset)+1);
+}
+
+uint64_t DepthIndex::quantity_at_or_above(int64_t tick) const{
+    return total_qty-quantity_at_or_below(tick-1);
+}
+
+// Walk outliers below the ladder, the ladder, then outliers above it
+bool DepthIndex::lowest_tick_covering(uint64_t qty, int64_t& tick) const{
+    assert(qty>0);
+    if(total_qty<qty) return false;
+    uint64_t sum=0;
+    auto it=outliers.begin();
+    for(;it!=outliers.end() && it->first<base;++it){
+        sum+=it->second;
+        if(sum>=qty){
+            tick=it->first;
+            return true;
+        }
+    }
+    uint64_t ladder=total_qty-outlier_qty;
+    if(sum+ladder>=qty){
+        tick=base+static_cast<int64_t>(first_index_exceeding(qty-sum-1));
+        return true;
+    }
+    sum+=ladder;
+    for(;;++it){
+        assert(it!=outliers.end());
+        sum+=it->second;
+        if(sum>=qty){
+            tick=it->first;
+            return true;
+        }
+    }
+}
+
+bool DepthIndex::highest_tick_covering(uint64_t qty, int64_t& tick) const{
+    assert(qty>0);
+    if(total_qty<qty) return false;
+    uint64_t sum=0;
+    auto it=outliers.rbegin();
+    for(;it!=outliers.rend() && it->first>=base;++it){
+        sum+=it->second;
+        if(sum>=qty){
+            tick=it->first;
+            return true;
+        }
+    }
+    uint64_t ladder=total_qty-outlier_qty;
+    if(sum+ladder>=qty){
+        tick=base+static_cast<int64_t>(first_index_exceeding(ladder-(qty-sum)));
+        return true;
+    }
+    sum+=ladder;
+    for(;;++it){
+        assert(it!=outliers.rend());
+        sum+=it->second;
+        if(sum>=qty){
+            tick=it->first;
+            return true;
+        }
+    }
+}
+
+bool DepthIndex::ensure_range(int64_t tick){
+    if(raw.empty()){
+        base=tick-static_cast<int64_t>(kInitialTicks/2);
+        raw.assign(kInitialTicks, 0);
+        tree.assign(kInitialTicks+1, 0);
+        return true;
+    }
+    if(in_ladder(tick)) return true;
+
+    // Nothing rests in the ladder: move it, no rebuild needed
+    if(total_qty-outlier_qty==0){
+        base=tick-static_cast<int64_t>(raw.size()/2);
+        absorb_outliers();
+        return true;
+    }
+
+    int64_t new_base=base;
+    size_t new_size=raw.size();
+    while(tick<new_base || tick>=new_base+static_cast<int64_t>(new_size)){
+        if(new_size>=kMaxTicks) return false;
+        if(tick<new_base) new_base-=static_cast<int64_t>(new_size);
+        new_size*=2;
+    }
+
+    // Re-base and rebuild in O(T)
+    std::vector<uint64_t> grown(new_size, 0);
+    size_t shift=static_cast<size_t>(base-new_base);
+    for(size_t i=0;i<raw.size();++i) grown[shift+i]=raw[i];
+    raw.swap(grown);
+    base=new_base;
+    rebuild_tree();
+    absorb_outliers();
+    return true;
+}
+
+void DepthIndex::rebuild_tree(){
+    size_t n=raw.size();
+    tree.assign(n+1, 0);
+    for(size_t i=1;i<=n;++i){
+        tree[i]+=raw[i-1];
+        size_t parent=i+(i&(~i+1));
+        if(parent<=n) tree[parent]+=tree[i];
+    }
+}
+
+// Move outliers the ladder now covers into it
+void DepthIndex::absorb_outliers(){
+    for(auto it=outliers.lower_bound(base);it!=outliers.end() && in_ladder(it->first);){
+        size_t index=static_cast<size_t>(it->first-base);
+        raw[index]+=it->second;
+        update(index, it->second);
+        outlier_qty-=it->second;
+        it=outliers.erase(it);
+    }
+}
+
+void DepthIndex::update(size_t index, uint64_t delta){
+    for(size_t i=index+1;i<tree.size();i+=i&(~i+1)) tree[i]+=delta;
+}
+
+uint64_t DepthIndex::prefix(size_t count) const{
+    uint64_t sum=0;
+    for(size_t i=count;i>0;i-=i&(~i+1)) sum+=tree[i];
+    return sum;
+}
+
+// Smallest index whose inclusive prefix sum exceeds target (binary lifting)
+size_t DepthIndex::first_index_exceeding(uint64_t target) const{
+    size_t pos=0;
+    size_t n=raw.size();
+    for(size_t step=n;step>0;step>>=1){
+        if(pos+step<=n && tree[pos+step]<=target){
+            pos+=step;
+            target-=tree[pos];
+        }
+    }
+    return pos;
+}
+
+}// namespace MatchEngine
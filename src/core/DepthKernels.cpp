@@ -0,0 +1,148 @@
+#include "core/DepthKernels.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MATCH_ENGINE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace MatchEngine{
+
+// ─── Scalar ───────────────────────────────────────────────────────────────────
+
+static uint64_t sum_quantity_scalar(const uint64_t* qty, size_t n){
+    uint64_t sum=0;
+    for(size_t i=0;i<n;++i) sum+=qty[i];
+    return sum;
+}
+
+static double sum_notional_scalar(const double* price, const uint64_t* qty, size_t n){
+    double sum=0.0;
+    for(size_t i=0;i<n;++i) sum+=price[i]*static_cast<double>(qty[i]);
+    return sum;
+}
+
+#ifdef MATCH_ENGINE_X86_KERNELS
+
+// ─── AVX2 ─────────────────────────────────────────────────────────────────────
+
+__attribute__((target("avx2")))
+static uint64_t sum_quantity_avx2(const uint64_t* qty, size_t n){
+    __m256i acc0=_mm256_setzero_si256();
+    __m256i acc1=_mm256_setzero_si256();
+    size_t i=0;
+    for(;i+8<=n;i+=8){
+        acc0=_mm256_add_epi64(acc0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(qty+i)));
+        acc1=_mm256_add_epi64(acc1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(qty+i+4)));
+    }
+    acc0=_mm256_add_epi64(acc0, acc1);
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc0);
+    uint64_t sum=lanes[0]+lanes[1]+lanes[2]+lanes[3];
+    for(;i<n;++i) sum+=qty[i];
+    return sum;
+}
+
+// Exact uint64 -> double (AVX2 has no native conversion): split at 2^32 via magic exponents
+__attribute__((target("avx2")))
+static inline __m256d u64_to_pd_avx2(__m256i x){
+    const __m256i magic_lo=_mm256_set1_epi64x(0x4330000000000000LL);  // 2^52
+    const __m256i magic_hi=_mm256_set1_epi64x(0x4530000000000000LL);  // 2^84
+    const __m256d magic_all=_mm256_set1_pd(19342813118337666422669312.0); // 2^84 + 2^52
+    __m256i lo=_mm256_blend_epi32(magic_lo, x, 0x55);
+    __m256i hi=_mm256_or_si256(_mm256_srli_epi64(x, 32), magic_hi);
+    __m256d f=_mm256_sub_pd(_mm256_castsi256_pd(hi), magic_all);
+    return _mm256_add_pd(f, _mm256_castsi256_pd(lo));
+}
+
+__attribute__((target("avx2,fma")))
+static double sum_notional_avx2(const double* price, const uint64_t* qty, size_t n){
+    __m256d acc=_mm256_setzero_pd();
+    size_t i=0;
+    for(;i+4<=n;i+=4){
+        __m256d q=u64_to_pd_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(qty+i)));
+        acc=_mm256_fmadd_pd(_mm256_loadu_pd(price+i), q, acc);
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, acc);
+    double sum=(lanes[0]+lanes[1])+(lanes[2]+lanes[3]);
+    for(;i<n;++i) sum+=price[i]*static_cast<double>(qty[i]);
+    return sum;
+}
+
+// ─── AVX-512 ──────────────────────────────────────────────────────────────────
+
+__attribute__((target("avx512f")))
+static uint64_t sum_quantity_avx512(const uint64_t* qty, size_t n){
+    __m512i acc=_mm512_setzero_si512();
+    size_t i=0;
+    for(;i+8<=n;i+=8){
+        acc=_mm512_add_epi64(acc, _mm512_loadu_si512(qty+i));
+    }
+    if(i<n){
+        __mmask8 tail=static_cast<__mmask8>((1u<<(n-i))-1);
+        acc=_mm512_add_epi64(acc, _mm512_maskz_loadu_epi64(tail, qty+i));
+    }
+    // Spill rather than _mm512_reduce_*: GCC 12 flags its internal undefined vectors at -O3
+    alignas(64) uint64_t lanes[8];
+    _mm512_store_si512(lanes, acc);
+    return ((lanes[0]+lanes[1])+(lanes[2]+lanes[3]))+((lanes[4]+lanes[5])+(lanes[6]+lanes[7]));
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static double sum_notional_avx512(const double* price, const uint64_t* qty, size_t n){
+    __m512d acc=_mm512_setzero_pd();
+    size_t i=0;
+    for(;i+8<=n;i+=8){
+        __m512d q=_mm512_cvtepu64_pd(_mm512_loadu_si512(qty+i));
+        acc=_mm512_fmadd_pd(_mm512_loadu_pd(price+i), q, acc);
+    }
+    if(i<n){
+        __mmask8 tail=static_cast<__mmask8>((1u<<(n-i))-1);
+        __m512d q=_mm512_cvtepu64_pd(_mm512_maskz_loadu_epi64(tail, qty+i));
+        acc=_mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, price+i), q, acc);
+    }
+    alignas(64) double lanes[8];
+    _mm512_store_pd(lanes, acc);
+    return ((lanes[0]+lanes[1])+(lanes[2]+lanes[3]))+((lanes[4]+lanes[5])+(lanes[6]+lanes[7]));
+}
+
+#endif // MATCH_ENGINE_X86_KERNELS
+
+// ─── Dispatch ─────────────────────────────────────────────────────────────────
+
+static const DepthKernels kScalarKernels{SimdLevel::SCALAR, sum_quantity_scalar, sum_notional_scalar};
+#ifdef MATCH_ENGINE_X86_KERNELS
+static const DepthKernels kAvx2Kernels{SimdLevel::AVX2, sum_quantity_avx2, sum_notional_avx2};
+static const DepthKernels kAvx512Kernels{SimdLevel::AVX512, sum_quantity_avx512, sum_notional_avx512};
+#endif
+
+SimdLevel detect_simd_level(){
+#ifdef MATCH_ENGINE_X86_KERNELS
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) return SimdLevel::AVX512;
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::AVX2;
+#endif
+    return SimdLevel::SCALAR;
+}
+
+const DepthKernels& depth_kernels(SimdLevel level){
+#ifdef MATCH_ENGINE_X86_KERNELS
+    static const SimdLevel supported=detect_simd_level();
+    if(level>supported) level=supported;
+    switch(level){
+        case SimdLevel::AVX512: return kAvx512Kernels;
+        case SimdLevel::AVX2:   return kAvx2Kernels;
+        case SimdLevel::SCALAR: break;
+    }
+#else
+    (void)level;
+#endif
+    return kScalarKernels;
+}
+
+const DepthKernels& depth_kernels(){
+    static const DepthKernels& best=depth_kernels(detect_simd_level());
+    return best;
+}
+
+}// namespace MatchEngine
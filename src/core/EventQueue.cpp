@@ -21,4 +21,20 @@ bool EventQueue::pop(EngineEvent& event){
     return true;
 }
 
+size_t EventQueue::size(){
+    std::lock_guard<std::mutex> lock(mtx);
+    return q.size();
+}
+
+bool EventQueue::pop_for(EngineEvent& event, std::chrono::nanoseconds timeout){
+    std::unique_lock<std::mutex> lock(mtx);
+
+    if(!cv.wait_for(lock, timeout, [&](){return !q.empty();})) return false;
+
+    event=q.front();
+    q.pop();
+
+    return true;
+}
+
 }// namespace MatchEngine
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "core/LevelArray.hpp"
+
+#include <cassert>
+
+namespace MatchEngine{
+
+size_t LevelArray::lower_index(double price) const{
+    size_t lo=0;
+    size_t hi=prices.size();
+    while(lo<hi){
+        size_t mid=lo+(hi-lo)/2;
+        if(better(price, prices[mid])) lo=mid+1;
+        else hi=mid;
+    }
+    return lo;
+}
+
+void LevelArray::set(double price, uint64_t qty){
+    // Most updates hit the touch: check the back before searching
+    size_t n=prices.size();
+    size_t i = (n && prices[n-1]==price) ? n-1 : lower_index(price);
+    bool found = i<n && prices[i]==price;
+
+    if(found){
+        if(qty) quantities[i]=qty;
+        else{
+            prices.erase(prices.begin()+static_cast<std::ptrdiff_t>(i));
+            quantities.erase(quantities.begin()+static_cast<std::ptrdiff_t>(i));
+        }
+        return;
+    }
+
+    assert(qty>0);
+    prices.insert(prices.begin()+static_cast<std::ptrdiff_t>(i), price);
+    quantities.insert(quantities.begin()+static_cast<std::ptrdiff_t>(i), qty);
+}
+
+}// namespace MatchEngine
@@ -1,24 +1,26 @@
 #include "core/MatchingEngine.hpp"
+#include "core/MatchPolicy.hpp"
 
 #include<cassert>
 #include<algorithm>
 #include<cmath>
+#include<optional>
 
 namespace MatchEngine{
 
-MatchingEngine::MatchingEngine(OrderBook& book, FeeCalculator& fee_calculator)
-    :order_book(book), fees_calculator(fee_calculator){}
-
-//Generate Trade with fees
-Trade MatchingEngine::generate_trades(uint64_t trade_qty, Order* incoming, Order* resting){
-    TimeUtils::Timestamp eng_ts = TimeUtils::now_ns();
-    TimeUtils::Timestamp wall_ts = TimeUtils::wall_time_ns();
+template<class Book>
+BasicMatchingEngine<Book>::BasicMatchingEngine(Book& book, FeeCalculator& fee_calculator)
+    :order_book(book), fees_calculator(&fee_calculator){}
 
+//Generate Trade with fees; S is the incoming (aggressor) side
+template<class Book>
+template<Side S>
+Trade BasicMatchingEngine<Book>::generate_trades(uint64_t trade_qty, Order* incoming, Order* resting, TakerSweep& sweep){
     double price=resting->price;
     std::string buy_id;
     std::string sell_id;
 
-    if(incoming->side==Side::BUY){
+    if constexpr(S==Side::BUY){
         buy_id=incoming->order_id;
         sell_id=resting->order_id;
     }
@@ -27,21 +29,17 @@ Trade MatchingEngine::generate_trades(uint64_t trade_qty, Order* incoming, Order
         sell_id=incoming->order_id;
     }
 
-    // Fees
-    double notional=price*static_cast<double>(trade_qty);
-
-    //MAKER=Resting, TAKER=Incoming
-    if(incoming->user_id!=resting->user_id){
-        fees_calculator.update_volume(resting->order_id, notional);
-        fees_calculator.update_volume(incoming->order_id, notional);        
-    }
-
-    double maker_fee=fees_calculator.maker_fee(resting->order_id, price, trade_qty);
-    double taker_fee=fees_calculator.taker_fee(incoming->order_id,price, trade_qty);
+    // Fees in integer fee units. MAKER=Resting accrues now; TAKER=Incoming accrues into
+    // the sweep, committed once by match(). Keyed by participant, not order
+    uint64_t notional=fees_calculator->notional(price, trade_qty);
+    UserIndex maker=participant(resting);
+    bool counts_volume = maker!=sweep.user;
+    int64_t maker_units=fees_calculator->accrue_maker(maker, notional, counts_volume);
+    int64_t taker_units=sweep.charge(notional, counts_volume);
+    assert(taker_units >= 0);
 
-    assert(taker_fee >= 0);
-    assert(!std::isnan(maker_fee));
-    assert(!std::isnan(taker_fee));
+    double maker_fee=fees_calculator->to_currency(maker_units);
+    double taker_fee=fees_calculator->to_currency(taker_units);
 
     //Generate Trade
     Trade t(
@@ -50,11 +48,14 @@ Trade MatchingEngine::generate_trades(uint64_t trade_qty, Order* incoming, Order
         std::move(sell_id),
         price,
         trade_qty,
-        eng_ts,
-        wall_ts,
+        stamp.engine_ns,
+        stamp.wall_ns,
         maker_fee,
         taker_fee
     );
+    t.maker_fee_units=maker_units;
+    t.taker_fee_units=taker_units;
+    t.event_sequence=stamp.sequence;
 
     //Publish Trade by TradePublisher
     if(trade_publisher){
@@ -67,7 +68,8 @@ Trade MatchingEngine::generate_trades(uint64_t trade_qty, Order* incoming, Order
             t.engine_ts,
             t.wall_ts,
             t.maker_fee,
-            t.taker_fee
+            t.taker_fee,
+            t.event_sequence
         };
         trade_publisher->publish(ev);
     }
@@ -76,9 +78,17 @@ Trade MatchingEngine::generate_trades(uint64_t trade_qty, Order* incoming, Order
 }
 
 // Order type dispatcher
-void MatchingEngine::process_order(Order* order){
+template<class Book>
+void BasicMatchingEngine<Book>::process_order(Order* order){
     assert(order->status==OrderStatus::CREATED);
-    if (order->timestamp_ns == 0) order->timestamp_ns = TimeUtils::now_ns();
+    EventScope scope(*this);
+    if(order->timestamp_ns==0) order->timestamp_ns=stamp.engine_ns;
+    order->wall_timestamp_ns=stamp.wall_ns;
+    participant(order);
+    if(off_tick(order)){
+        order->status=OrderStatus::CANCELLED;
+        return;
+    }
     switch(order->type){
         case OrderType::LIMIT: 
             process_limit_order(order); 
@@ -94,66 +104,160 @@ void MatchingEngine::process_order(Order* order){
             break;
         case OrderType::STOP_LOSS:
         case OrderType::STOP_LIMIT:
+        case OrderType::TRAILING_STOP:
             process_stop_order(order);
             break;
+        case OrderType::PEG:
+            process_peg_order(order);
+            break;
     }
+    publish_bbo();
+}
+
+// At most one BBO per processed event or batch, after stops have cascaded.
+// Unchanged top of book is conflated away.
+template<class Book>
+void BasicMatchingEngine<Book>::publish_bbo(){
+    if(batch_depth || !bbo_publisher.downstream) return;
+    bbo_publisher.offer(order_book.get_bbo(), stamp);
 }
 
 // Run check
-void MatchingEngine::run(EventQueue& queue) {
+template<class Book>
+void BasicMatchingEngine<Book>::run(EventQueue& queue) {
     running=true;
 
+    // While timers are armed, wake at least once per wheel tick so expiry is not held
+    // back by a quiet queue. With an aggregator, fee volume merges between events and
+    // on a wake at least once per staleness interval, never inside matching
+    const std::chrono::nanoseconds expiry_poll(TimingWheel::kDefaultTickNs);
     while(running) {
         EngineEvent event;
-        queue.pop(event);
+        bool got;
+        if(fee_aggregator) {
+            std::chrono::nanoseconds merge_poll(std::max<uint64_t>(fee_aggregator->max_staleness_ns, 1));
+            got = queue.pop_for(event, order_book.pending_expiries() ? std::min(expiry_poll, merge_poll) : merge_poll);
+        }
+        else got = order_book.pending_expiries() ? queue.pop_for(event, expiry_poll) : queue.pop(event);
 
-        process_event(event);
+        if(order_book.pending_expiries()) expire_orders(clock_now_ns());
+        if(fee_aggregator) fee_aggregator->maybe_merge(*fees_calculator, clock_now_ns());
+        if(got) process_event(event);
     }
 }
 
 // Process event via EventType
-void MatchingEngine::process_event(const EngineEvent& event) {
+template<class Book>
+void BasicMatchingEngine<Book>::process_event(const EngineEvent& event) {
+    if(clock && event.time_ns){
+        // Replay: the recorded time moves the clock, and orders due by then expire first
+        clock->observe(event.time_ns);
+        if(order_book.pending_expiries()) expire_orders(clock->now_ns());
+    }
+    // Each case stamps only once the event reaches the book: a cancel of an unknown id or
+    // a mass cancel with nothing resting publishes nothing and takes no sequence number
     switch(event.type) {
         case EventType::NEW_ORDER: {
+            EventScope scope(*this);
             Order* order = event.order;
-            order->timestamp_ns = TimeUtils::now_ns();
+            order->timestamp_ns = stamp.engine_ns;
             process_order(order);
             break;
         }
-        case EventType::CANCEL_ORDER:
-            order_book.cancel_order(event.order_id);
+        case EventType::CANCEL_ORDER: {
+            if(!order_book.orders.count(event.order_id)) break;
+            EventScope scope(*this);
+            if(order_book.cancel_order(event.order_id)) publish_bbo();
+            break;
+        }
+        case EventType::MODIFY_ORDER:
+            // modify_order stamps once the request is accepted
+            if(modify_order(event.order_id, event.price, event.quantity)) publish_bbo();
+            break;
+        case EventType::MASS_QUOTE:
+            mass_quote(*event.mass_quote);
+            break;
+        case EventType::MASS_CANCEL: {
+            // Disarming stops alone publishes nothing
+            size_t resting = event.both_sides ? order_book.user_order_count(event.user_id, Side::BUY) +
+                                                order_book.user_order_count(event.user_id, Side::SELL)
+                                              : order_book.user_order_count(event.user_id, event.side);
+            std::optional<EventScope> scope;
+            if(resting) scope.emplace(*this);
+            if(event.both_sides) order_book.cancel_user_orders(event.user_id);
+            else order_book.cancel_user_orders(event.user_id, event.side);
+            if(resting) publish_bbo();
             break;
+        }
         case EventType::STOP:
             running=false;
             break;
+        case EventType::MIGRATE_EXPECT:
+        case EventType::MIGRATE_OUT:
+        case EventType::MIGRATE_IN:
+            break;  // consumed by EngineShard
     }
 }
 
-// Matching Loop common for any type of order
-void MatchingEngine::matching_loop(Order* order){
-    Side side=order->side;
+// Runtime entry into the matching loop: one side/type branch, then a specialised loop
+template<class Book>
+void BasicMatchingEngine<Book>::matching_loop(Order* order){
+    bool priced = order->type!=OrderType::MARKET;
+    bool any_trade;
+    if(order->side==Side::BUY) any_trade = priced ? match<Side::BUY, true>(order) : match<Side::BUY, false>(order);
+    else any_trade = priced ? match<Side::SELL, true>(order) : match<Side::SELL, false>(order);
+    if(any_trade) check_stop_orders();
+}
+
+// Matching Loop specialised per aggressor side and price limit.
+// No side or order-type branch inside the loop; returns true if anything traded.
+template<class Book>
+template<Side S, bool PriceLimited>
+bool BasicMatchingEngine<Book>::match(Order* order){
+    using Traits=SideTraits<S>;
+    constexpr Side resting_side=Traits::opposite;
     bool any_trade=false;
+    fees_calculator->advance_to(stamp.wall_ns);     // ledger days are UTC days
+    TakerSweep sweep=fees_calculator->begin_sweep(participant(order));
+    // Pegs price off the touch the sweep started from, not the levels it consumes
+    if(order_book.peg_order_count(resting_side)) order_book.freeze_pegs();
 
     while(order->remaining_quantity()>0){
-        PriceLevel* level=order_book.get_best_opposite(side);
+        PriceLevel* level=Traits::best_opposite(order_book);
+        bool pegged=false;
+        if(order_book.peg_order_count(resting_side)){
+            // Pegs trade ahead of displayed liquidity only at a strictly better price
+            PriceLevel* peg=order_book.best_peg(resting_side);
+            if(peg && (!level || Traits::improves(peg->price, level->price))){
+                level=peg;
+                pegged=true;
+            }
+        }
         if(!level) break;
         assert(level->head != nullptr);
 
-        if(order->type!=OrderType::MARKET){
-            if(!cross(order, level)) break;
+        if constexpr(PriceLimited){
+            if(!Traits::crosses(order->price, level->price)) break;
         }
 
         Order* resting=level->get_head_order();
         assert(resting);
+        assert(resting->side == resting_side);
 
         uint64_t trade_qty=std::min(order->remaining_quantity(), resting->remaining_quantity());
         assert(trade_qty>0);
 
         order->fill_quantity(trade_qty);
         resting->fill_quantity(trade_qty);
-        level->reduce_quantity(trade_qty);
+        if(pegged){
+            resting->price=level->price;
+            level->reduce_quantity(trade_qty);
+        }
+        else{
+            order_book.reduce_level_quantity(resting_side, level, trade_qty);
+        }
 
-        Trade t=generate_trades(trade_qty, order, resting);
+        Trade t=generate_trades<S>(trade_qty, order, resting, sweep);
         trades.push_back(t);
         last_trade_price=t.price;
         any_trade=true;
@@ -162,113 +266,225 @@ void MatchingEngine::matching_loop(Order* order){
         assert(t.price == resting->price);
 
         if(resting->is_filled()){
-            level->remove_order(resting);
-            if(level->is_empty()){
-                order_book.remove_price_level(resting->side, level);
-                level=nullptr;
-            }
+            order_book.remove_filled(resting);
         }
     }
-    if(any_trade) check_stop_orders();
+    order_book.thaw_pegs();
+    if(any_trade) fees_calculator->commit(sweep);
+    return any_trade;
 }
 
-// Insert for limit order
-void MatchingEngine::process_limit_order(Order* order){
+template<class Book>
+template<class Policy>
+void BasicMatchingEngine<Book>::dispatch(Order* order){
     assert(order);
     assert(order->price_level == nullptr);
-    assert(order->type == OrderType::LIMIT);
+    assert(order->type == Policy::type);
+    EventScope scope(*this);
 
-    matching_loop(order);
-    if(!order->is_filled()){
-        order_book.insert_limit(order);
-        if(order->filled_quantity){
-            order->status=OrderStatus::PARTIALLY_FILLED;
+    if(order->side==Side::BUY) execute<Side::BUY, Policy>(order);
+    else execute<Side::SELL, Policy>(order);
+}
+
+// Fully specialised order handling: pre-check, sweep, then rest or finalise status
+template<class Book>
+template<Side S, class Policy>
+void BasicMatchingEngine<Book>::execute(Order* order){
+    if constexpr(Policy::all_or_none){
+        if(!order_book.can_fully_fill(order)){
+            order->status=OrderStatus::CANCELLED;
+            return;
+        }
+    }
+
+    if(match<S, Policy::price_limited>(order)) check_stop_orders();
+
+    if constexpr(Policy::all_or_none){
+        assert(order->is_filled());
+        order->status=OrderStatus::COMPLETED;
+    }
+    else if constexpr(Policy::rests){
+        if(!order->is_filled()){
+            order_book.insert_limit(order);
+            order->status = order->filled_quantity ? OrderStatus::PARTIALLY_FILLED : OrderStatus::OPEN;
         }
         else{
-            order->status=OrderStatus::OPEN;
+            order->status=OrderStatus::COMPLETED;
         }
     }
     else{
-        order->status=OrderStatus::COMPLETED;
+        // Zero fills becomes CANCELLED (documented in README); remainder never rests
+        if(!order->filled_quantity) order->status=OrderStatus::CANCELLED;
+        else if(order->remaining_quantity()) order->status=OrderStatus::PARTIALLY_FILLED;
+        else order->status=OrderStatus::COMPLETED;
+        assert(order->status != OrderStatus::OPEN);
     }
 }
 
-// Insert for market order
-void MatchingEngine::process_market_order(Order* order){
-    assert(order);
-    assert(order->price_level == nullptr);
-    assert(order->type == OrderType::MARKET);
+// Modify: in-place reduce when priority can be kept, otherwise cancel-replace in one step
+template<class Book>
+bool BasicMatchingEngine<Book>::modify_order(const std::string& id, double new_price, uint64_t new_quantity){
+    auto it=order_book.orders.find(id);
+    if(it==order_book.orders.end()) return false;
+    Order* order=it->second;
+    if(order->type != OrderType::LIMIT) return false;     // pegged orders are cancel-only
+    if(!std::isfinite(new_price) || new_price <= 0.0) return false;     // Order invariant 6
+    bool cancels = new_quantity <= order->filled_quantity;
+    if(!cancels && !order_book.on_tick(new_price)) return false;
+    bool same_price = new_price == order->price;
+    if(!cancels && same_price && new_quantity == order->original_quantity) return true;  // nothing changes
+    EventScope scope(*this);
+
+    if(cancels) return order_book.cancel_order(id);
+    if(same_price && new_quantity < order->original_quantity) return order_book.reduce_order(id, new_quantity);
+
+    order_book.detach_order(id);
+    order->price=new_price;
+    order->original_quantity=new_quantity;
+    order->timestamp_ns=stamp.engine_ns;
+    dispatch<LimitPolicy>(order);
+    return true;
+}
 
-    matching_loop(order);
-    if(!order->filled_quantity){
-        order->status=OrderStatus::CANCELLED;
-    }
-    else if(order->remaining_quantity()){
-        order->status=OrderStatus::PARTIALLY_FILLED;
+// Mass quote: cancel the previous set, then run every new quote as a limit order in one batch
+template<class Book>
+MassQuoteAck BasicMatchingEngine<Book>::mass_quote(const MassQuote& mq){
+    EventScope scope(*this);
+    MassQuoteAck ack;
+    ack.user_id=mq.user_id;
+    ack.event_sequence=stamp.sequence;
+    begin_batch();
+
+    // The book drops a quote from its user's set as it leaves, so every entry still rests
+    auto user=order_book.user_orders.find(mq.user_id);
+    if(user!=order_book.user_orders.end() && !user->second.quotes.empty()){
+        std::vector<std::pair<std::string, Order*>> previous(user->second.quotes.begin(), user->second.quotes.end());
+        for(auto& [id, old]: previous){
+            auto it=order_book.orders.find(id);
+            if(it!=order_book.orders.end() && it->second==old && order_book.cancel_order(id)) ++ack.cancelled;
+        }
     }
-    else{
-        order->status=OrderStatus::COMPLETED;
+
+    size_t first_trade=trades.size();
+    for(Order* quote: mq.quotes){
+        // A quote outside the sender's set (other owner or not a limit) is rejected, never rested
+        if(quote->type != OrderType::LIMIT || quote->user_id != mq.user_id){
+            quote->status=OrderStatus::CANCELLED;
+            continue;
+        }
+        quote->is_quote=true;
+        if(quote->timestamp_ns == 0) quote->timestamp_ns = stamp.engine_ns;
+        quote->wall_timestamp_ns = stamp.wall_ns;
+        participant(quote);
+        if(off_tick(quote)){
+            quote->status=OrderStatus::CANCELLED;
+            continue;
+        }
+        process_limit_order(quote);
+        ++ack.accepted;
+        if(quote->price_level) ++ack.resting;
+        ack.filled_quantity+=quote->filled_quantity;
     }
-    assert(order->status != OrderStatus::OPEN);
+    ack.trades=static_cast<uint32_t>(trades.size()-first_trade);
 
+    end_batch();
+    mass_quote_acks.push_back(ack);
+    return ack;
 }
 
-// Insert for IOC order
-void MatchingEngine::process_ioc_order(Order* order){
-    assert(order);
-    assert(order->price_level == nullptr);
-    assert(order->type == OrderType::IOC);
-
-    matching_loop(order);
-    if(!order->filled_quantity){
-        order->status=OrderStatus::CANCELLED;// Documented in README 0 liquidity becomes CANCELLED
-    }
-    else if(order->remaining_quantity()){
-        order->status=OrderStatus::PARTIALLY_FILLED;
-    }
-    else{
-        order->status=OrderStatus::COMPLETED;
+// Priced types whose limit would rest on or sweep the tick ladder must be on its grid
+template<class Book>
+bool BasicMatchingEngine<Book>::off_tick(const Order* order) const{
+    switch(order->type){
+        case OrderType::LIMIT:
+        case OrderType::IOC:
+        case OrderType::FOK:
+        case OrderType::STOP_LIMIT:
+            return !order_book.on_tick(order->price);
+        default:
+            return false;
     }
-    assert(order->status != OrderStatus::OPEN);
 }
 
-// Insert for FOK order
-void MatchingEngine::process_fok_order(Order* order){
-    assert(order);
-    assert(order->price_level == nullptr);
-    assert(order->type == OrderType::FOK);
+// Insert for limit order
+template<class Book>
+void BasicMatchingEngine<Book>::process_limit_order(Order* order){
+    if(expired_on_arrival(order)) return;
+    dispatch<LimitPolicy>(order);
+}
 
-    if(!order_book.can_fully_fill(order)){
+// Pegged order: priced from the live BBO, it can only cross opposite pegs (a buy peg sits
+// at or below the best bid or below the midpoint). The remainder joins its peg group.
+// No reference on arrival (side or book one-sided) cancels it: pegs resting without a
+// price could lock against each other once the reference returns.
+template<class Book>
+void BasicMatchingEngine<Book>::process_peg_order(Order* order){
+    assert(order->type == OrderType::PEG);
+    EventScope scope(*this);
+    if(expired_on_arrival(order)) return;
+
+    double price;
+    if(!order_book.peg_price(order->side, order->peg_reference, order->peg_offset, price)){
         order->status=OrderStatus::CANCELLED;
         return;
     }
-    matching_loop(order);
-    assert(order->is_filled());
-    order->status=OrderStatus::COMPLETED;
+    order->price=price;
+    bool any_trade = (order->side==Side::BUY) ? match<Side::BUY, true>(order) : match<Side::SELL, true>(order);
+    if(any_trade) check_stop_orders();
+
+    if(order->is_filled()){
+        order->status=OrderStatus::COMPLETED;
+        return;
+    }
+    order_book.insert_peg(order);
+    order->status = order->filled_quantity ? OrderStatus::PARTIALLY_FILLED : OrderStatus::OPEN;
 }
 
-// Pre Scan loop
-// Iterates the sorted map directly — PriceLevel::next is never maintained.
-bool OrderBook::can_fully_fill(const Order* order) const{
-    uint64_t required_qty = order->original_quantity;
+// DAY/GTD orders already past expiry are cancelled untouched
+template<class Book>
+bool BasicMatchingEngine<Book>::expired_on_arrival(Order* order){
+    if(order->tif==TimeInForce::GTC) return false;
+    if(order->tif==TimeInForce::DAY) order->expire_ns=session_close_ns;
+    if(order->expire_ns>order->timestamp_ns) return false;
+    order->status=OrderStatus::CANCELLED;
+    return true;
+}
 
-    if (order->side == Side::BUY) {
-        for (auto it = asks.begin(); it != asks.end() && required_qty > 0; ++it) {
-            if (!MatchingEngine::cross(order, it->second)) break;
-            required_qty -= std::min<uint64_t>(required_qty, it->second->total_quantity);
-        }
-    } else {
-        for (auto it = bids.rbegin(); it != bids.rend() && required_qty > 0; ++it) {
-            if (!MatchingEngine::cross(order, it->second)) break;
-            required_qty -= std::min<uint64_t>(required_qty, it->second->total_quantity);
-        }
+// Stamped only once a timer fires, so an idle poll takes no sequence number
+template<class Book>
+size_t BasicMatchingEngine<Book>::expire_orders(TimeUtils::Timestamp now_ns){
+    std::optional<EventScope> scope;
+    size_t expired=order_book.expire_orders(now_ns, [&](Order*){
+        if(!scope) scope.emplace(*this);
+    });
+    if(expired){
+        expired_orders+=expired;
+        publish_bbo();
     }
+    return expired;
+}
 
-    return required_qty == 0;
+// Insert for market order
+template<class Book>
+void BasicMatchingEngine<Book>::process_market_order(Order* order){
+    dispatch<MarketPolicy>(order);
+}
+
+// Insert for IOC order
+template<class Book>
+void BasicMatchingEngine<Book>::process_ioc_order(Order* order){
+    dispatch<IocPolicy>(order);
+}
+
+// Insert for FOK order
+template<class Book>
+void BasicMatchingEngine<Book>::process_fok_order(Order* order){
+    dispatch<FokPolicy>(order);
 }
 
 // Helper function to check if price Level crosses
-bool MatchingEngine::cross(const Order* order, const PriceLevel* level){
+template<class Book>
+bool BasicMatchingEngine<Book>::cross(const Order* order, const PriceLevel* level){
     Side side=order->side;
     bool crosses =
             (side == Side::BUY  && order->price >= level->price) ||
@@ -278,17 +494,27 @@ bool MatchingEngine::cross(const Order* order, const PriceLevel* level){
 }
 
 // Insert for stop loss orders
-void MatchingEngine::process_stop_order(Order* order){
+template<class Book>
+void BasicMatchingEngine<Book>::process_stop_order(Order* order){
     assert(order);
-    assert(order->type == OrderType::STOP_LOSS || order->type == OrderType::STOP_LIMIT);
+    assert(order->type == OrderType::STOP_LOSS || order->type == OrderType::STOP_LIMIT ||
+           order->type == OrderType::TRAILING_STOP);
 
-    order_book.pending_stops.push_back(order);
+    if(order->type == OrderType::TRAILING_STOP) order_book.trailing_stops.add(order, last_trade_price);
+    else order_book.pending_stops.push_back(order);
     order->status=OrderStatus::OPEN;
 }
 
-// Check stop loss orders after every trade O(S) with vector, O(log S) with map
-void MatchingEngine::check_stop_orders(){
+// Check stop loss orders after every trade: O(S) over fixed stops, O(log S) per
+// trailing stop that fires
+template<class Book>
+void BasicMatchingEngine<Book>::check_stop_orders(){
     std::vector<Order*> triggered;
+    if(!order_book.trailing_stops.empty()){
+        order_book.trailing_stops.on_trade(last_trade_price, triggered);
+        for(auto* order: triggered) order->is_triggered=true;
+    }
+    size_t trailing=triggered.size();
 
     for(auto* order: order_book.pending_stops){
         if(order->is_triggered) continue;
@@ -304,15 +530,18 @@ void MatchingEngine::check_stop_orders(){
         }
     }
 
-    for(auto* order: triggered){
-        order_book.pending_stops.erase(
-            std::remove(order_book.pending_stops.begin(),
-                        order_book.pending_stops.end(),
-                        order),
-            order_book.pending_stops.end()
-        );
+    for(size_t i=0;i<triggered.size();++i){
+        Order* order=triggered[i];
+        if(i>=trailing){
+            order_book.pending_stops.erase(
+                std::remove(order_book.pending_stops.begin(),
+                            order_book.pending_stops.end(),
+                            order),
+                order_book.pending_stops.end()
+            );
+        }
 
-        if(order->type==OrderType::STOP_LOSS){
+        if(order->type==OrderType::STOP_LOSS || order->type==OrderType::TRAILING_STOP){
             order->type=OrderType::MARKET;
             process_market_order(order);
         }
@@ -324,4 +553,8 @@ void MatchingEngine::check_stop_orders(){
     }
 }
 
+template struct BasicMatchingEngine<OrderBook>;
+template struct BasicMatchingEngine<FlatOrderBook>;
+template struct BasicMatchingEngine<TickLadderOrderBook>;
+
 }// namespace MatchEngine
\ No newline at end of file
@@ -1,97 +1,525 @@
 #include "core/OrderBook.hpp"
 #include "core/Order.hpp"
 
+#include "core/DepthKernels.hpp"
+
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 
 namespace MatchEngine{
 
 // Insert for limit order
-void OrderBook::insert_limit(Order* order){
+template<class P>
+void BasicOrderBook<P>::insert_limit(Order* order){
     assert(order);
     assert(order->type==OrderType::LIMIT);
     assert(order->price_level == nullptr);
 
     order->status=OrderStatus::OPEN;
 
-    auto& book=(order->side == Side::BUY) ? bids : asks;
-    auto it = book.find(order->price);
-    if(it != book.end()) it->second->add_order(order);
-    else{
-        PriceLevel* level=new PriceLevel(order->price);
+    PriceLevel* level = (order->side == Side::BUY) ? bids.find(order->price) : asks.find(order->price);
+    if(level && !level->is_empty()){
         level->add_order(order);
-        book[order->price]=level;
     }
+    else{
+        level=open_level(order);
+    }
+    level_changed(order->side, level->price, level->total_quantity);
+    ((order->side == Side::BUY) ? bid_depth : ask_depth).add(price_to_tick(order->price), order->remaining_quantity());
 
-    //add in order map
+    //add in order map and the owner's list
     orders[order->order_id]=order;
+    link_user(order);
+    arm_expiry(order);
+}
+
+template<class P>
+void BasicOrderBook<P>::arm_expiry(Order* order){
+    if(order->tif==TimeInForce::GTC) return;
+    order->expiry.deadline_ns=order->expire_ns;
+    order->expiry.order=order;
+    expiry_wheel.insert(&order->expiry);
+}
+
+// Pegged orders join their group's FIFO; the group level is created on first use
+template<class P>
+void BasicOrderBook<P>::insert_peg(Order* order){
+    assert(order->type==OrderType::PEG);
+    assert(order->price_level == nullptr);
+
+    order->status=OrderStatus::OPEN;
+    groups_of(order).try_emplace(order->peg_offset).first->second.add_order(order);
+    ++peg_orders[static_cast<size_t>(order->side)];
+
+    orders[order->order_id]=order;
+    link_user(order);
+    arm_expiry(order);
+}
+
+template<class P>
+bool BasicOrderBook<P>::peg_price(Side side, PegReference ref, double offset, double& price) const{
+    double reference;
+    if(pegs_frozen){
+        reference = ref==PegReference::PRIMARY ? frozen_primary[static_cast<size_t>(side)] : frozen_mid;
+        if(reference<=0.0) return false;
+    }
+    else if(ref==PegReference::PRIMARY){
+        const PriceLevel* same = (side == Side::BUY) ? best_bid : best_ask;
+        if(!same) return false;
+        reference=same->price;
+    }
+    else{
+        if(!best_bid || !best_ask) return false;
+        reference=(best_bid->price+best_ask->price)/2.0;
+    }
+    price = (side == Side::BUY) ? reference-offset : reference+offset;
+    return price>0.0;
+}
+
+template<class P>
+void BasicOrderBook<P>::freeze_pegs(){
+    pegs_frozen=true;
+    frozen_primary[0] = best_bid ? best_bid->price : 0.0;
+    frozen_primary[1] = best_ask ? best_ask->price : 0.0;
+    frozen_mid = best_bid && best_ask ? (best_bid->price+best_ask->price)/2.0 : 0.0;
+}
+
+template<class P>
+PriceLevel* BasicOrderBook<P>::best_peg(Side side){
+    PriceLevel* best=nullptr;
+    for(PegReference ref: {PegReference::PRIMARY, PegReference::MID}){
+        auto& groups=peg_groups[static_cast<size_t>(side)][ref==PegReference::MID];
+        if(groups.empty()) continue;
+        double price;
+        if(!peg_price(side, ref, groups.begin()->first, price)) continue;
+
+        PriceLevel* group=&groups.begin()->second;
+        group->price=price;
+        if(!best || ((side == Side::BUY) ? price>best->price : price<best->price)
+                 || (price==best->price && group->head->timestamp_ns<best->head->timestamp_ns)){
+            best=group;
+        }
+    }
+    return best;
+}
+
+template<class P>
+size_t BasicOrderBook<P>::peg_group_count(Side side) const{
+    size_t s=static_cast<size_t>(side);
+    return peg_groups[s][0].size()+peg_groups[s][1].size();
+}
+
+//pegged orders leave no depth trace; an emptied group is dropped
+template<class P>
+void BasicOrderBook<P>::detach_peg(Order* order){
+    order->price_level->remove_order(order);
+    unlink_user(order);
+    if(order->expiry.linked) expiry_wheel.remove(&order->expiry);
+    --peg_orders[static_cast<size_t>(order->side)];
 
-    best_bid = bids.empty() ? nullptr : prev(bids.end())->second;
-    best_ask = asks.empty() ? nullptr : asks.begin()->second;
+    auto& groups=groups_of(order);
+    auto it=groups.find(order->peg_offset);
+    if(it->second.is_empty()) groups.erase(it);
+}
+
+// New level for order: a retained level at the same price skips allocation and container insert
+template<class P>
+PriceLevel* BasicOrderBook<P>::open_level(Order* order){
+    bool is_bid = order->side == Side::BUY;
+    PriceLevel* level = is_bid ? bids.find(order->price) : asks.find(order->price);
+    PriceLevel* better;
+    if(level){
+        assert(level->is_empty());
+        auto& retained = is_bid ? retained_bids : retained_asks;
+        retained.erase(std::find(retained.begin(), retained.end(), level));
+        level->add_order(order);
+        better = is_bid ? bids.restore(order->price) : asks.restore(order->price);
+        ++level_cache_stats.hits;
+    }
+    else{
+        level=new PriceLevel(order->price);
+        level->add_order(order);
+        better = is_bid ? bids.insert(order->price, level) : asks.insert(order->price, level);
+        ++level_cache_stats.misses;
+    }
+    link_level(order->side, level, better);
+    return level;
 }
 
 //returns true if order was cancelled
-bool OrderBook::cancel_order(std::string order_id){
+template<class P>
+bool BasicOrderBook<P>::cancel_order(std::string order_id){
+    Order* order=detach_order(order_id);
+    if(!order) return false;
+    order->status=OrderStatus::CANCELLED;
+    return true;
+}
+
+//returns the resting order after removing it from its level and the order map; status is untouched
+template<class P>
+Order* BasicOrderBook<P>::detach_order(const std::string& order_id){
     auto it=orders.find(order_id);
-    if(it==orders.end()) return false;
+    if(it==orders.end()) return nullptr;
 
     Order* order=it->second;
+    orders.erase(it);
+    detach_resting(order);
+    return order;
+}
 
+//removes a resting order from its level, the depth views and its user list (order map handled by caller)
+template<class P>
+void BasicOrderBook<P>::detach_resting(Order* order){
     assert(order->price_level != nullptr);
-    assert(orders.find(order->order_id) != orders.end());
 
     assert(order->status == OrderStatus::OPEN ||
        order->status == OrderStatus::PARTIALLY_FILLED);
 
-       
-       PriceLevel* level=order->price_level;
-       level->remove_order(order);
-       
+    if(order->type==OrderType::PEG){
+        detach_peg(order);
+        return;
+    }
+
+    PriceLevel* level=order->price_level;
+    ((order->side == Side::BUY) ? bid_depth : ask_depth).remove(price_to_tick(order->price), order->remaining_quantity());
+    level->remove_order(order);
+    unlink_user(order);
+    if(order->expiry.linked) expiry_wheel.remove(&order->expiry);
+
     if(level->is_empty()){ 
         remove_price_level(order->side, level);        
     }
+    else{
+        level_changed(order->side, level->price, level->total_quantity);
+    }
+}
 
-    order->price_level=nullptr;    
-    orders.erase(it);
-    order->status=OrderStatus::CANCELLED;
+template<class P>
+size_t BasicOrderBook<P>::cancel_user_orders(const std::string& user_id, Side side){
+    size_t cancelled=0;
+    auto it=user_orders.find(user_id);
+    if(it!=user_orders.end()){
+        Order*& head=it->second.head[static_cast<size_t>(side)];
+        while(head){
+            Order* order=head;          // detach_resting advances head
+            orders.erase(order->order_id);
+            detach_resting(order);
+            order->status=OrderStatus::CANCELLED;
+            ++cancelled;
+        }
+    }
+
+    // Armed stops go too, so a disconnected participant's stops cannot trade later.
+    // Kept stops stay in placement order, which is their trigger order
+    std::vector<Order*> stops;
+    auto kept=std::stable_partition(pending_stops.begin(), pending_stops.end(), [&](const Order* o){
+        return o->side!=side || o->user_id!=user_id;
+    });
+    stops.assign(kept, pending_stops.end());
+    pending_stops.erase(kept, pending_stops.end());
+    if(!trailing_stops.empty()) trailing_stops.remove_user(user_id, side, stops);
+    for(Order* order : stops) order->status=OrderStatus::CANCELLED;
+    return cancelled+stops.size();
+}
+
+template<class P>
+size_t BasicOrderBook<P>::cancel_user_orders(const std::string& user_id){
+    return cancel_user_orders(user_id, Side::BUY)+cancel_user_orders(user_id, Side::SELL);
+}
+
+template<class P>
+size_t BasicOrderBook<P>::user_order_count(const std::string& user_id, Side side) const{
+    auto it=user_orders.find(user_id);
+    return it==user_orders.end() ? 0 : it->second.count[static_cast<size_t>(side)];
+}
+
+//level quantity and depth were already reduced fill by fill
+template<class P>
+void BasicOrderBook<P>::remove_filled(Order* order){
+    assert(order->is_filled());
+    if(order->type==OrderType::PEG){
+        orders.erase(order->order_id);
+        detach_peg(order);
+        return;
+    }
+
+    PriceLevel* level=order->price_level;
+    orders.erase(order->order_id);
+    unlink_user(order);
+    if(order->expiry.linked) expiry_wheel.remove(&order->expiry);
+    level->remove_order(order);
+    if(level->is_empty()) remove_price_level(order->side, level);
+}
+
+template<class P>
+void BasicOrderBook<P>::link_user(Order* order){
+    UserOrders& u=user_orders[order->user_id];
+    size_t s=static_cast<size_t>(order->side);
+    order->user_prev=nullptr;
+    order->user_next=u.head[s];
+    if(u.head[s]) u.head[s]->user_prev=order;
+    u.head[s]=order;
+    ++u.count[s];
+    if(order->is_quote) u.quotes.emplace(order->order_id, order);
+}
+
+template<class P>
+void BasicOrderBook<P>::unlink_user(Order* order){
+    UserOrders& u=user_orders.find(order->user_id)->second;
+    size_t s=static_cast<size_t>(order->side);
+    if(order->user_prev) order->user_prev->user_next=order->user_next;
+    else u.head[s]=order->user_next;
+    if(order->user_next) order->user_next->user_prev=order->user_prev;
+    order->user_prev=nullptr;
+    order->user_next=nullptr;
+    --u.count[s];
+    if(order->is_quote) u.quotes.erase(order->order_id);
+}
+
+template<class P>
+bool BasicOrderBook<P>::reduce_order(const std::string& order_id, uint64_t new_quantity){
+    auto it=orders.find(order_id);
+    if(it==orders.end()) return false;
+
+    Order* order=it->second;
+    assert(order->price_level != nullptr);
+    assert(new_quantity > order->filled_quantity && new_quantity < order->original_quantity);
+
+    uint64_t delta=order->original_quantity-new_quantity;
+    order->original_quantity=new_quantity;
+    reduce_level_quantity(order->side, order->price_level, delta);
     return true;
 }
 
-PriceLevel* OrderBook::get_best_bid() { return best_bid; }
+template<class P>
+PriceLevel* BasicOrderBook<P>::get_best_bid() { return best_bid; }
 
-PriceLevel* OrderBook::get_best_ask() { return best_ask; }
+template<class P>
+PriceLevel* BasicOrderBook<P>::get_best_ask() { return best_ask; }
 
-const PriceLevel* OrderBook::get_best_bid() const { return best_bid; }
+template<class P>
+const PriceLevel* BasicOrderBook<P>::get_best_bid() const { return best_bid; }
 
-const PriceLevel* OrderBook::get_best_ask() const { return best_ask; }
+template<class P>
+const PriceLevel* BasicOrderBook<P>::get_best_ask() const { return best_ask; }
 
 //removes the price level if empty
-void OrderBook::remove_price_level(Side side, PriceLevel* level){
-    auto& book=(side == Side::BUY) ? bids : asks;
-    book.erase(level->price);
-    delete level;
+template<class P>
+void BasicOrderBook<P>::remove_price_level(Side side, PriceLevel* level){
+    level_changed(side, level->price, 0);
+    unlink_level(side, level);
+    if(!cache_capacity){
+        if(side == Side::BUY) bids.erase(level->price);
+        else asks.erase(level->price);
+        delete level;
+        return;
+    }
+
+    // Retain: still indexed by price, invisible to BBO, depth and iteration
+    if(side == Side::BUY) bids.retain(level->price);
+    else asks.retain(level->price);
+    ((side == Side::BUY) ? retained_bids : retained_asks).push_back(level);
+    evict_retained(side, cache_capacity);
+}
+
+// Drops the oldest retained levels of side until at most keep remain
+template<class P>
+void BasicOrderBook<P>::evict_retained(Side side, size_t keep){
+    auto& retained = (side == Side::BUY) ? retained_bids : retained_asks;
+    if(retained.size()<=keep) return;
+    size_t drop=retained.size()-keep;
+    for(size_t i=0;i<drop;++i){
+        PriceLevel* level=retained[i];
+        if(side == Side::BUY) bids.evict(level->price);
+        else asks.evict(level->price);
+        delete level;
+    }
+    retained.erase(retained.begin(), retained.begin()+static_cast<std::ptrdiff_t>(drop));
+    level_cache_stats.evictions+=drop;
+}
+
+template<class P>
+void BasicOrderBook<P>::set_level_cache_capacity(size_t capacity){
+    cache_capacity=capacity;
+    evict_retained(Side::BUY, capacity);
+    evict_retained(Side::SELL, capacity);
+}
+
+template<class P>
+void BasicOrderBook<P>::link_level(Side side, PriceLevel* level, PriceLevel* better){
+    PriceLevel*& head = (side == Side::BUY) ? best_bid : best_ask;
+    level->prev=better;
+    level->next = better ? better->next : head;
+    if(level->next) level->next->prev=level;
+    if(better) better->next=level;
+    else head=level;
+}
+
+template<class P>
+void BasicOrderBook<P>::unlink_level(Side side, PriceLevel* level){
+    PriceLevel*& head = (side == Side::BUY) ? best_bid : best_ask;
+    if(level->prev) level->prev->next=level->next;
+    else head=level->next;
+    if(level->next) level->next->prev=level->prev;
+    level->prev=nullptr;
+    level->next=nullptr;
+}
 
-    best_bid = bids.empty() ? nullptr : prev(bids.end())->second;
-    best_ask = asks.empty() ? nullptr : asks.begin()->second;
+//reduces level quantity after a fill; emptied levels are removed by the caller
+template<class P>
+void BasicOrderBook<P>::reduce_level_quantity(Side side, PriceLevel* level, uint64_t qty){
+    level->reduce_quantity(qty);
+    ((side == Side::BUY) ? bid_depth : ask_depth).remove(price_to_tick(level->price), qty);
+    if(level->total_quantity) level_changed(side, level->price, level->total_quantity);
+}
+
+//keeps the flat level mirror in sync and emits the depth delta
+template<class P>
+void BasicOrderBook<P>::level_changed(Side side, double price, uint64_t quantity){
+    ((side == Side::BUY) ? bid_levels : ask_levels).set(price, quantity);
+    if(market_data_publisher) market_data_publisher->publish_depth(DepthUpdate{side, price, quantity, event_stamp.sequence, event_stamp.engine_ns});
 }
 
 //returns the best price level on the opposite side
-PriceLevel* OrderBook::get_best_opposite(Side side){
-    if(side == Side::BUY) {
-        return asks.empty() ? nullptr : asks.begin()->second;
-    } 
-    return bids.empty() ? nullptr : std::prev(bids.end())->second;
+template<class P>
+PriceLevel* BasicOrderBook<P>::get_best_opposite(Side side){
+    return (side == Side::BUY) ? best_ask : best_bid;
+}
+
+template<class P>
+const PriceLevel* BasicOrderBook<P>::get_best_opposite(Side side) const{
+    return (side == Side::BUY) ? best_ask : best_bid;
+}
+
+// FOK pre-check against the cumulative depth index, O(log T).
+// With opposite pegs resting, the check replays match's level order read-only instead:
+// O(levels + groups crossed). Peg references are those match freezes at the start of the
+// sweep; the taker's own side does not change until the taker rests.
+template<class P>
+bool BasicOrderBook<P>::can_fully_fill(const Order* order) const{
+    bool buy = order->side == Side::BUY;
+    size_t resting = buy ? 1 : 0;
+    uint64_t need=order->original_quantity;
+    if(!peg_orders[resting]) return available_quantity(order->side, order->price) >= need;
+
+    const PriceLevel* own = buy ? best_bid : best_ask;
+    const PriceLevel* level = buy ? best_ask : best_bid;
+    const double reference[2]={level ? level->price : 0.0,
+                               own && level ? (own->price+level->price)/2.0 : 0.0};
+    uint64_t level_left = level ? level->total_quantity : 0;
+    std::map<double, PriceLevel>::const_iterator group[2]={peg_groups[resting][0].begin(),
+                                                           peg_groups[resting][1].begin()};
+    while(need){
+        // Same choice as match: a peg goes first only at a strictly better price
+        int pick=-1;
+        bool priced = level!=nullptr;
+        double price = priced ? level->price : 0.0;
+        for(int mid=0;mid<2;++mid){
+            if(group[mid]==peg_groups[resting][mid].end() || reference[mid]<=0.0) continue;
+            double peg = buy ? reference[mid]+group[mid]->first : reference[mid]-group[mid]->first;
+            if(peg>0.0 && (!priced || (buy ? peg<price : peg>price))){
+                price=peg;
+                pick=mid;
+                priced=true;
+            }
+        }
+        if(!priced || (buy ? order->price<price : order->price>price)) break;
+
+        uint64_t take;
+        if(pick<0){
+            take=level_left;
+            level=level->next;
+            level_left = level ? level->total_quantity : 0;
+        }
+        else{
+            take=group[pick]->second.total_quantity;
+            ++group[pick];
+        }
+        need-=std::min(need, take);
+    }
+    return need==0;
+}
+
+template<class P>
+uint64_t BasicOrderBook<P>::available_quantity(Side taker_side, double limit_price) const{
+    int64_t limit=price_to_tick(limit_price);
+    if(taker_side == Side::BUY) return ask_depth.quantity_at_or_below(limit);
+    return bid_depth.quantity_at_or_above(limit);
+}
+
+template<class P>
+bool BasicOrderBook<P>::price_to_fill(Side taker_side, uint64_t qty, double& price) const{
+    int64_t tick=0;
+    bool ok = (taker_side == Side::BUY) ? ask_depth.lowest_tick_covering(qty, tick)
+                                        : bid_depth.highest_tick_covering(qty, tick);
+    if(ok) price=tick_to_price(tick);
+    return ok;
+}
+
+template<class P>
+uint64_t BasicOrderBook<P>::total_depth(Side side) const{
+    return (side == Side::BUY) ? bid_depth.total() : ask_depth.total();
+}
+
+template<class P>
+uint64_t BasicOrderBook<P>::depth_within(Side side, double band) const{
+    const LevelArray& levels=(side == Side::BUY) ? bid_levels : ask_levels;
+    if(levels.empty()) return 0;
+
+    double best=levels.prices.back();
+    double edge=(side == Side::BUY) ? best-band : best+band;
+    size_t first=levels.lower_index(edge);
+    return depth_kernels().sum_quantity(levels.quantities.data()+first, levels.size()-first);
 }
 
-const PriceLevel* OrderBook::get_best_opposite(Side side) const{
-    if(side == Side::BUY) {
-        return asks.empty() ? nullptr : asks.begin()->second;
-    } 
-    return bids.empty() ? nullptr : std::prev(bids.end())->second;
+template<class P>
+double BasicOrderBook<P>::imbalance(size_t levels) const{
+    const DepthKernels& k=depth_kernels();
+    size_t nb=std::min(levels, bid_levels.size());
+    size_t na=std::min(levels, ask_levels.size());
+    double bid=static_cast<double>(k.sum_quantity(bid_levels.quantities.data()+bid_levels.size()-nb, nb));
+    double ask=static_cast<double>(k.sum_quantity(ask_levels.quantities.data()+ask_levels.size()-na, na));
+    if(bid+ask==0.0) return 0.0;
+    return (bid-ask)/(bid+ask);
+}
+
+// Whole blocks are reduced with SIMD; only the block holding the last fill is walked
+template<class P>
+bool BasicOrderBook<P>::vwap_to_fill(Side taker_side, uint64_t qty, double& vwap) const{
+    static constexpr size_t kBlock=32;
+    assert(qty>0);
+
+    const LevelArray& levels=(taker_side == Side::BUY) ? ask_levels : bid_levels;
+    const double* px=levels.prices.data();
+    const uint64_t* q=levels.quantities.data();
+    const DepthKernels& k=depth_kernels();
+
+    uint64_t filled=0;
+    double notional=0.0;
+    size_t end=levels.size();
+    while(end>0){
+        size_t begin=end>kBlock ? end-kBlock : 0;
+        uint64_t block=k.sum_quantity(q+begin, end-begin);
+        if(filled+block>=qty) break;
+        filled+=block;
+        notional+=k.sum_notional(px+begin, q+begin, end-begin);
+        end=begin;
+    }
+    for(size_t i=end;i>0 && filled<qty;--i){
+        uint64_t take=std::min(q[i-1], qty-filled);
+        filled+=take;
+        notional+=px[i-1]*static_cast<double>(take);
+    }
+    if(filled<qty) return false;
+
+    vwap=notional/static_cast<double>(qty);
+    return true;
 }
 
 // returns best bid and ask price and quantity
-BBO OrderBook::get_bbo() const{
+template<class P>
+BBO BasicOrderBook<P>::get_bbo() const{
     BBO bbo{};
     if(best_bid){
         bbo.has_bid=true;
@@ -109,31 +537,22 @@ BBO OrderBook::get_bbo() const{
 }
 
 // returns all price levels up to the specified depth on both sides
-L2Snapshot OrderBook::get_l2_snapshot(size_t depth) const{
+template<class P>
+L2Snapshot BasicOrderBook<P>::get_l2_snapshot(size_t depth) const{
     L2Snapshot snap;
 
-    //Bids->descending order
-    size_t count=0;
-    for(auto it=bids.rbegin();it!=bids.rend();it++){
-        if(count==depth) break;
-        snap.bids.push_back({
-            it->second->price,
-            it->second->total_quantity
-        });
-        count++;
-    }
-
-    //Asks->ascending order
-    count=0;
-    for(auto it=asks.begin();it!=asks.end();it++){
-        if(count==depth) break;
-        snap.asks.push_back({
-            it->second->price,
-            it->second->total_quantity
-        });
-        count++;
+    //Bids->descending order, Asks->ascending order (level lists run best first)
+    for(const PriceLevel* l=best_bid; l && snap.bids.size()<depth; l=l->next){
+        snap.bids.push_back({l->price, l->total_quantity});
+    }
+    for(const PriceLevel* l=best_ask; l && snap.asks.size()<depth; l=l->next){
+        snap.asks.push_back({l->price, l->total_quantity});
     }
     return snap;
 }
 
+template struct BasicOrderBook<TreeLevelPolicy>;
+template struct BasicOrderBook<FlatLevelPolicy>;
+template struct BasicOrderBook<TickLadderLevelPolicy>;
+
 }// namespace MatchEngine
@@ -0,0 +1,289 @@
+#include "core/ShardRouter.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace MatchEngine{
+
+namespace{
+
+// Best effort; an unavailable core leaves the thread unpinned
+void pin_to_cpu(int cpu){
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<size_t>(cpu), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Spread dense ids over shards; neighbouring ids land on different shards
+uint32_t hash_to_shard(SymbolId symbol, size_t shard_count){
+    uint64_t h=static_cast<uint64_t>(symbol)*0x9E3779B97F4A7C15ULL;
+    return static_cast<uint32_t>((h>>32)%shard_count);
+}
+
+}// namespace
+
+void EngineShard::run(){
+    if(cpu>=0) pin_to_cpu(cpu);
+
+    // Same expiry cadence as BasicMatchingEngine::run, across all of this shard's books.
+    // Fee volume merges between events, and a quiet shard still wakes to merge once per
+    // staleness interval
+    const std::chrono::nanoseconds expiry_poll(TimingWheel::kDefaultTickNs);
+    const std::chrono::nanoseconds merge_poll(std::max<uint64_t>(router.fee_aggregator.max_staleness_ns, 1));
+    while(true){
+        EngineEvent event;
+        bool got = queue.pop_for(event, timers ? std::min(expiry_poll, merge_poll) : merge_poll);
+
+        if(timers) expire_orders();
+        router.fee_aggregator.maybe_merge(fees, now_ns());
+        if(!got) continue;
+
+        switch(event.type){
+            case EventType::STOP:
+                return;
+            case EventType::MIGRATE_EXPECT:
+                parked[event.symbol];
+                break;
+            case EventType::MIGRATE_OUT:
+                hand_off(event.symbol, event.shard);
+                break;
+            case EventType::MIGRATE_IN:
+                adopt(event.symbol);
+                break;
+            default:
+                if(!parked.empty()){
+                    auto it=parked.find(event.symbol);
+                    if(it!=parked.end()){
+                        it->second.push_back(event);
+                        break;
+                    }
+                }
+                apply(event);
+        }
+    }
+}
+
+void EngineShard::apply(const EngineEvent& event){
+    Instrument& inst=instrument(event.symbol);
+    ++inst.sequence;
+    inst.engine.process_event(event);
+    // Any event type can leave a DAY/GTD order resting (new orders, mass quotes, ...)
+    if(inst.book.pending_expiries()) timers=true;
+    processed.fetch_add(1, std::memory_order_relaxed);
+    router.symbol_events[event.symbol].fetch_add(1, std::memory_order_relaxed);
+}
+
+Instrument& EngineShard::instrument(SymbolId symbol){
+    assert(symbol!=kNoSymbol);
+    if(symbol>=instruments.size()) instruments.resize(symbol+1);
+    auto& slot=instruments[symbol];
+    if(!slot){
+        slot=std::make_unique<Instrument>(symbol, fees);
+        slot->engine.set_clock(clock);
+        slot->engine.set_fee_aggregator(&router.fee_aggregator);
+        slot->engine.set_trade_publisher(router.publishers[symbol].trades);
+        slot->engine.set_market_data_publisher(router.publishers[symbol].market_data);
+        active.push_back(slot.get());
+    }
+    return *slot;
+}
+
+// Every event queued before MIGRATE_OUT has been applied; later ones went to `to`
+void EngineShard::hand_off(SymbolId symbol, uint32_t to){
+    std::unique_ptr<Instrument> inst;
+    if(symbol<instruments.size()) inst=std::move(instruments[symbol]);
+    if(inst) active.erase(std::find(active.begin(), active.end(), inst.get()));
+
+    EngineShard& dest=*router.shards[to];
+    {
+        std::lock_guard<std::mutex> lock(dest.mailbox_mtx);
+        dest.mailbox.emplace_back(symbol, std::move(inst));
+    }
+    dest.queue.push(EngineEvent::Migrate(EventType::MIGRATE_IN, symbol));
+}
+
+void EngineShard::adopt(SymbolId symbol){
+    std::unique_ptr<Instrument> inst;
+    {
+        std::lock_guard<std::mutex> lock(mailbox_mtx);
+        auto it=std::find_if(mailbox.begin(), mailbox.end(), [&](const auto& m){ return m.first==symbol; });
+        assert(it!=mailbox.end());
+        inst=std::move(it->second);
+        mailbox.erase(it);
+    }
+    if(inst){
+        inst->engine.rebind_fees(fees);
+        if(inst->engine.clock!=clock) inst->engine.set_clock(clock);   // same clock keeps the stamp floor
+        if(inst->book.pending_expiries()) timers=true;
+        if(symbol>=instruments.size()) instruments.resize(symbol+1);
+        active.push_back(inst.get());
+        instruments[symbol]=std::move(inst);
+    }
+
+    auto it=parked.find(symbol);
+    assert(it!=parked.end());
+    std::vector<EngineEvent> waiting=std::move(it->second);
+    parked.erase(it);
+    for(const EngineEvent& e : waiting) apply(e);
+
+    router.migrating[symbol].store(false, std::memory_order_release);
+    router.in_flight.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+// Each engine expires on its own clock, which is the shard's
+void EngineShard::expire_orders(){
+    bool pending=false;
+    for(Instrument* inst : active){
+        if(!inst->book.pending_expiries()) continue;
+        inst->engine.expire_orders(inst->engine.clock_now_ns());
+        pending = pending || inst->book.pending_expiries();
+    }
+    timers=pending;
+}
+
+ShardRouter::ShardRouter(size_t shard_count, bool pin_cores){
+    assert(shard_count>0);
+    unsigned cores=std::thread::hardware_concurrency();
+    for(size_t i=0;i<shard_count;++i){
+        shards.push_back(std::make_unique<EngineShard>(static_cast<uint32_t>(i), *this));
+        if(pin_cores && cores>0) shards.back()->cpu=static_cast<int>(i%cores);
+    }
+    last_shard_events.assign(shard_count, 0);
+    last_sample=std::chrono::steady_clock::now();
+}
+
+ShardRouter::~ShardRouter(){
+    stop();
+}
+
+SymbolId ShardRouter::add_symbol(std::string_view name){
+    assert(!running());
+    SymbolId id=symbols.intern(name);
+    if(id>=owner.size()){
+        owner.push_back(hash_to_shard(id, shards.size()));
+        publishers.emplace_back();
+        route_locks.emplace_back();
+        migrating.emplace_back(false);
+        symbol_events.emplace_back(0);
+        last_symbol_events.push_back(0);
+    }
+    return id;
+}
+
+void ShardRouter::set_publishers(SymbolId symbol, TradePublisher* trades, MarketDataPublisher* market_data){
+    assert(!running() && symbol<publishers.size());
+    publishers[symbol]={trades, market_data};
+}
+
+size_t ShardRouter::shard_of(SymbolId symbol){
+    std::lock_guard<std::mutex> lock(route_locks[symbol]);
+    return owner[symbol];
+}
+
+void ShardRouter::start(){
+    assert(!running());
+    for(auto& shard : shards){
+        threads.emplace_back([s=shard.get()](){ s->run(); });
+    }
+}
+
+void ShardRouter::stop(){
+    if(!running()) return;
+    while(in_flight.load(std::memory_order_acquire)>0) std::this_thread::yield();
+    for(auto& shard : shards) shard->queue.push(EngineEvent::Stop());
+    for(auto& t : threads) t.join();
+    threads.clear();
+}
+
+void ShardRouter::submit(SymbolId symbol, EngineEvent event){
+    assert(symbol<owner.size());
+    event.symbol=symbol;
+    std::lock_guard<std::mutex> lock(route_locks[symbol]);
+    shards[owner[symbol]]->queue.push(event);
+}
+
+bool ShardRouter::migrate(SymbolId symbol, uint32_t to){
+    assert(symbol<owner.size() && to<shards.size());
+    std::lock_guard<std::mutex> lock(route_locks[symbol]);
+    uint32_t from=owner[symbol];
+    if(from==to || migrating[symbol].load(std::memory_order_acquire)) return false;
+
+    owner[symbol]=to;
+    if(!running()) return true;     // no books exist before start()
+
+    migrating[symbol].store(true, std::memory_order_relaxed);
+    in_flight.fetch_add(1, std::memory_order_acq_rel);
+    shards[to]->queue.push(EngineEvent::Migrate(EventType::MIGRATE_EXPECT, symbol));
+    shards[from]->queue.push(EngineEvent::Migrate(EventType::MIGRATE_OUT, symbol, to));
+    return true;
+}
+
+LoadReport ShardRouter::sample(){
+    auto now=std::chrono::steady_clock::now();
+    LoadReport report;
+    report.interval_sec=std::chrono::duration<double>(now-last_sample).count();
+    last_sample=now;
+    double secs=report.interval_sec>0.0 ? report.interval_sec : 1.0;
+
+    for(size_t i=0;i<shards.size();++i){
+        uint64_t events=shards[i]->processed.load(std::memory_order_relaxed);
+        report.shards.push_back({events, static_cast<double>(events-last_shard_events[i])/secs,
+                                 shards[i]->queue.size(), 0});
+        last_shard_events[i]=events;
+    }
+    for(SymbolId s=0;s<owner.size();++s){
+        uint64_t events=symbol_events[s].load(std::memory_order_relaxed);
+        uint32_t shard=static_cast<uint32_t>(shard_of(s));
+        report.symbols.push_back({s, shard, events, static_cast<double>(events-last_symbol_events[s])/secs});
+        ++report.shards[shard].symbols;
+        last_symbol_events[s]=events;
+    }
+    return report;
+}
+
+std::optional<std::pair<SymbolId, uint32_t>> ShardRouter::pick_move(const LoadReport& report, double tolerance){
+    if(report.shards.size()<2) return std::nullopt;
+
+    // Shard load as the sum of its symbols' rates, so a move's effect is exact
+    std::vector<double> load(report.shards.size(), 0.0);
+    for(const SymbolLoad& s : report.symbols) load[s.shard]+=s.events_per_sec;
+    auto [lo, hi]=std::minmax_element(load.begin(), load.end());
+    double mean=0.0;
+    for(double l : load) mean+=l;
+    mean/=static_cast<double>(load.size());
+    if(*hi<=mean*(1.0+tolerance)) return std::nullopt;
+
+    // Moving rate r leaves max(hot - r, cold + r); best is r nearest (hot - cold) / 2
+    uint32_t hot=static_cast<uint32_t>(hi-load.begin());
+    uint32_t cold=static_cast<uint32_t>(lo-load.begin());
+    double gap=*hi-*lo, target=gap/2.0;
+    std::optional<std::pair<SymbolId, uint32_t>> best;
+    double best_distance=0.0;
+    for(const SymbolLoad& s : report.symbols){
+        if(s.shard!=hot || s.events_per_sec<=0.0 || s.events_per_sec>=gap) continue;
+        double distance=std::fabs(s.events_per_sec-target);
+        if(!best || distance<best_distance){
+            best=std::make_pair(s.symbol, cold);
+            best_distance=distance;
+        }
+    }
+    return best;
+}
+
+bool ShardRouter::rebalance(double tolerance){
+    auto move=pick_move(sample(), tolerance);
+    return move && migrate(move->first, move->second);
+}
+
+Instrument* ShardRouter::instrument(SymbolId symbol){
+    assert(!running());
+    auto& list=shards[owner[symbol]]->instruments;
+    return symbol<list.size() ? list[symbol].get() : nullptr;
+}
+
+}// namespace MatchEngine
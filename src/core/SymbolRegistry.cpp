@@ -0,0 +1,21 @@
+#include "core/SymbolRegistry.hpp"
+
+#include <cassert>
+
+namespace MatchEngine{
+
+SymbolId SymbolRegistry::intern(std::string_view name){
+    auto [it, inserted]=ids.try_emplace(std::string(name), static_cast<SymbolId>(names.size()));
+    if(inserted){
+        assert(names.size()<kNoSymbol);
+        names.emplace_back(name);
+    }
+    return it->second;
+}
+
+SymbolId SymbolRegistry::find(std::string_view name) const{
+    auto it=ids.find(std::string(name));
+    return it==ids.end() ? kNoSymbol : it->second;
+}
+
+}// namespace MatchEngine
@@ -0,0 +1,99 @@
+#include "core/TimingWheel.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace MatchEngine{
+
+// Deadlines already due go to the next tick: the current tick's slot has been fired
+void TimingWheel::insert(TimerNode* node){
+    assert(!node->linked);
+    uint64_t t=deadline_tick(node);
+    file(node, t<=now_tick ? now_tick+1 : t);
+    ++count;
+}
+
+// Lowest level where the deadline tick and now_tick share all higher digits
+void TimingWheel::file(TimerNode* node, uint64_t t){
+    uint64_t diff=t^now_tick;
+    size_t level=0;
+    while(level<kLevels-1 && (diff>>(kSlotBits*(level+1)))!=0) ++level;
+    size_t slot=static_cast<size_t>((t>>(kSlotBits*level)) & (kSlots-1));
+    link(node, level*kSlots+slot);
+}
+
+void TimingWheel::remove(TimerNode* node){
+    assert(node->linked);
+    if(node->prev) node->prev->next=node->next;
+    else slots[node->slot_index]=node->next;
+    if(node->next) node->next->prev=node->prev;
+    if(!slots[node->slot_index]){
+        size_t level=node->slot_index/kSlots, slot=node->slot_index%kSlots;
+        occupied[level][slot/64]&=~(uint64_t{1}<<(slot%64));
+    }
+    node->next=nullptr;
+    node->prev=nullptr;
+    node->linked=false;
+    --count;
+}
+
+void TimingWheel::link(TimerNode* node, size_t index){
+    node->prev=nullptr;
+    node->next=slots[index];
+    if(node->next) node->next->prev=node;
+    slots[index]=node;
+    node->slot_index=static_cast<uint16_t>(index);
+    node->linked=true;
+    size_t slot=index%kSlots;
+    occupied[index/kSlots][slot/64]|=uint64_t{1}<<(slot%64);
+}
+
+// Lowest level with an occupied slot ahead of its current digit wins; the tick returned is
+// that slot's start, where lower digits are zero (a cascade point unless level 0)
+uint64_t TimingWheel::next_due_tick() const{
+    for(size_t level=0;level<kLevels;++level){
+        size_t shift=kSlotBits*level;
+        size_t digit=static_cast<size_t>((now_tick>>shift) & (kSlots-1));
+        size_t slot=next_occupied(level, digit+1);
+        if(slot<kSlots){
+            uint64_t rotation=(now_tick>>(shift+kSlotBits))<<(shift+kSlotBits);
+            return rotation+(static_cast<uint64_t>(slot)<<shift);
+        }
+    }
+    // Only parked timers left: next top-level rotation
+    constexpr size_t kSpan=kSlotBits*kLevels;
+    return ((now_tick>>kSpan)+1)<<kSpan;
+}
+
+// First occupied slot >= from at level, kSlots if none
+size_t TimingWheel::next_occupied(size_t level, size_t from) const{
+    for(size_t w=from/64;w<kSlots/64;++w){
+        uint64_t bits=occupied[level][w];
+        if(w==from/64) bits&=~uint64_t{0}<<(from%64);
+        if(bits) return w*64+static_cast<size_t>(std::countr_zero(bits));
+    }
+    return kSlots;
+}
+
+// now_tick just entered a new rotation: re-file the level-1 slot that came due, and the
+// higher-level slots whose lower digits all wrapped with it
+void TimingWheel::cascade(){
+    for(size_t level=1;level<kLevels;++level){
+        size_t slot=static_cast<size_t>((now_tick>>(kSlotBits*level)) & (kSlots-1));
+        TimerNode* node=slots[level*kSlots+slot];
+        slots[level*kSlots+slot]=nullptr;
+        occupied[level][slot/64]&=~(uint64_t{1}<<(slot%64));
+        while(node){
+            TimerNode* next=node->next;
+            node->next=nullptr;
+            node->prev=nullptr;
+            // Deadlines clamped on insert may be behind now_tick: they are due on this tick
+            file(node, std::max(deadline_tick(node), now_tick));
+            node=next;
+        }
+        if(slot!=0) break;
+    }
+}
+
+}// namespace MatchEngine
@@ -0,0 +1,121 @@
+#include "core/TrailingStops.hpp"
+
+#include <cassert>
+#include <limits>
+
+namespace MatchEngine{
+
+void TrailingStops::add(Order* order, double last_trade_price){
+    assert(order->type==OrderType::TRAILING_STOP);
+    assert(order->trail_offset>0.0);
+
+    // Without a trade the mark is -inf in high-water form: never fires, lifted by any trade
+    constexpr double kNoMark=-std::numeric_limits<double>::infinity();
+    bool sell = order->side==Side::SELL;
+    double mark = last_trade_price>0.0 ? (sell ? last_trade_price : -last_trade_price) : kNoMark;
+    (sell ? sells : buys).add(order, mark);
+}
+
+void TrailingStops::on_trade(double price, std::vector<Order*>& fired){
+    sells.lift(price);
+    sells.fire(price, 1.0, fired);
+    buys.lift(-price);
+    buys.fire(-price, -1.0, fired);
+}
+
+void TrailingStops::remove_user(const std::string& user_id, Side side, std::vector<Order*>& removed){
+    (side==Side::SELL ? sells : buys).remove_user(user_id, removed);
+}
+
+// The newest class already has the current mark unless a trade moved the price since
+void TrailingStops::Index::add(Order* order, double mark){
+    if(stack.empty() || stack.back().mark!=mark){
+        assert(stack.empty() || stack.back().mark>mark);
+        stack.push_back(MarkClass{mark, 0.0, {}, {}});
+        stack.back().self=std::prev(stack.end());
+    }
+    else{
+        MarkClass& top=stack.back();
+        triggers.erase({top.key, &top});
+    }
+    MarkClass& c=stack.back();
+    c.stops.emplace(std::make_pair(order->trail_offset, placed++), order);
+    rekey(c);
+    ++count;
+}
+
+// Merge the trailing run of classes with mark <= value into the largest of them
+void TrailingStops::Index::lift(double value){
+    auto first=stack.end();
+    while(first!=stack.begin() && std::prev(first)->mark<=value) --first;
+    if(first==stack.end()) return;
+
+    auto largest=first;
+    for(auto it=first;it!=stack.end();++it){
+        if(it->stops.size()>largest->stops.size()) largest=it;
+    }
+    for(auto it=first;it!=stack.end();){
+        triggers.erase({it->key, &*it});
+        if(it==largest){
+            ++it;
+            continue;
+        }
+        largest->stops.merge(it->stops);
+        it=stack.erase(it);
+    }
+    largest->mark=value;
+    rekey(*largest);
+}
+
+void TrailingStops::Index::fire(double value, double sign, std::vector<Order*>& fired){
+    while(!triggers.empty()){
+        auto top=std::prev(triggers.end());
+        if(top->first<value) break;
+
+        MarkClass& c=*top->second;
+        triggers.erase(top);
+        auto stop=c.stops.begin();
+        Order* order=stop->second;
+        order->stop_price=sign*(c.mark-stop->first.first);
+        fired.push_back(order);
+        c.stops.erase(stop);
+        --count;
+
+        if(c.stops.empty()) stack.erase(c.self);
+        else rekey(c);
+    }
+}
+
+// Classes left empty are erased; the others are rekeyed on their new smallest trail
+void TrailingStops::Index::remove_user(const std::string& user_id, std::vector<Order*>& removed){
+    for(auto it=stack.begin();it!=stack.end();){
+        MarkClass& c=*it;
+        size_t before=c.stops.size();
+        for(auto stop=c.stops.begin();stop!=c.stops.end();){
+            if(stop->second->user_id!=user_id){
+                ++stop;
+                continue;
+            }
+            removed.push_back(stop->second);
+            stop=c.stops.erase(stop);
+        }
+        if(c.stops.size()==before){
+            ++it;
+            continue;
+        }
+        count-=before-c.stops.size();
+        triggers.erase({c.key, &c});
+        if(c.stops.empty()) it=stack.erase(it);
+        else{
+            rekey(c);
+            ++it;
+        }
+    }
+}
+
+void TrailingStops::Index::rekey(MarkClass& c){
+    c.key=c.mark-c.stops.begin()->first.first;
+    triggers.emplace(c.key, &c);
+}
+
+}// namespace MatchEngine
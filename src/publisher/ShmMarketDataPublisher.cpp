@@ -0,0 +1,138 @@
+#include "publisher/ShmMarketDataPublisher.hpp"
+
+#include <cassert>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace MatchEngine{
+
+static void copy_id(char (&dst)[kShmIdLength], const std::string& src){
+    size_t n=src.size()<kShmIdLength-1 ? src.size() : kShmIdLength-1;
+    std::memcpy(dst, src.data(), n);
+    dst[n]='\0';
+}
+
+ShmMarketDataPublisher::~ShmMarketDataPublisher(){
+    close();
+}
+
+bool ShmMarketDataPublisher::open(const std::string& name, uint32_t capacity){
+    assert(capacity>0 && (capacity&(capacity-1))==0);
+    close();
+
+    shm_unlink(name.c_str()); // drop a stale segment left by a crashed writer
+    int fd=shm_open(name.c_str(), O_CREAT|O_RDWR, 0644);
+    if(fd<0) return false;
+
+    size_t bytes=shm_ring_bytes(capacity);
+    if(ftruncate(fd, static_cast<off_t>(bytes))!=0){
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    void* addr=mmap(nullptr, bytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(addr==MAP_FAILED){
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    header=new (addr) ShmRingHeader{};
+    header->version=kShmRingVersion;
+    header->capacity=capacity;
+    header->write_sequence.store(0, std::memory_order_relaxed);
+    for(auto& r: header->readers){
+        r.active.store(0, std::memory_order_relaxed);
+        r.cursor.store(0, std::memory_order_relaxed);
+    }
+
+    slots=shm_ring_slots(header);
+    for(uint32_t i=0;i<capacity;++i){
+        ShmSlot* slot=new (&slots[i]) ShmSlot{};
+        slot->sequence.store(0, std::memory_order_relaxed);
+    }
+
+    // Magic last: readers refuse to attach until the layout is initialised
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic=kShmRingMagic;
+
+    mask=capacity-1;
+    next_sequence=0;
+    mapped_bytes=bytes;
+    segment_name=name;
+    return true;
+}
+
+void ShmMarketDataPublisher::close(){
+    if(!header) return;
+    munmap(header, mapped_bytes);
+    shm_unlink(segment_name.c_str());
+    header=nullptr;
+    slots=nullptr;
+    mapped_bytes=0;
+    segment_name.clear();
+}
+
+ShmMessage& ShmMarketDataPublisher::begin_write(ShmMessageType type){
+    assert(header);
+    ShmSlot& slot=slots[next_sequence&mask];
+    slot.sequence.store(kShmSlotBusy, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.message.type=type;
+    return slot.message;
+}
+
+void ShmMarketDataPublisher::commit_write(){
+    ShmSlot& slot=slots[next_sequence&mask];
+    ++next_sequence;
+    slot.sequence.store(next_sequence, std::memory_order_release);
+    header->write_sequence.store(next_sequence, std::memory_order_release);
+}
+
+void ShmMarketDataPublisher::publish(const TradeEvent& trade){
+    if(!header) return;
+    ShmTradeRecord& rec=begin_write(ShmMessageType::TRADE).trade;
+    copy_id(rec.user_id, trade.user_id);
+    copy_id(rec.buy_order_id, trade.buy_order_id);
+    copy_id(rec.sell_order_id, trade.sell_order_id);
+    rec.price=trade.price;
+    rec.quantity=trade.quantity;
+    rec.engine_ts=trade.engine_ts;
+    rec.wall_ts=trade.wall_ts;
+    rec.maker_fee=trade.maker_fee;
+    rec.taker_fee=trade.taker_fee;
+    rec.event_sequence=trade.event_sequence;
+    commit_write();
+}
+
+void ShmMarketDataPublisher::publish_bbo(const BBOUpdate& update){
+    if(!header) return;
+    const BBO& bbo=update.bbo;
+    ShmBBORecord& rec=begin_write(ShmMessageType::BBO).bbo;
+    rec.sequence=update.sequence;
+    rec.has_bid=bbo.has_bid;
+    rec.has_ask=bbo.has_ask;
+    rec.bid_price=bbo.bid_price;
+    rec.bid_quantity=bbo.bid_quantity;
+    rec.ask_price=bbo.ask_price;
+    rec.ask_quantity=bbo.ask_quantity;
+    rec.event_sequence=update.event_sequence;
+    rec.engine_ts=update.engine_ts;
+    commit_write();
+}
+
+void ShmMarketDataPublisher::publish_depth(const DepthUpdate& update){
+    if(!header) return;
+    ShmDepthRecord& rec=begin_write(ShmMessageType::DEPTH).depth;
+    rec.side=update.side;
+    rec.price=update.price;
+    rec.quantity=update.quantity;
+    rec.event_sequence=update.event_sequence;
+    rec.engine_ts=update.engine_ts;
+    commit_write();
+}
+
+}// namespace MatchEngine
@@ -0,0 +1,117 @@
+#include "publisher/ShmMarketDataReader.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace MatchEngine{
+
+ShmMarketDataReader::~ShmMarketDataReader(){
+    detach();
+}
+
+bool ShmMarketDataReader::attach(const std::string& name){
+    detach();
+
+    int fd=shm_open(name.c_str(), O_RDWR, 0);
+    if(fd<0) return false;
+
+    struct stat st{};
+    if(fstat(fd, &st)!=0 || static_cast<size_t>(st.st_size)<sizeof(ShmRingHeader)){
+        ::close(fd);
+        return false;
+    }
+
+    size_t bytes=static_cast<size_t>(st.st_size);
+    void* addr=mmap(nullptr, bytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(addr==MAP_FAILED) return false;
+
+    auto* hdr=static_cast<ShmRingHeader*>(addr);
+    bool valid=hdr->magic==kShmRingMagic &&
+               hdr->version==kShmRingVersion &&
+               shm_ring_bytes(hdr->capacity)==bytes;
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    ShmReaderSlot* claimed=nullptr;
+    if(valid){
+        for(auto& r: hdr->readers){
+            uint32_t expected=0;
+            if(r.active.compare_exchange_strong(expected, 1, std::memory_order_acq_rel)){
+                claimed=&r;
+                break;
+            }
+        }
+    }
+    if(!claimed){
+        munmap(addr, bytes);
+        return false;
+    }
+
+    header=hdr;
+    slots=shm_ring_slots(hdr);
+    reader_slot=claimed;
+    capacity=hdr->capacity;
+    mask=capacity-1;
+    mapped_bytes=bytes;
+    lapped=0;
+    next_sequence=hdr->write_sequence.load(std::memory_order_acquire);
+    reader_slot->cursor.store(next_sequence, std::memory_order_relaxed);
+    return true;
+}
+
+void ShmMarketDataReader::detach(){
+    if(!header) return;
+    reader_slot->active.store(0, std::memory_order_release);
+    munmap(header, mapped_bytes);
+    header=nullptr;
+    slots=nullptr;
+    reader_slot=nullptr;
+    mapped_bytes=0;
+}
+
+ShmReadResult ShmMarketDataReader::poll(ShmMessage& out){
+    if(!header) return ShmReadResult::EMPTY;
+
+    const uint64_t expected=next_sequence+1;
+    const ShmSlot& slot=slots[next_sequence&mask];
+
+    uint64_t before=slot.sequence.load(std::memory_order_acquire);
+    if(before==kShmSlotBusy){
+        // Busy with our message (not yet visible) or with one a full lap ahead
+        uint64_t head=header->write_sequence.load(std::memory_order_acquire);
+        if(head-next_sequence>=capacity){
+                return ShmReadResult::LAPPED;
+        }
+        return ShmReadResult::EMPTY;
+    }
+    if(before<expected) return ShmReadResult::EMPTY;
+    if(before>expected){
+        return ShmReadResult::LAPPED;
+    }
+
+    std::memcpy(&out, &slot.message, sizeof(ShmMessage));
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    // Overwritten while copying
+    if(slot.sequence.load(std::memory_order_relaxed)!=before){
+        return ShmReadResult::LAPPED;
+    }
+
+    ++next_sequence;
+    reader_slot->cursor.store(next_sequence, std::memory_order_relaxed);
+    return ShmReadResult::OK;
+}
+
+uint64_t ShmMarketDataReader::resync(){
+    if(!header) return 0;
+    uint64_t head=header->write_sequence.load(std::memory_order_acquire);
+    uint64_t lost=head-next_sequence;
+    lapped+=lost;
+    next_sequence=head;
+    reader_slot->cursor.store(next_sequence, std::memory_order_relaxed);
+    return lost;
+}
+
+}// namespace MatchEngine
@@ -1,9 +1,24 @@
 #include "tests/test_orderbook.hpp"
 
+#include "publisher/ShmMarketDataPublisher.hpp"
+#include "publisher/ShmMarketDataReader.hpp"
+#include "core/DepthKernels.hpp"
+#include "core/ShardRouter.hpp"
+
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <deque>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <set>
 #include <thread>
 #include <unordered_set>
+#include <unistd.h>
 
 using namespace MatchEngine;
 
@@ -248,6 +263,7 @@ void OrderBookTest::run_fee_tier_test() {
     // notional = 100.0 * 2000 = 200,000 -> Tier 1
     assert(t.maker_fee == 200000.0 * -0.0001);
     assert(t.taker_fee == 200000.0 *  0.0004);
+    assert(t.maker_fee_units == -20000000 && t.taker_fee_units == 80000000);
 
     print_trades(engine.trades);
     std::cout << "Maker fee: " << t.maker_fee << '\n';
@@ -871,3 +887,2265 @@ void OrderBookTest::run_event_queue_engine_test() {
     queue.push(EngineEvent::Stop());
     engine_thread.join();
 }
+
+// ─── Shared-memory market data test ───────────────────────────────────────────
+
+void OrderBookTest::run_shm_market_data_test() {
+    std::cout << "=== SHM MARKET DATA TEST ===\n";
+
+    const std::string name = "/me_md_test_" + std::to_string(getpid());
+
+    ShmMarketDataPublisher shm;
+    bool opened = shm.open(name, 8);
+    assert(opened);
+
+    ShmMarketDataReader reader;
+    bool attached = reader.attach(name);
+    assert(attached);
+
+    ShmMarketDataReader missing;
+    bool attached_missing = missing.attach(name + "_missing");
+    assert(!attached_missing);
+
+    engine.set_trade_publisher(&shm);
+    engine.set_market_data_publisher(&shm);
+
+    // 1. Trades, depth deltas and BBO arrive in engine order
+    Order s1("Virat", "S1", Side::SELL, OrderType::LIMIT, 101.0, 5, 1);
+    engine.process_order(&s1);
+    Order b1("Rohit", "B1", Side::BUY, OrderType::LIMIT, 101.0, 2, 2);
+    engine.process_order(&b1);
+
+    const ShmMessageType expected[] = {
+        ShmMessageType::DEPTH, ShmMessageType::BBO,                        // S1 rests
+        ShmMessageType::DEPTH, ShmMessageType::TRADE, ShmMessageType::BBO  // B1 fills
+    };
+    ShmMessage msg{};
+    ShmReadResult polled;
+    for (ShmMessageType type : expected) {
+        polled = reader.poll(msg);
+        assert(polled == ShmReadResult::OK);
+        assert(msg.type == type);
+    }
+    polled = reader.poll(msg);
+    assert(polled == ShmReadResult::EMPTY);
+
+    assert(msg.type == ShmMessageType::BBO);
+    BBOUpdate bbo = msg.to_bbo_update();
+    assert(bbo.sequence == 2);
+    assert(!bbo.bbo.has_bid && bbo.bbo.has_ask);
+    assert(bbo.bbo.ask_price == 101.0 && bbo.bbo.ask_quantity == 3);
+    std::cout << "PASS  Trade / depth / BBO stream\n";
+
+    // 2. A slow reader is lapped, then resyncs to the live edge
+    for (int i = 0; i < 20; ++i)
+        shm.publish_depth(DepthUpdate{Side::BUY, 100.0, static_cast<uint64_t>(i + 1)});
+
+    polled = reader.poll(msg);
+    assert(polled == ShmReadResult::LAPPED);
+    polled = reader.poll(msg);
+    assert(polled == ShmReadResult::LAPPED);                // reported until resync
+    assert(reader.lapped_messages() == 0);
+    uint64_t skipped = reader.resync();
+    assert(skipped == 20);
+    assert(reader.lapped_messages() == 20);
+    for (int i = 0; i < 10; ++i)
+        shm.publish_depth(DepthUpdate{Side::BUY, 100.0, static_cast<uint64_t>(i + 1)});
+    polled = reader.poll(msg);
+    assert(polled == ShmReadResult::LAPPED);
+    skipped = reader.resync();
+    assert(skipped == 10 && reader.lapped_messages() == 30);
+    polled = reader.poll(msg);
+    assert(polled == ShmReadResult::EMPTY);
+
+    shm.publish_depth(DepthUpdate{Side::SELL, 102.0, 7});
+    polled = reader.poll(msg);
+    assert(polled == ShmReadResult::OK);
+    DepthUpdate d = msg.to_depth_update();
+    assert(d.side == Side::SELL && d.price == 102.0 && d.quantity == 7);
+    std::cout << "PASS  Lap detection and resync\n";
+
+    // 3. Reader slots are released on detach and reusable
+    reader.detach();
+    assert(!reader.is_attached());
+    attached = reader.attach(name);
+    assert(attached);
+
+    engine.set_trade_publisher(nullptr);
+    engine.set_market_data_publisher(nullptr);
+    std::cout << "PASS  Attach / detach\n\n";
+}
+
+// ─── BBO conflation test ──────────────────────────────────────────────────────
+
+void OrderBookTest::run_bbo_conflation_test() {
+    std::cout << "=== BBO CONFLATION TEST ===\n";
+
+    InMemoryMarketDataPublisher md;
+    engine.set_market_data_publisher(&md);
+
+    // 1. 50 one-lot asks at one level, then a deeper level
+    std::vector<Order> asks;
+    asks.reserve(51);
+    engine.begin_batch();
+    for (int i = 0; i < 50; ++i) {
+        asks.emplace_back("Virat", "S" + std::to_string(i), Side::SELL, OrderType::LIMIT,
+                          101.0, 1, static_cast<TimeUtils::Timestamp>(i + 1));
+        engine.process_order(&asks.back());
+    }
+    asks.emplace_back("Virat", "S50", Side::SELL, OrderType::LIMIT, 102.0, 5, 51);
+    engine.process_order(&asks.back());
+    engine.end_batch();
+
+    assert(md.bbo_updates.size() == 1);          // one update for the whole batch
+    assert(md.bbo_updates[0].sequence == 1);
+    assert(md.bbo_updates[0].bbo.ask_price == 101.0);
+    assert(md.bbo_updates[0].bbo.ask_quantity == 50);
+    std::cout << "PASS  Batch conflation\n";
+
+    // 2. Resting away from the touch does not change the BBO
+    Order far("Virat", "S_FAR", Side::SELL, OrderType::LIMIT, 110.0, 5, 52);
+    engine.process_order(&far);
+    assert(md.bbo_updates.size() == 1);
+    assert(engine.bbo_publisher.suppressed == 1);
+    std::cout << "PASS  Unchanged BBO suppressed\n";
+
+    // 3. A 50-fill sweep publishes one update with the next sequence number
+    Order sweep("B1", Side::BUY, OrderType::MARKET, 52, 53);
+    engine.process_order(&sweep);
+
+    assert(engine.trades.size() == 51);
+    assert(md.bbo_updates.size() == 2);
+    assert(md.bbo_updates[1].sequence == 2);
+    assert(md.bbo_updates[1].bbo.ask_price == 102.0);
+    assert(md.bbo_updates[1].bbo.ask_quantity == 3);
+    assert(md.depth_updates.size() > md.bbo_updates.size());
+
+    engine.set_market_data_publisher(nullptr);
+    std::cout << "PASS  Sweep emits one update\n\n";
+}
+
+// ─── Cumulative depth index test ──────────────────────────────────────────────
+
+void OrderBookTest::run_depth_index_test() {
+    std::cout << "=== CUMULATIVE DEPTH TEST ===\n";
+
+    Order s1("S1", Side::SELL, OrderType::LIMIT, 101.0,  3, 1);
+    Order s2("S2", Side::SELL, OrderType::LIMIT, 102.0,  2, 2);
+    Order s3("S3", Side::SELL, OrderType::LIMIT, 105.0, 10, 3);
+    Order b1("B1", Side::BUY,  OrderType::LIMIT,  99.0,  4, 4);
+    Order b2("B2", Side::BUY,  OrderType::LIMIT,  98.0,  6, 5);
+    for (Order* o : {&s1, &s2, &s3, &b1, &b2}) book.insert_limit(o);
+
+    // 1. Quantity reachable up to a limit price
+    assert(book.available_quantity(Side::BUY, 100.0) == 0);
+    assert(book.available_quantity(Side::BUY, 102.0) == 5);
+    assert(book.available_quantity(Side::BUY, 104.0) == 5);
+    assert(book.available_quantity(Side::BUY, 105.0) == 15);
+    assert(book.available_quantity(Side::SELL, 99.0) == 4);
+    assert(book.available_quantity(Side::SELL, 90.0) == 10);
+    assert(book.total_depth(Side::SELL) == 15 && book.total_depth(Side::BUY) == 10);
+    std::cout << "PASS  Quantity up to price\n";
+
+    // 2. Price needed to fill N
+    double px = 0.0;
+    assert(book.price_to_fill(Side::BUY, 3, px) && px == 101.0);
+    assert(book.price_to_fill(Side::BUY, 4, px) && px == 102.0);
+    assert(book.price_to_fill(Side::BUY, 6, px) && px == 105.0);
+    assert(!book.price_to_fill(Side::BUY, 16, px));
+    assert(book.price_to_fill(Side::SELL, 5, px) && px == 98.0);
+    std::cout << "PASS  Price to fill\n";
+
+    // 3. Fills, cancels and ladder growth keep the index exact
+    Order t1("T1", Side::BUY, OrderType::LIMIT, 101.0, 2, 6);
+    engine.process_order(&t1);
+    assert(book.available_quantity(Side::BUY, 102.0) == 3);
+
+    bool cancelled = book.cancel_order("S2");
+    assert(cancelled);
+    assert(book.available_quantity(Side::BUY, 104.0) == 1);
+
+    Order far("S_FAR", Side::SELL, OrderType::LIMIT, 5000.0, 7, 7);
+    book.insert_limit(&far);
+    assert(book.available_quantity(Side::BUY, 5000.0) == 18);
+    assert(book.price_to_fill(Side::BUY, 12, px) && px == 5000.0);
+
+    Order fok("FOK1", Side::BUY, OrderType::FOK, 105.0, 12, 8);
+    engine.process_order(&fok);
+    assert(fok.status == OrderStatus::CANCELLED);       // only 11 reachable at 105
+    std::cout << "PASS  Index tracks fills, cancels, growth\n";
+
+    // 4. Prices beyond the ladder cap stay sparse; queries still span them
+    Order huge("S_HUGE", Side::SELL, OrderType::LIMIT, 1e7, 5, 9);
+    Order tiny("B_TINY", Side::BUY, OrderType::LIMIT, 0.01, 2, 10);
+    book.insert_limit(&huge);
+    book.insert_limit(&tiny);
+    assert(book.available_quantity(Side::BUY, 1e7) == 23);
+    assert(book.available_quantity(Side::BUY, 9e6) == 18);
+    assert(book.price_to_fill(Side::BUY, 19, px) && px == 1e7);
+    assert(book.price_to_fill(Side::SELL, 11, px) && px == 0.01);
+    assert(book.available_quantity(Side::SELL, 0.01) == 12);
+
+    DepthIndex index;
+    int64_t tick = 0;
+    index.add(0, 4);
+    index.add(int64_t{1} << 40, 3);                     // outlier above
+    index.add(-(int64_t{1} << 40), 2);                  // outlier below
+    assert(index.quantity_at_or_below(0) == 6 && index.quantity_at_or_above(1) == 3);
+    assert(index.lowest_tick_covering(3, tick) && tick == 0);
+    assert(index.lowest_tick_covering(7, tick) && tick == int64_t{1} << 40);
+    assert(index.highest_tick_covering(4, tick) && tick == 0);
+    assert(index.highest_tick_covering(9, tick) && tick == -(int64_t{1} << 40));
+    index.remove(0, 4);                                 // ladder empties and can move
+    index.add((int64_t{1} << 40) + 1, 1);               // absorbs the outlier above
+    assert(index.outlier_ticks() == 1);                 // only the one below is left
+    assert(index.quantity_at_or_above(int64_t{1} << 40) == 4 && index.total() == 6);
+    index.remove(int64_t{1} << 40, 3);
+    index.remove(-(int64_t{1} << 40), 2);
+    assert(index.total() == 1 && index.highest_tick_covering(1, tick) && tick == (int64_t{1} << 40) + 1);
+
+    // A drained ladder re-bases to the next price instead of pushing it into the outliers
+    DepthIndex drained;
+    drained.add(10000, 5);
+    drained.remove(10000, 5);
+    drained.add(10000000, 7);
+    assert(drained.outlier_ticks() == 0);
+    assert(drained.quantity_at_or_below(10000000) == 7 && drained.quantity_at_or_below(9999999) == 0);
+    std::cout << "PASS  Far prices stay sparse\n";
+
+    // 5. Off-grid prices never reach the index; FOK counts pegs that would trade
+    OrderBook fresh;
+    MatchingEngine e2(fresh, fee_calculator);
+    Order off1("MM", "OFF1", Side::SELL, OrderType::LIMIT, 100.005, 5, 1);
+    Order off2("MM", "OFF2", Side::SELL, OrderType::LIMIT, 100.014, 5, 2);
+    e2.process_order(&off1);
+    e2.process_order(&off2);
+    assert(off1.status == OrderStatus::CANCELLED && off2.status == OrderStatus::CANCELLED);
+    assert(fresh.total_depth(Side::SELL) == 0);
+
+    Order bid("MM", "B1", Side::BUY, OrderType::LIMIT, 99.0, 5, 3);
+    Order ask("MM", "A1", Side::SELL, OrderType::LIMIT, 101.0, 5, 4);
+    Order peg("Peg", "P1", Side::SELL, PegReference::MID, 0.0, 4, 5);
+    for (Order* o : {&bid, &ask, &peg}) e2.process_order(o);
+    assert(peg.status == OrderStatus::OPEN);                        // rests at mid 100
+    bool modified = e2.modify_order("A1", 101.005, 5);
+    assert(!modified && ask.price == 101.0);
+
+    Order short_fok("T", "F1", Side::BUY, OrderType::FOK, 100.5, 9, 6);
+    e2.process_order(&short_fok);                                   // 101 is past the limit
+    assert(short_fok.status == OrderStatus::CANCELLED && peg.filled_quantity == 0);
+    Order fok2("T", "F2", Side::BUY, OrderType::FOK, 101.0, 9, 7);
+    e2.process_order(&fok2);                                        // 4 at the mid, 5 at 101
+    assert(fok2.status == OrderStatus::COMPLETED && peg.is_filled() && ask.is_filled());
+    std::cout << "PASS  Off-tick rejected; FOK sees pegs\n\n";
+}
+
+// ─── Flat level array / SIMD depth test ───────────────────────────────────────
+
+void OrderBookTest::run_level_array_test() {
+    std::cout << "=== LEVEL ARRAY DEPTH TEST ===\n";
+
+    // 1. Every kernel variant agrees with scalar, including ragged tails
+    std::vector<double>   px(203);
+    std::vector<uint64_t> qty(203);
+    for (size_t i = 0; i < px.size(); ++i) {
+        px[i]  = 100.0 + 0.25 * static_cast<double>(i);
+        qty[i] = (i * 7919) % 1000 + (uint64_t{1} << 40);  // exercises the high 32 bits
+    }
+    const DepthKernels& scalar = depth_kernels(SimdLevel::SCALAR);
+    for (SimdLevel lvl : {SimdLevel::AVX2, SimdLevel::AVX512}) {
+        const DepthKernels& k = depth_kernels(lvl);
+        for (size_t n : {size_t{0}, size_t{3}, size_t{8}, size_t{31}, px.size()}) {
+            assert(k.sum_quantity(qty.data(), n) == scalar.sum_quantity(qty.data(), n));
+            double a = k.sum_notional(px.data(), qty.data(), n);
+            double b = scalar.sum_notional(px.data(), qty.data(), n);
+            assert(std::fabs(a - b) <= 1e-12 * std::fabs(b));
+        }
+    }
+    std::cout << "Kernel level: " << static_cast<int>(depth_kernels().level) << '\n';
+    std::cout << "PASS  Kernel variants agree\n";
+
+    // 2. Mirror tracks the book through inserts, fills and cancels
+    std::vector<Order> orders;
+    orders.reserve(300);
+    for (int i = 0; i < 150; ++i) {
+        const auto ts = static_cast<TimeUtils::Timestamp>(i + 1);
+        orders.emplace_back("Virat", "B" + std::to_string(i), Side::BUY, OrderType::LIMIT,
+                            200.0 - i, static_cast<uint64_t>(i % 5 + 1), ts);
+        book.insert_limit(&orders.back());
+        orders.emplace_back("Rohit", "S" + std::to_string(i), Side::SELL, OrderType::LIMIT,
+                            201.0 + i, static_cast<uint64_t>(i % 3 + 1), ts);
+        book.insert_limit(&orders.back());
+    }
+    Order sweep("T1", Side::BUY, OrderType::MARKET, 10, 1000);
+    engine.process_order(&sweep);
+    bool cancelled = book.cancel_order("B3");
+    assert(cancelled);
+
+    // Levels best first, as the book iterates them
+    auto levels_of = [&](Side side) {
+        std::vector<const PriceLevel*> out;
+        book.for_each_level(side, [&](const PriceLevel* l) { out.push_back(l); return true; });
+        return out;
+    };
+    const auto bid_list = levels_of(Side::BUY);
+    const auto ask_list = levels_of(Side::SELL);
+
+    auto mirror_matches = [](const std::vector<const PriceLevel*>& side, const LevelArray& arr) {
+        if (side.size() != arr.size()) return false;
+        for (const PriceLevel* level : side) {
+            size_t i = arr.lower_index(level->price);
+            if (arr.prices[i] != level->price || arr.quantities[i] != level->total_quantity) return false;
+        }
+        return true;
+    };
+    assert(mirror_matches(bid_list, book.bid_levels));
+    assert(mirror_matches(ask_list, book.ask_levels));
+    assert(book.ask_levels.prices.back() == book.get_best_ask()->price);
+    std::cout << "PASS  Mirror matches price levels\n";
+
+    // 3. Queries agree with a walk over the levels
+    uint64_t band = 0;
+    for (size_t i = 0; i < bid_list.size() && bid_list[i]->price >= 200.0 - 20.0; ++i)
+        band += bid_list[i]->total_quantity;
+    assert(book.depth_within(Side::BUY, 20.0) == band);
+
+    uint64_t bid5 = 0, ask5 = 0;
+    for (size_t i = 0; i < 5; ++i) {
+        bid5 += bid_list[i]->total_quantity;
+        ask5 += ask_list[i]->total_quantity;
+    }
+    const double expected_imb = (double(bid5) - double(ask5)) / double(bid5 + ask5);
+    assert(std::fabs(book.imbalance(5) - expected_imb) < 1e-12);
+
+    const uint64_t want = 120;
+    uint64_t got = 0;
+    double notional = 0.0;
+    for (size_t i = 0; got < want; ++i) {
+        uint64_t take = std::min(ask_list[i]->total_quantity, want - got);
+        got += take;
+        notional += ask_list[i]->price * double(take);
+    }
+    double vwap = 0.0;
+    assert(book.vwap_to_fill(Side::BUY, want, vwap));
+    assert(std::fabs(vwap - notional / double(want)) < 1e-9);
+    assert(!book.vwap_to_fill(Side::BUY, 1'000'000, vwap));
+    std::cout << "PASS  Band depth, imbalance, VWAP-to-fill\n\n";
+}
+
+// ─── Price-level container policy test ────────────────────────────────────────
+
+struct ContainerRun {
+    std::vector<std::pair<double, uint64_t>> fills;
+    L2Snapshot snapshot;
+    BBO bbo;
+};
+
+// Same script over any BasicOrderBook: wide price gaps force ladder regrowth
+// in both directions, cancels hit the best level and interior levels.
+template <class Book>
+static ContainerRun run_container_script() {
+    FeeCalculator fees;
+    Book book;
+    BasicMatchingEngine<Book> engine(book, fees);
+
+    std::vector<Order> orders;
+    orders.reserve(64);
+    const double ask_px[] = {101.0, 100.5, 130.0, 100.5, 85.01, 102.37, 101.0};
+    const double bid_px[] = {99.0, 99.5, 60.0, 98.25, 99.5, 84.99, 97.0};
+    for (size_t i = 0; i < 7; ++i) {
+        const auto ts = static_cast<TimeUtils::Timestamp>(i + 1);
+        orders.emplace_back("Virat", "S" + std::to_string(i), Side::SELL, OrderType::LIMIT,
+                            ask_px[i], static_cast<uint64_t>(i + 2), ts);
+        engine.process_order(&orders.back());
+        orders.emplace_back("Rohit", "B" + std::to_string(i), Side::BUY, OrderType::LIMIT,
+                            bid_px[i], static_cast<uint64_t>(i + 1), ts);
+        engine.process_order(&orders.back());
+    }
+    // Seeds already cross at 85.01; aggressors then sweep several levels each way
+    orders.emplace_back("Ishan", "T1", Side::BUY, OrderType::LIMIT, 101.0, 20, 20);
+    engine.process_order(&orders.back());
+    orders.emplace_back("Ishan", "T2", Side::SELL, OrderType::IOC, 98.0, 9, 21);
+    engine.process_order(&orders.back());
+    orders.emplace_back("T3", Side::BUY, OrderType::MARKET, 4, 22);
+    engine.process_order(&orders.back());
+    book.cancel_order("B2");   // deepest bid, interior of the ladder
+    book.cancel_order("S2");   // deepest ask
+
+    ContainerRun run;
+    for (const Trade& t : engine.trades) run.fills.emplace_back(t.price, t.quantity);
+    run.snapshot = book.get_l2_snapshot(10);
+    run.bbo = book.get_bbo();
+    return run;
+}
+
+static bool same_levels(const std::vector<L2Level>& a, const std::vector<L2Level>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].price != b[i].price || a[i].quantity != b[i].quantity) return false;
+    }
+    return true;
+}
+
+void OrderBookTest::run_level_container_test() {
+    std::cout << "=== LEVEL CONTAINER POLICY TEST ===\n";
+
+    const ContainerRun tree   = run_container_script<OrderBook>();
+    const ContainerRun flat   = run_container_script<FlatOrderBook>();
+    const ContainerRun ladder = run_container_script<TickLadderOrderBook>();
+
+    assert(!tree.fills.empty());
+    for (const ContainerRun* other : {&flat, &ladder}) {
+        assert(other->fills == tree.fills);
+        assert(same_levels(other->snapshot.bids, tree.snapshot.bids));
+        assert(same_levels(other->snapshot.asks, tree.snapshot.asks));
+        assert(other->bbo == tree.bbo);
+    }
+    std::cout << "PASS  Tree, flat and tick-ladder books produce identical fills and depth\n";
+
+    // Snapshot ordering: bids strictly descending, asks strictly ascending
+    for (size_t i = 1; i < tree.snapshot.bids.size(); ++i)
+        assert(tree.snapshot.bids[i - 1].price > tree.snapshot.bids[i].price);
+    for (size_t i = 1; i < tree.snapshot.asks.size(); ++i)
+        assert(tree.snapshot.asks[i - 1].price < tree.snapshot.asks[i].price);
+
+    // Ladder: best level survives emptying of interior slots and regrowth
+    TickLadderOrderBook ladder_book;
+    Order a("Virat", "A1", Side::SELL, OrderType::LIMIT, 50.0, 1, 1);
+    Order b("Virat", "A2", Side::SELL, OrderType::LIMIT, 5000.0, 1, 2);
+    Order c("Virat", "A3", Side::SELL, OrderType::LIMIT, 0.5, 1, 3);
+    ladder_book.insert_limit(&a);
+    ladder_book.insert_limit(&b);
+    ladder_book.insert_limit(&c);
+    assert(ladder_book.get_best_ask()->price == 0.5);
+    bool cancelled = ladder_book.cancel_order("A3");
+    assert(cancelled);
+    assert(ladder_book.get_best_ask()->price == 50.0);
+    cancelled = ladder_book.cancel_order("A1");
+    assert(cancelled);
+    assert(ladder_book.get_best_ask()->price == 5000.0);
+    cancelled = ladder_book.cancel_order("A2");
+    assert(cancelled);
+    assert(ladder_book.get_best_ask() == nullptr);
+    std::cout << "PASS  Ladder best-level scan across regrowth\n\n";
+}
+
+// ─── Intrusive level list test ────────────────────────────────────────────────
+
+// Walks one side's level list and checks order, back links and size against the container
+template <class Book>
+static bool level_list_consistent(const Book& book, Side side) {
+    const PriceLevel* head = (side == Side::BUY) ? book.get_best_bid() : book.get_best_ask();
+    const size_t expected = (side == Side::BUY) ? book.bids.size() : book.asks.size();
+    if (head && head->prev) return false;
+    size_t count = 0;
+    for (const PriceLevel* l = head; l; l = l->next, ++count) {
+        if (l->is_empty()) return false;
+        if (l->next) {
+            if (l->next->prev != l) return false;
+            bool ordered = (side == Side::BUY) ? l->price > l->next->price : l->price < l->next->price;
+            if (!ordered) return false;
+        }
+    }
+    return count == expected;
+}
+
+template <class Book>
+static void run_level_list_script(const char* name) {
+    FeeCalculator fees;
+    Book book;
+    BasicMatchingEngine<Book> engine(book, fees);
+
+    // Levels arrive out of price order so new levels land at the head, tail and interior
+    std::vector<Order> orders;
+    orders.reserve(200);
+    uint64_t seed = 7;
+    for (int i = 0; i < 80; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        const double offset = static_cast<double>((seed >> 33) % 40) * 0.25;
+        const auto ts = static_cast<TimeUtils::Timestamp>(i + 1);
+        orders.emplace_back("Virat", "S" + std::to_string(i), Side::SELL, OrderType::LIMIT,
+                            100.25 + offset, 1 + (seed >> 40) % 3, ts);
+        book.insert_limit(&orders.back());
+        orders.emplace_back("Rohit", "B" + std::to_string(i), Side::BUY, OrderType::LIMIT,
+                            100.0 - offset, 1 + (seed >> 44) % 3, ts);
+        book.insert_limit(&orders.back());
+    }
+    assert(level_list_consistent(book, Side::BUY));
+    assert(level_list_consistent(book, Side::SELL));
+
+    // Cancel every third order: empties interior levels and, eventually, heads
+    for (size_t i = 0; i < orders.size(); i += 3) {
+        if (orders[i].price_level) book.cancel_order(orders[i].order_id);
+    }
+    assert(level_list_consistent(book, Side::BUY));
+    assert(level_list_consistent(book, Side::SELL));
+
+    // Sweeps advance through the list, removing emptied heads
+    Order buy("L1", Side::BUY, OrderType::MARKET, 25, 1000);
+    engine.process_order(&buy);
+    Order sell("L2", Side::SELL, OrderType::MARKET, 25, 1001);
+    engine.process_order(&sell);
+    assert(level_list_consistent(book, Side::BUY));
+    assert(level_list_consistent(book, Side::SELL));
+    assert(book.get_best_bid()->price < book.get_best_ask()->price);
+    std::cout << "PASS  " << name << " level list stays sorted and linked\n";
+}
+
+// Prices far beyond the tick ladder's window cap, on both sides of it; returns fill prices
+template <class Book>
+static std::vector<double> run_far_level_script() {
+    FeeCalculator fees;
+    Book book;
+    BasicMatchingEngine<Book> engine(book, fees);
+    std::vector<Order> orders;
+    orders.reserve(16);
+    auto add = [&](const char* id, Side side, double price) {
+        orders.emplace_back("MM", id, side, OrderType::LIMIT, price, 1,
+                            static_cast<TimeUtils::Timestamp>(orders.size() + 1));
+        engine.process_order(&orders.back());
+        assert(level_list_consistent(book, Side::BUY) && level_list_consistent(book, Side::SELL));
+    };
+
+    add("A1", Side::SELL, 100.0);
+    add("A2", Side::SELL, 1e6);                       // far, worse side
+    add("A3", Side::SELL, 5e5);                       // far, between window and A2
+    add("A4", Side::SELL, 100.5);
+    add("B1", Side::BUY, 0.01);
+
+    // Window left with retained levels only, so it moves to the next far price
+    bool cancelled = book.cancel_order("A1") && book.cancel_order("A4");
+    assert(cancelled);
+    add("A5", Side::SELL, 7e5);
+    add("A6", Side::SELL, 99.5);                      // far again, now on the better side
+    add("A7", Side::SELL, 100.0);                     // the retained level comes back
+    assert(book.get_best_ask()->price == 99.5 && book.asks.size() == 5);
+
+    Order sweep("T1", Side::BUY, OrderType::MARKET, 5, 100);
+    engine.process_order(&sweep);
+    assert(sweep.is_filled() && book.get_best_ask() == nullptr);
+    std::vector<double> prices;
+    for (const auto& t : engine.trades) prices.push_back(t.price);
+    return prices;
+}
+
+void OrderBookTest::run_level_list_test() {
+    std::cout << "=== LEVEL LIST TEST ===\n";
+    run_level_list_script<OrderBook>("Tree");
+    run_level_list_script<FlatOrderBook>("Flat");
+    run_level_list_script<TickLadderOrderBook>("Tick ladder");
+
+    const std::vector<double> far_tree = run_far_level_script<OrderBook>();
+    assert(far_tree == (std::vector<double>{99.5, 100.0, 5e5, 7e5, 1e6}));
+    assert(run_far_level_script<TickLadderOrderBook>() == far_tree);
+    std::cout << "PASS  Tick ladder keeps far prices outside its capped window\n";
+    std::cout << '\n';
+}
+
+// ─── Empty-level retention cache test ─────────────────────────────────────────
+
+template <class Book>
+static void run_level_cache_script(const char* name) {
+    Book book;
+    book.set_level_cache_capacity(2);
+    std::vector<Order> orders;
+    orders.reserve(64);
+    auto bid = [&](const std::string& id, double px) {
+        orders.emplace_back("Virat", id, Side::BUY, OrderType::LIMIT, px, 5,
+                            static_cast<TimeUtils::Timestamp>(orders.size() + 1));
+        book.insert_limit(&orders.back());
+    };
+
+    // 1. Flicker at the touch: the emptied level is reused, not reallocated
+    bid("B0", 100.0);
+    bid("B1", 101.0);
+    assert(book.level_cache_stats.misses == 2);
+    bool cancelled = book.cancel_order("B1");
+    assert(cancelled);
+    assert(book.get_best_bid()->price == 100.0);            // retained level is invisible
+    assert(book.get_l2_snapshot(10).bids.size() == 1);
+    assert(book.bids.size() == 1);
+    assert(book.total_depth(Side::BUY) == 5);
+    for (int i = 0; i < 5; ++i) {
+        bid("F" + std::to_string(i), 101.0);
+        assert(book.get_best_bid()->price == 101.0);
+        cancelled = book.cancel_order("F" + std::to_string(i));
+        assert(cancelled);
+    }
+    assert(book.level_cache_stats.hits == 5);
+    assert(book.level_cache_stats.misses == 2);
+    assert(level_list_consistent(book, Side::BUY));
+    std::cout << "PASS  " << name << " flicker reuses the retained level\n";
+
+    // 2. New levels link past retained neighbours: 101 and 102 retained, 101.5 becomes best
+    bid("B2", 102.0);
+    cancelled = book.cancel_order("B2");
+    assert(cancelled);
+    bid("B3", 101.5);
+    assert(book.get_best_bid()->price == 101.5);
+    assert(book.get_best_bid()->next->price == 100.0);
+    assert(level_list_consistent(book, Side::BUY));
+
+    // 3. Capacity bound: oldest retained level is evicted first
+    cancelled = book.cancel_order("B3");                          // retains 101.5, evicts 101
+    assert(cancelled);
+    assert(book.level_cache_stats.evictions == 1);
+    bid("B4", 101.0);
+    assert(book.level_cache_stats.misses == 5);               // 101 had been evicted
+    cancelled = book.cancel_order("B4");
+    assert(cancelled);
+    book.set_level_cache_capacity(0);
+    assert(book.level_cache_stats.evictions == 4);
+    cancelled = book.cancel_order("B0");
+    assert(cancelled);
+    assert(book.get_best_bid() == nullptr && book.bids.empty());
+    std::cout << "PASS  " << name << " retained levels are bounded and evicted oldest first\n";
+}
+
+void OrderBookTest::run_level_cache_test() {
+    std::cout << "=== EMPTY LEVEL CACHE TEST ===\n";
+    run_level_cache_script<OrderBook>("Tree");
+    run_level_cache_script<FlatOrderBook>("Flat");
+    run_level_cache_script<TickLadderOrderBook>("Tick ladder");
+    std::cout << '\n';
+}
+
+// ─── Compact index-linked storage test ────────────────────────────────────────
+
+void OrderBookTest::run_compact_book_test() {
+    std::cout << "=== COMPACT BOOK TEST ===\n";
+    using Compact = CompactBook<uint32_t>;
+
+    // 1. Footprint per resting order: slot vs Order (index-map node not even counted)
+    std::cout << "sizeof(Order)=" << sizeof(Order)
+              << "  sizeof(CompactBook<u32>::OrderSlot)=" << sizeof(Compact::OrderSlot)
+              << "  sizeof(CompactBook<u64>::OrderSlot)=" << sizeof(CompactBook<uint64_t>::OrderSlot) << '\n';
+    static_assert(2 * sizeof(CompactBook<uint64_t>::OrderSlot) <= sizeof(Order));
+    static_assert(sizeof(Order) <= 168 + 2 * sizeof(std::string));     // Order invariant 10
+    std::cout << "PASS  Compact slot at most half an Order\n";
+
+    // 2. Same flow through the full engine and the compact book gives the same fills
+    std::vector<Order> flow;
+    flow.reserve(400);
+    std::vector<std::pair<int64_t, uint64_t>> engine_fills;
+    std::vector<std::pair<int64_t, uint64_t>> compact_fills;
+    Compact compact;
+    std::unordered_map<std::string, Compact::Index> handles;
+
+    uint64_t seed = 11;
+    for (int i = 0; i < 400; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        const Side side = ((seed >> 20) & 1) ? Side::BUY : Side::SELL;
+        const int64_t tick = 10000 + static_cast<int64_t>((seed >> 33) % 21) - 10;
+        const uint64_t qty = 1 + (seed >> 45) % 9;
+        const std::string id = "C" + std::to_string(i);
+
+        if (i % 7 == 6 && !handles.empty()) {
+            // cancel one still-resting order in both books
+            for (auto it = handles.begin(); it != handles.end(); ++it) {
+                if (!compact.is_resting(it->second)) continue;
+                bool cancelled = book.cancel_order(it->first);
+                assert(cancelled);
+                cancelled = compact.cancel(it->second);
+                assert(cancelled);
+                handles.erase(it);
+                break;
+            }
+            continue;
+        }
+
+        flow.emplace_back("Virat", id, side, OrderType::LIMIT, book.tick_to_price(tick), qty,
+                          static_cast<TimeUtils::Timestamp>(i + 1));
+        const size_t before = engine.trades.size();
+        engine.process_order(&flow.back());
+        for (size_t t = before; t < engine.trades.size(); ++t)
+            engine_fills.emplace_back(book.price_to_tick(engine.trades[t].price), engine.trades[t].quantity);
+
+        const uint32_t filled = compact.match(side, tick, true, static_cast<uint32_t>(qty),
+            [&](Compact::Index, uint32_t, int64_t fill_tick, uint32_t fill_qty) {
+                compact_fills.emplace_back(fill_tick, fill_qty);
+            });
+        // Drop handles of orders filled by this sweep before add() can reuse their slots
+        for (auto it = handles.begin(); it != handles.end();) {
+            it = compact.is_resting(it->second) ? std::next(it) : handles.erase(it);
+        }
+        if (filled < qty) handles[id] = compact.add(side, tick, static_cast<uint32_t>(qty - filled), 0);
+    }
+    assert(!engine_fills.empty());
+    assert(engine_fills == compact_fills);
+    std::cout << "PASS  Fills match the pointer-linked book\n";
+
+    // 3. Top of book and per-level quantity agree
+    for (Side side : {Side::BUY, Side::SELL}) {
+        const PriceLevel* best = side == Side::BUY ? book.get_best_bid() : book.get_best_ask();
+        int64_t tick = 0;
+        assert(compact.best_tick(side, tick) == (best != nullptr));
+        for (const PriceLevel* l = best; l; l = l->next)
+            assert(compact.quantity_at(side, book.price_to_tick(l->price)) == l->total_quantity);
+    }
+    assert(compact.order_count() == handles.size());
+
+    // 4. A plain copy is a relocated book: indices stay valid, no fixups
+    Compact moved = compact;
+    const int64_t far = 10000 + 50;
+    std::vector<std::pair<int64_t, uint64_t>> a, b;
+    compact.match(Side::BUY, far, true, 30, [&](Compact::Index, uint32_t, int64_t t, uint32_t q) { a.emplace_back(t, q); });
+    moved.match(Side::BUY, far, true, 30, [&](Compact::Index, uint32_t, int64_t t, uint32_t q) { b.emplace_back(t, q); });
+    assert(a == b && !a.empty());
+    std::cout << "PASS  Copied pools match identically\n";
+
+    // 5. In-place reduce keeps FIFO position
+    Compact fifo;
+    const Compact::Index first = fifo.add(Side::SELL, 500, 10, 1);
+    fifo.add(Side::SELL, 500, 10, 2);
+    fifo.reduce(first, 7);
+    std::vector<uint32_t> owners;
+    fifo.match(Side::BUY, 500, true, 5, [&](Compact::Index, uint32_t owner, int64_t, uint32_t) { owners.push_back(owner); });
+    assert((owners == std::vector<uint32_t>{1, 2}));
+    assert(fifo.quantity_at(Side::SELL, 500) == 8);
+    std::cout << "PASS  Reduce keeps queue position\n";
+
+    // 6. Ticks past the ladder cap stay in the far map; order across both is kept
+    Compact wide;
+    const int64_t huge = int64_t{1} << 40;
+    const size_t before = wide.bytes_reserved();
+    const Compact::Index near1 = wide.add(Side::SELL, 1000, 1, 1);
+    wide.add(Side::SELL, huge, 1, 2);                  // far, worse side
+    wide.add(Side::SELL, huge / 2, 1, 3);              // far, between ladder and huge
+    wide.add(Side::SELL, 1001, 1, 4);
+    wide.add(Side::SELL, -huge, 1, 5);                 // far, better side
+    assert(wide.bytes_reserved() - before < (size_t{1} << 16));
+    bool cancelled = wide.cancel(near1);
+    assert(cancelled);
+    wide.add(Side::SELL, huge * 2, 1, 6);              // worst of all
+    wide.add(Side::SELL, 999, 1, 7);
+    int64_t best = 0;
+    assert(wide.best_tick(Side::SELL, best) && best == -huge);
+    std::vector<int64_t> ticks;
+    wide.match(Side::BUY, 0, false, 10, [&](Compact::Index, uint32_t, int64_t t, uint32_t) { ticks.push_back(t); });
+    assert((ticks == std::vector<int64_t>{-huge, 999, 1001, huge / 2, huge, huge * 2}));
+    assert(wide.level_count() == 0 && wide.order_count() == 0);
+    const Compact::Index low = wide.add(Side::BUY, 5, 1, 8);
+    wide.add(Side::BUY, huge, 1, 9);                   // far while 5 rests
+    cancelled = wide.cancel(low);
+    assert(cancelled);
+    wide.add(Side::BUY, huge - 1, 1, 10);              // ladder empty: moves and absorbs huge
+    assert(wide.best_tick(Side::BUY, best) && best == huge);
+    wide.add(Side::BUY, 5, 1, 11);
+    ticks.clear();
+    wide.match(Side::SELL, 0, false, 3, [&](Compact::Index, uint32_t, int64_t t, uint32_t) { ticks.push_back(t); });
+    assert((ticks == std::vector<int64_t>{huge, huge - 1, 5}));
+    std::cout << "PASS  Far ticks bounded and ordered\n";
+
+    // 7. Sparse levels across a grown ladder: the bitmap finds each neighbour, both sides
+    std::mt19937 sparse_rng(34);
+    for (Side side : {Side::SELL, Side::BUY}) {
+        Compact sparse;
+        std::set<int64_t> live;
+        std::vector<std::pair<int64_t, Compact::Index>> placed;
+        for (int i = 0; i < 400; ++i) {
+            const int64_t t = static_cast<int64_t>(sparse_rng() % 400000);
+            placed.emplace_back(t, sparse.add(side, t, 1, 0));
+            live.insert(t);
+        }
+        for (size_t i = 0; i < placed.size(); i += 3) {
+            if (sparse.is_resting(placed[i].second) && sparse.quantity_at(side, placed[i].first) == 1) {
+                cancelled = sparse.cancel(placed[i].second);
+                assert(cancelled);
+                live.erase(placed[i].first);
+            }
+        }
+        std::vector<int64_t> want(live.begin(), live.end());
+        if (side == Side::BUY) std::reverse(want.begin(), want.end());
+        ticks.clear();
+        sparse.match(side == Side::BUY ? Side::SELL : Side::BUY, 0, false, 1000,
+                     [&](Compact::Index, uint32_t, int64_t t, uint32_t) {
+                         if (ticks.empty() || ticks.back() != t) ticks.push_back(t);
+                     });
+        assert(ticks == want);
+    }
+    std::cout << "PASS  Sparse neighbours found by bitmap scan\n\n";
+}
+
+// ─── Modify (reduce in place / cancel-replace) test ───────────────────────────
+
+void OrderBookTest::run_modify_order_test() {
+    std::cout << "=== MODIFY ORDER TEST ===\n";
+
+    Order s1("Virat", "S1", Side::SELL, OrderType::LIMIT, 101.0, 10, 1);
+    Order s2("Virat", "S2", Side::SELL, OrderType::LIMIT, 101.0, 10, 2);
+    engine.process_order(&s1);
+    engine.process_order(&s2);
+
+    // 1. Quantity reduce at the same price keeps queue position
+    engine.process_event(EngineEvent::Modify("S1", 101.0, 4));
+    assert(s1.original_quantity == 4);
+    assert(book.get_best_ask()->total_quantity == 14);
+    assert(book.get_best_ask()->head == &s1);
+    assert(book.total_depth(Side::SELL) == 14);
+    assert(book.ask_levels.quantities.back() == 14);
+
+    Order b1("Rohit", "B1", Side::BUY, OrderType::LIMIT, 101.0, 5, 3);
+    engine.process_order(&b1);
+    assert(engine.trades.size() == 2);
+    assert(engine.trades[0].sell_order_id == "S1" && engine.trades[0].quantity == 4);
+    assert(engine.trades[1].sell_order_id == "S2" && engine.trades[1].quantity == 1);
+    std::cout << "PASS  Reduce in place keeps FIFO priority\n";
+
+    // 2. A filled order is gone from the index: modify and cancel both reject it
+    assert(s1.status == OrderStatus::COMPLETED);
+    bool modified = engine.modify_order("S1", 101.0, 2);
+    assert(!modified);
+    bool cancelled = book.cancel_order("S1");
+    assert(!cancelled);
+    std::cout << "PASS  Filled orders cannot be modified\n";
+
+    // 3. Reducing to or below the filled quantity cancels the remainder
+    assert(s2.filled_quantity == 1);
+    modified = engine.modify_order("S2", 101.0, 1);
+    assert(modified);
+    assert(s2.status == OrderStatus::CANCELLED);
+    assert(book.get_best_ask() == nullptr);
+    std::cout << "PASS  Reduce to filled cancels\n";
+
+    // 4. Price change is one atomic cancel-replace that can trade at the new price
+    Order s3("Virat", "S3", Side::SELL, OrderType::LIMIT, 103.0, 6, 4);
+    Order b2("Rohit", "B2", Side::BUY, OrderType::LIMIT, 100.0, 8, 5);
+    engine.process_order(&s3);
+    engine.process_order(&b2);
+    engine.trades.clear();
+    engine.process_event(EngineEvent::Modify("B2", 103.0, 8));
+    assert(engine.trades.size() == 1 && engine.trades[0].quantity == 6);
+    assert(b2.status == OrderStatus::PARTIALLY_FILLED);
+    assert(book.get_best_bid() == b2.price_level && book.get_best_bid()->price == 103.0);
+    assert(book.get_best_bid()->total_quantity == 2);
+    assert(book.get_l2_snapshot(5).bids.size() == 1);            // 100.0 level is gone
+    assert(book.total_depth(Side::BUY) == 2 && book.total_depth(Side::SELL) == 0);
+    std::cout << "PASS  Price change cancel-replaces and trades\n";
+
+    // 5. Re-queueing loses priority; a quantity increase re-queues too
+    Order b3("Rohit", "B3", Side::BUY, OrderType::LIMIT, 103.0, 3, 6);
+    engine.process_order(&b3);
+    assert(book.get_best_bid()->head == &b2);
+    modified = engine.modify_order("B2", 103.0, 9);                   // increase: 8 -> 9
+    assert(modified);
+    assert(b2.remaining_quantity() == 3);
+    assert(book.get_best_bid()->head == &b3 && book.get_best_bid()->tail == &b2);
+    assert(book.get_best_bid()->total_quantity == 6);
+    modified = engine.modify_order("NOPE", 1.0, 1);
+    assert(!modified);
+    std::cout << "PASS  Re-queue goes to the back of the level\n";
+
+    // 6. A non-positive or non-finite price is rejected; the order keeps its place
+    for (double bad : {-5.0, 0.0, std::numeric_limits<double>::infinity(),
+                       std::numeric_limits<double>::quiet_NaN()}) {
+        modified = engine.modify_order("B2", bad, 9);
+        assert(!modified);
+    }
+    assert(b2.price == 103.0 && book.get_best_bid()->price == 103.0);
+    assert(book.get_best_bid()->tail == &b2 && book.total_depth(Side::BUY) == 6);
+    std::cout << "PASS  Invalid modify prices are rejected\n\n";
+}
+
+// ─── Mass quote test ──────────────────────────────────────────────────────────
+
+void OrderBookTest::run_mass_quote_test() {
+    std::cout << "=== MASS QUOTE TEST ===\n";
+    InMemoryMarketDataPublisher md;
+    engine.set_market_data_publisher(&md);
+
+    // 1. First quote set: three levels a side, one BBO update for the whole set
+    std::vector<Order> set1;
+    set1.reserve(6);
+    for (int i = 0; i < 3; ++i) {
+        set1.emplace_back("MM", "Q1B" + std::to_string(i), Side::BUY, OrderType::LIMIT, 99.0 - i, 5, 1);
+        set1.emplace_back("MM", "Q1S" + std::to_string(i), Side::SELL, OrderType::LIMIT, 101.0 + i, 5, 1);
+    }
+    MassQuote mq1{"MM", {}};
+    for (auto& o : set1) mq1.quotes.push_back(&o);
+    MassQuoteAck ack = engine.mass_quote(mq1);
+    assert(ack.accepted == 6 && ack.resting == 6 && ack.cancelled == 0 && ack.trades == 0);
+    assert(md.bbo_updates.size() == 1);
+    assert(md.bbo_updates.back().bbo.bid_price == 99.0 && md.bbo_updates.back().bbo.ask_price == 101.0);
+    std::cout << "PASS  Quote set rests with one BBO update\n";
+
+    // 2. A taker lifts part of a quote; the remainder is still a live quote
+    Order lift("Rohit", "T1", Side::BUY, OrderType::LIMIT, 101.0, 2, 2);
+    engine.process_order(&lift);
+    assert(set1[1].filled_quantity == 2);
+
+    // 3. Replacement set pulls every resting quote and can trade against the book in the same step
+    Order other("Virat", "O1", Side::SELL, OrderType::LIMIT, 100.0, 3, 3);
+    engine.process_order(&other);
+    const size_t bbo_before = md.bbo_updates.size();
+
+    std::vector<Order> set2;
+    set2.reserve(2);
+    set2.emplace_back("MM", "Q2B", Side::BUY, OrderType::LIMIT, 100.0, 8, 4);
+    set2.emplace_back("MM", "Q2S", Side::SELL, OrderType::LIMIT, 100.5, 8, 4);
+    MassQuote mq2{"MM", {&set2[0], &set2[1]}};
+    engine.process_event(EngineEvent::Quotes(&mq2));
+    ack = engine.mass_quote_acks.back();
+    assert(engine.mass_quote_acks.size() == 2);
+    assert(ack.cancelled == 6 && ack.accepted == 2 && ack.resting == 2);
+    assert(ack.trades == 1 && ack.filled_quantity == 3);
+    for (const auto& o : set1) assert(o.status == OrderStatus::CANCELLED);
+    assert(md.bbo_updates.size() == bbo_before + 1);
+    assert(book.get_best_bid()->price == 100.0 && book.get_best_bid()->total_quantity == 5);
+    assert(book.get_best_ask()->price == 100.5);
+    assert(book.get_l2_snapshot(10).bids.size() == 1 && book.get_l2_snapshot(10).asks.size() == 1);
+    std::cout << "PASS  Replacement cancels prior set and matches in one step\n";
+
+    // 4. An empty set pulls all quotes; other participants are untouched
+    Order resting("Virat", "O2", Side::SELL, OrderType::LIMIT, 105.0, 1, 5);
+    engine.process_order(&resting);
+    MassQuote pull{"MM", {}};
+    ack = engine.mass_quote(pull);
+    assert(ack.cancelled == 2 && ack.accepted == 0);
+    assert(book.get_best_bid() == nullptr);
+    assert(book.get_best_ask() == resting.price_level);
+    std::cout << "PASS  Empty set pulls every quote\n";
+
+    // 5. A quote that fills leaves the set: the caller may free it, and its id may be reused
+    auto quote = std::make_unique<Order>("MM", "Q3B", Side::BUY, OrderType::LIMIT, 104.0, 2, 6);
+    MassQuote mq3{"MM", {quote.get()}};
+    ack = engine.mass_quote(mq3);
+    assert(ack.resting == 1);
+    Order hit("Rohit", "T2", Side::SELL, OrderType::LIMIT, 104.0, 2, 7);
+    engine.process_order(&hit);
+    assert(quote->is_filled() && book.user_orders["MM"].quotes.empty());
+    quote.reset();
+    Order reuse("MM", "Q3B", Side::BUY, OrderType::LIMIT, 103.0, 1, 8);
+    engine.process_order(&reuse);
+    ack = engine.mass_quote(pull);
+    assert(ack.cancelled == 0 && reuse.status == OrderStatus::OPEN);
+    bool cancelled = book.cancel_order("Q3B");
+    assert(cancelled);
+    std::cout << "PASS  Filled quotes drop out of the set\n";
+
+    // 6. Quotes owned by another user are rejected; the sender's valid quotes still rest
+    Order own("MM", "Q4B", Side::BUY, OrderType::LIMIT, 99.0, 1, 9);
+    Order foreign("Virat", "Q4S", Side::SELL, OrderType::LIMIT, 106.0, 1, 9);
+    MassQuote mq4{"MM", {&own, &foreign}};
+    ack = engine.mass_quote(mq4);
+    assert(ack.accepted == 1 && ack.resting == 1);
+    assert(foreign.status == OrderStatus::CANCELLED && foreign.price_level == nullptr);
+    assert(book.orders.count("Q4S") == 0 && book.user_order_count("Virat", Side::SELL) == 1);
+    ack = engine.mass_quote(pull);
+    assert(ack.cancelled == 1 && book.get_best_bid() == nullptr);
+    std::cout << "PASS  Foreign quotes are rejected\n\n";
+    engine.set_market_data_publisher(nullptr);
+}
+
+// ─── Per-user index / mass cancel test ────────────────────────────────────────
+
+void OrderBookTest::run_mass_cancel_test() {
+    std::cout << "=== MASS CANCEL TEST ===\n";
+    InMemoryMarketDataPublisher md;
+    engine.set_market_data_publisher(&md);
+
+    // Two users interleaved on the same levels
+    std::vector<Order> orders;
+    orders.reserve(2000);
+    uint64_t other_bid_qty = 0;
+    for (int i = 0; i < 500; ++i) {
+        const auto ts = static_cast<TimeUtils::Timestamp>(i + 1);
+        const double off = static_cast<double>(i % 25);
+        orders.emplace_back("MM", "MB" + std::to_string(i), Side::BUY, OrderType::LIMIT, 99.0 - off, 2, ts);
+        engine.process_order(&orders.back());
+        orders.emplace_back("MM", "MS" + std::to_string(i), Side::SELL, OrderType::LIMIT, 101.0 + off, 2, ts);
+        engine.process_order(&orders.back());
+        orders.emplace_back("Virat", "VB" + std::to_string(i), Side::BUY, OrderType::LIMIT, 99.0 - off, 1, ts);
+        engine.process_order(&orders.back());
+        other_bid_qty += 1;
+        orders.emplace_back("Virat", "VS" + std::to_string(i), Side::SELL, OrderType::LIMIT, 101.0 + off, 1, ts);
+        engine.process_order(&orders.back());
+    }
+    assert(book.user_order_count("MM", Side::BUY) == 500);
+    assert(book.user_order_count("MM", Side::SELL) == 500);
+
+    // Fills (full and partial) and a cancel-replace keep the lists in step with the book
+    Order sweep("T1", Side::BUY, OrderType::MARKET, 3, 10000);
+    engine.process_order(&sweep);                                   // fills MS0 (2) then VS0 (1)
+    assert(orders[1].is_filled() && orders[3].is_filled());
+    assert(book.user_order_count("MM", Side::SELL) == 499);
+    bool modified = engine.modify_order("MB1", 50.0, 2);                    // re-queued, still MM's
+    assert(modified);
+    assert(book.user_order_count("MM", Side::BUY) == 500);
+    std::cout << "PASS  User lists follow fills and cancel-replace\n";
+
+    // 1. One side only, one engine step, one BBO update
+    const size_t bbo_before = md.bbo_updates.size();
+    engine.process_event(EngineEvent::MassCancel("MM", Side::SELL));
+    assert(book.user_order_count("MM", Side::SELL) == 0);
+    assert(book.user_order_count("MM", Side::BUY) == 500);
+    assert(md.bbo_updates.size() == bbo_before + 1);
+    for (const PriceLevel* l = book.get_best_ask(); l; l = l->next)
+        for (const Order* o = l->head; o; o = o->next) assert(o->user_id == "Virat");
+    std::cout << "PASS  Side-scoped mass cancel\n";
+
+    // 2. Cancel-on-disconnect: everything the user has left
+    engine.process_event(EngineEvent::MassCancel("MM"));
+    assert(book.user_order_count("MM", Side::BUY) == 0);
+    assert(book.total_depth(Side::BUY) == other_bid_qty);
+    for (const auto& o : orders) {
+        if (o.user_id == "MM") assert(o.price_level == nullptr);
+        if (o.user_id == "MM" && !o.is_filled()) assert(o.status == OrderStatus::CANCELLED);
+    }
+    bool cancelled = book.cancel_order("MB7");
+    assert(!cancelled);
+    size_t pulled = book.cancel_user_orders("MM");
+    assert(pulled == 0);
+    pulled = book.cancel_user_orders("nobody");
+    assert(pulled == 0);
+    cancelled = book.cancel_order("VB7");
+    assert(cancelled);
+    std::cout << "PASS  Mass cancel touches only the user's orders\n";
+
+    // 3. Armed stops are pulled with the book orders and never fire afterwards
+    Order mm_stop("MM", "MST", Side::BUY, OrderType::STOP_LOSS, 0.0, 1, 101.0, 20000);
+    Order mm_trail("MM", "MTR", Side::SELL, 1, 0.5, 20001);
+    Order other_stop("Virat", "VST", Side::BUY, OrderType::STOP_LOSS, 0.0, 1, 101.0, 20002);
+    engine.process_order(&mm_stop);
+    engine.process_order(&mm_trail);
+    engine.process_order(&other_stop);
+    pulled = book.cancel_user_orders("MM");
+    assert(pulled == 2 && book.pending_stops.size() == 1 && book.trailing_stops.empty());
+    assert(mm_stop.status == OrderStatus::CANCELLED && mm_trail.status == OrderStatus::CANCELLED);
+    Order lift("Rohit", "RL", Side::BUY, OrderType::LIMIT, 101.0, 1, 20003);
+    engine.process_order(&lift);                                    // trades at 101
+    assert(lift.is_filled() && other_stop.filled_quantity == 1);
+    assert(mm_stop.filled_quantity == 0 && mm_trail.filled_quantity == 0);
+    std::cout << "PASS  Mass cancel disarms the user's stops\n\n";
+    engine.set_market_data_publisher(nullptr);
+}
+
+void OrderBookTest::run_order_expiry_test() {
+    std::cout << "=== ORDER EXPIRY TEST ===\n";
+    constexpr uint64_t ms = 1'000'000;
+
+    // 1. Wheel: timers fire on the tick they are due, never early, across every level
+    {
+        TimingWheel wheel;
+        const uint64_t deadlines[] = {3 * ms, 255 * ms, 256 * ms, 70'000 * ms,
+                                      20'000'000 * ms, 5'000'000'000 * ms};   // last one is parked
+        TimerNode nodes[6];
+        for (size_t i = 0; i < 6; ++i) {
+            nodes[i].deadline_ns = deadlines[i];
+            wheel.insert(&nodes[i]);
+        }
+        TimerNode dropped;
+        dropped.deadline_ns = 100 * ms;
+        wheel.insert(&dropped);
+        wheel.remove(&dropped);
+        assert(wheel.size() == 6);
+
+        std::vector<uint64_t> fired_at;
+        auto record = [&](TimerNode* n) {
+            assert(!n->linked);
+            assert(wheel.now() >= n->deadline_ns);
+            fired_at.push_back(n->deadline_ns);
+        };
+        for (size_t i = 0; i < 6; ++i) {
+            size_t fired = wheel.advance(deadlines[i] - ms, record);
+            assert(fired == 0);
+            fired = wheel.advance(deadlines[i], record);
+            assert(fired == 1);
+            assert(fired_at.back() == deadlines[i]);
+        }
+        assert(wheel.empty());
+
+        // A deadline already behind the wheel fires on the next tick
+        TimerNode late;
+        late.deadline_ns = ms;
+        wheel.insert(&late);
+        size_t fired = wheel.advance(wheel.now(), record);
+        assert(fired == 0);
+        fired = wheel.advance(wheel.now() + ms, record);
+        assert(fired == 1);
+    }
+    {
+        // Already due with now_tick's low byte at 0xFF: clamped into level 1, then cascaded
+        TimingWheel wheel(1, 0x1FF);
+        TimerNode due;
+        due.deadline_ns = wheel.now();
+        wheel.insert(&due);
+        size_t fired = wheel.advance(wheel.now() + 1, [](TimerNode*) {});
+        assert(fired == 1);
+        assert(!due.linked && wheel.empty());
+    }
+    {
+        // Deadline between tick boundaries: held until the tick after it, never early
+        TimingWheel wheel;
+        TimerNode mid;
+        mid.deadline_ns = 20 * ms + 900'000;
+        wheel.insert(&mid);
+        size_t fired = wheel.advance(20 * ms, [](TimerNode*) {});
+        assert(fired == 0);
+        fired = wheel.advance(20 * ms + 899'999, [](TimerNode*) {});
+        assert(fired == 0);
+        fired = wheel.advance(21 * ms, [](TimerNode*) {});
+        assert(fired == 1);
+
+        OrderBook fresh;
+        MatchingEngine e2(fresh, fee_calculator);
+        Order gtd("Virat", "G0", Side::BUY, OrderType::LIMIT, 99.0, 10, 1 * ms);
+        gtd.tif = TimeInForce::GTD;
+        gtd.expire_ns = 20 * ms + 900'000;
+        e2.process_order(&gtd);
+        size_t expired = e2.expire_orders(20 * ms);
+        assert(expired == 0 && gtd.status == OrderStatus::OPEN);
+        expired = e2.expire_orders(21 * ms);
+        assert(expired == 1 && gtd.status == OrderStatus::CANCELLED);
+    }
+    std::cout << "PASS  Timing wheel fires on time at every level\n";
+
+    InMemoryMarketDataPublisher md;
+    engine.set_market_data_publisher(&md);
+
+    // 2. GTD rests until its expiry, then leaves like a cancel
+    Order gtd("Virat", "G1", Side::BUY, OrderType::LIMIT, 99.0, 10, 1 * ms);
+    gtd.tif = TimeInForce::GTD;
+    gtd.expire_ns = 50 * ms;
+    engine.process_order(&gtd);
+    Order gtc("Virat", "C1", Side::BUY, OrderType::LIMIT, 98.0, 10, 2 * ms);
+    engine.process_order(&gtc);
+    assert(book.pending_expiries() == 1);
+
+    size_t expired = engine.expire_orders(49 * ms);
+    assert(expired == 0);
+    assert(gtd.status == OrderStatus::OPEN);
+    const size_t bbo_before = md.bbo_updates.size();
+    expired = engine.expire_orders(50 * ms);
+    assert(expired == 1);
+    assert(gtd.status == OrderStatus::CANCELLED && gtd.price_level == nullptr);
+    assert(book.orders.count("G1") == 0);
+    assert(book.user_order_count("Virat", Side::BUY) == 1);
+    assert(book.get_best_bid()->price == 98.0);
+    assert(md.bbo_updates.size() == bbo_before + 1);
+    assert(!md.depth_updates.empty() && md.depth_updates.back().price == 99.0 &&
+           md.depth_updates.back().quantity == 0);
+    assert(engine.expired_orders == 1);
+    std::cout << "PASS  GTD expiry cancels with normal notifications\n";
+
+    // 3. DAY orders take the session close; no purge, each expires as a timer
+    engine.set_session_close(200 * ms);
+    std::vector<Order> day;
+    day.reserve(100);
+    for (int i = 0; i < 100; ++i) {
+        day.emplace_back("MM", "D" + std::to_string(i), Side::SELL, OrderType::LIMIT,
+                         101.0 + i % 10, 1, static_cast<TimeUtils::Timestamp>(60 * ms + static_cast<uint64_t>(i)));
+        day.back().tif = TimeInForce::DAY;
+        engine.process_order(&day.back());
+    }
+    assert(day[0].expire_ns == 200 * ms);
+
+    // Fills, cancels and cancel-replace keep the wheel in step with the book
+    Order lift("T1", Side::BUY, OrderType::MARKET, 10, 70 * ms);
+    engine.process_order(&lift);                                        // fills the ten at 101
+    bool cancelled = book.cancel_order("D1");
+    assert(cancelled);
+    bool modified = engine.modify_order("D2", 150.0, 1);                        // re-armed at the new price
+    assert(modified);
+    assert(book.pending_expiries() == 89);
+
+    expired = engine.expire_orders(199 * ms);
+    assert(expired == 0);
+    const size_t bbo_mid = md.bbo_updates.size();
+    expired = engine.expire_orders(200 * ms);
+    assert(expired == 89);
+    assert(md.bbo_updates.size() == bbo_mid + 1);
+    assert(book.get_best_ask() == nullptr && book.total_depth(Side::SELL) == 0);
+    assert(book.user_order_count("MM", Side::SELL) == 0);
+    for (const auto& o : day) assert(o.price_level == nullptr);
+    std::cout << "PASS  DAY orders expire at session close\n";
+
+    // 4. Already expired on arrival: cancelled without trading
+    Order ask("MM", "A1", Side::SELL, OrderType::LIMIT, 98.0, 5, 300 * ms);
+    engine.process_order(&ask);                                         // crosses into C1
+    assert(ask.is_filled());
+    Order stale("Virat", "S1", Side::BUY, OrderType::LIMIT, 105.0, 5, 300 * ms);
+    stale.tif = TimeInForce::DAY;                                       // session closed at 200 ms
+    engine.process_order(&stale);
+    assert(stale.status == OrderStatus::CANCELLED && stale.filled_quantity == 0);
+    assert(book.pending_expiries() == 0);
+    std::cout << "PASS  Orders past expiry never rest\n\n";
+    engine.set_market_data_publisher(nullptr);
+}
+
+void OrderBookTest::run_peg_order_test() {
+    std::cout << "=== PEG ORDER TEST ===\n";
+    InMemoryMarketDataPublisher md;
+    engine.set_market_data_publisher(&md);
+    auto near = [](double a, double b) { return std::abs(a - b) < 1e-9; };
+
+    Order bid("MM", "B1", Side::BUY, OrderType::LIMIT, 99.0, 10, 1);
+    Order ask("MM", "A1", Side::SELL, OrderType::LIMIT, 101.0, 10, 2);
+    engine.process_order(&bid);
+    engine.process_order(&ask);
+
+    // 1. Many pegs, few groups; nothing displayed
+    const size_t depth_before = md.depth_updates.size();
+    std::vector<Order> pegs;
+    pegs.reserve(1500);
+    for (int i = 0; i < 1000; ++i) {
+        pegs.emplace_back("Peg", "P" + std::to_string(i), Side::BUY, PegReference::MID, 0.0, 1,
+                          static_cast<TimeUtils::Timestamp>(10 + i));
+        engine.process_order(&pegs.back());
+    }
+    for (int i = 0; i < 500; ++i) {
+        pegs.emplace_back("Peg", "Q" + std::to_string(i), Side::BUY, PegReference::PRIMARY, 0.5, 1,
+                          static_cast<TimeUtils::Timestamp>(2000 + i));
+        engine.process_order(&pegs.back());
+    }
+    assert(book.peg_order_count(Side::BUY) == 1500);
+    assert(book.peg_group_count(Side::BUY) == 2);
+    assert(md.depth_updates.size() == depth_before);
+    BBO bbo = book.get_bbo();
+    assert(bbo.bid_price == 99.0 && bbo.bid_quantity == 10);
+    assert(book.user_order_count("Peg", Side::BUY) == 1500);
+    std::cout << "PASS  Pegs group into virtual levels and stay non-displayed\n";
+
+    // 2. A taker meets the midpoint group ahead of the displayed bid
+    Order s1("Virat", "S1", Side::SELL, OrderType::LIMIT, 100.0, 3, 3000);
+    engine.process_order(&s1);
+    assert(s1.is_filled());
+    assert(engine.trades.size() == 3);
+    for (const auto& t : engine.trades) assert(t.price == 100.0);
+    assert(pegs[0].is_filled() && pegs[2].is_filled() && !pegs[3].is_filled());
+    assert(book.peg_order_count(Side::BUY) == 1497);
+    std::cout << "PASS  Midpoint pegs trade inside the spread\n";
+
+    // 3. A BBO move reprices the group without touching its orders
+    Order bid2("MM", "B2", Side::BUY, OrderType::LIMIT, 99.5, 10, 3001);
+    engine.process_order(&bid2);                                    // mid 100.25
+    assert(near(book.best_peg(Side::BUY)->price, 100.25));
+    assert(pegs[3].price == 100.0 && pegs[999].price == 100.0);     // arrival price, never rewritten
+    Order mkt("Virat", Side::SELL, OrderType::MARKET, 2, 3002);
+    engine.process_order(&mkt);
+    assert(near(engine.trades.back().price, 100.25) && pegs[4].is_filled());
+
+    Order a2("MM", "A2", Side::SELL, OrderType::LIMIT, 100.3, 1, 3003);
+    engine.process_order(&a2);                                      // below no peg: rests, mid 99.9
+    assert(a2.status == OrderStatus::OPEN);
+    assert(near(book.best_peg(Side::BUY)->price, (99.5 + 100.3) / 2.0));
+    std::cout << "PASS  BBO move reprices whole groups\n";
+
+    // 4. Opposite pegs at the same midpoint cross on arrival
+    Order sp("Rohit", "SP1", Side::SELL, PegReference::MID, 0.0, 1, 3004);
+    engine.process_order(&sp);
+    assert(sp.status == OrderStatus::COMPLETED && pegs[5].is_filled());
+    assert(near(engine.trades.back().price, (99.5 + 100.3) / 2.0));
+
+    // Displayed liquidity keeps priority at an equal price; a primary peg then fills at the
+    // touch the sweep started from, even though that level is gone
+    Order sq("Rohit", "SP2", Side::SELL, PegReference::PRIMARY, 0.0, 2, 3005);
+    engine.process_order(&sq);                                      // rests at the ask, 100.3
+    Order b3("Virat", "B3", Side::BUY, OrderType::LIMIT, 100.3, 2, 3006);
+    engine.process_order(&b3);
+    assert(a2.is_filled() && b3.is_filled() && sq.filled_quantity == 1);
+    assert(engine.trades.back().sell_order_id == "SP2" && engine.trades.back().price == 100.3);
+    assert(book.best_peg(Side::SELL)->price == 101.0);               // follows the ask to 101
+    Order b4("Virat", "B4", Side::BUY, OrderType::LIMIT, 100.3, 1, 3007);
+    engine.process_order(&b4);
+    assert(b4.status == OrderStatus::OPEN && sq.filled_quantity == 1);
+    Order f0("Virat", "F0", Side::BUY, OrderType::FOK, 101.0, 12, 3008);
+    assert(!book.can_fully_fill(&f0));
+    Order f1("Virat", "F1", Side::BUY, OrderType::FOK, 101.0, 11, 3008);
+    assert(book.can_fully_fill(&f1));                                // 10 at 101, then the peg
+    engine.process_order(&f1);
+    assert(f1.is_filled() && sq.is_filled());
+    std::cout << "PASS  Peg-vs-peg crossing and displayed priority\n";
+
+    // 5. Cancel paths and arrival without a reference
+    bool cancelled = book.cancel_order("P10");
+    assert(cancelled);
+    bool modified = engine.modify_order("P11", 100.0, 5);                  // cancel-only
+    assert(!modified);
+    assert(book.peg_order_count(Side::BUY) == 1493);
+    engine.process_event(EngineEvent::MassCancel("Peg"));
+    assert(book.peg_order_count(Side::BUY) == 0 && book.peg_group_count(Side::BUY) == 0);
+    cancelled = book.cancel_order("SP2");                                   // already filled
+    assert(!cancelled && book.peg_group_count(Side::SELL) == 0);
+
+    OrderBook one_sided;
+    MatchingEngine e2(one_sided, fee_calculator);
+    Order lone("MM", "L1", Side::BUY, OrderType::LIMIT, 50.0, 5, 1);
+    e2.process_order(&lone);
+    Order mid_peg("Peg", "M1", Side::BUY, PegReference::MID, 0.0, 5, 2);
+    e2.process_order(&mid_peg);
+    assert(mid_peg.status == OrderStatus::CANCELLED);
+    Order prim_peg("Peg", "M2", Side::BUY, PegReference::PRIMARY, 0.0, 5, 3);
+    e2.process_order(&prim_peg);
+    assert(prim_peg.status == OrderStatus::OPEN && one_sided.best_peg(Side::BUY)->price == 50.0);
+    std::cout << "PASS  Cancels drop pegs; no reference, no resting\n\n";
+    engine.set_market_data_publisher(nullptr);
+}
+
+void OrderBookTest::run_trailing_stop_test() {
+    std::cout << "=== TRAILING STOP TEST ===\n";
+
+    // 1. Index agrees with a per-stop water mark replay
+    {
+        std::mt19937_64 rng(42);
+        TrailingStops index;
+        std::vector<Order> stops;
+        stops.reserve(3000);
+        std::vector<double> mark;                    // brute force: sell high / buy low since entry
+        std::vector<bool> live;
+        double last = 0.0, price = 100.0;
+        size_t fired_total = 0;
+        for (int step = 0; step < 6000; ++step) {
+            if (step % 2 == 0) {
+                const Side side = rng() % 2 ? Side::BUY : Side::SELL;
+                const double trail = 0.25 * static_cast<double>(1 + rng() % 12);
+                stops.emplace_back("U", "T" + std::to_string(step), side, 1, trail,
+                                   static_cast<TimeUtils::Timestamp>(step + 1));
+                index.add(&stops.back(), last);
+                mark.push_back(last);
+                live.push_back(true);
+                continue;
+            }
+            price += 0.25 * (static_cast<double>(rng() % 9) - 4.0);
+            if (price < 1.0) price = 1.0;
+            last = price;
+
+            std::vector<Order*> fired;
+            index.on_trade(price, fired);
+            std::unordered_set<const Order*> got(fired.begin(), fired.end());
+            for (size_t i = 0; i < stops.size(); ++i) {
+                if (!live[i]) continue;
+                const Order& o = stops[i];
+                const bool sell = o.side == Side::SELL;
+                if (mark[i] <= 0.0) mark[i] = price;
+                else mark[i] = sell ? std::max(mark[i], price) : std::min(mark[i], price);
+                const double trigger = sell ? mark[i] - o.trail_offset : mark[i] + o.trail_offset;
+                const bool fires = sell ? price <= trigger : price >= trigger;
+                assert(fires == (got.count(&o) == 1));
+                if (fires) {
+                    assert(o.stop_price == trigger);
+                    live[i] = false;
+                }
+            }
+            fired_total += fired.size();
+        }
+        assert(fired_total > 0);
+        assert(index.size() == static_cast<size_t>(std::count(live.begin(), live.end(), true)));
+    }
+    std::cout << "PASS  Triggers match per-stop high/low-water marks\n";
+
+    // 2. Many stops, one mark: a trade that fires nothing leaves them untouched
+    {
+        TrailingStops index;
+        std::vector<Order> stops;
+        stops.reserve(100000);
+        for (int i = 0; i < 100000; ++i) {
+            stops.emplace_back("U", "S" + std::to_string(i), Side::SELL, 1,
+                               0.25 * static_cast<double>(1 + i % 400), 1);
+            index.add(&stops.back(), 1000.0);
+        }
+        std::vector<Order*> fired;
+        index.on_trade(1010.0, fired);                              // lifts one class
+        assert(fired.empty() && index.mark_classes() == 1);
+        index.on_trade(1009.5, fired);                              // trails <= 0.5 fire
+        assert(fired.size() == 500 && fired.front()->stop_price == 1009.75);
+        assert(index.size() == 99500);
+    }
+    std::cout << "PASS  One mark class for 100k stops; only firing stops examined\n";
+
+    // Equal trails fire in placement order even when the older class merges into a larger one
+    {
+        TrailingStops index;
+        Order first("U", "F1", Side::SELL, 1, 1.0, 1);
+        Order second("U", "F2", Side::SELL, 1, 1.0, 2);
+        Order third("U", "F3", Side::SELL, 1, 1.0, 3);
+        index.add(&first, 100.0);
+        index.add(&second, 99.0);                                   // newer, lower mark
+        index.add(&third, 99.0);
+        std::vector<Order*> fired;
+        index.on_trade(101.0, fired);                               // merges both classes
+        assert(fired.empty() && index.mark_classes() == 1);
+        index.on_trade(100.0, fired);
+        assert((fired == std::vector<Order*>{&first, &second, &third}));
+    }
+    std::cout << "PASS  Equal trails stay FIFO across merges\n";
+
+    // 3. Engine: the stop follows the rally, fires on the retrace, executes as MARKET
+    std::vector<Order> asks;
+    asks.reserve(4);
+    for (int i = 0; i < 4; ++i) {
+        asks.emplace_back("MM", "A" + std::to_string(i), Side::SELL, OrderType::LIMIT, 100.0 + i, 1, 1);
+        engine.process_order(&asks.back());
+    }
+    std::vector<Order> bids;
+    bids.reserve(5);
+    for (int i = 0; i < 5; ++i) {
+        bids.emplace_back("MM", "B" + std::to_string(i), Side::BUY, OrderType::LIMIT, 99.0 - i, 5, 2);
+        engine.process_order(&bids.back());
+    }
+    Order trail("Virat", "TS1", Side::SELL, 2, 2.0, 3);
+    engine.process_order(&trail);
+    assert(trail.status == OrderStatus::OPEN && book.trailing_stops.size() == 1);
+
+    std::vector<Order> lifts;
+    lifts.reserve(3);
+    for (int i = 0; i < 3; ++i) {
+        lifts.emplace_back("L" + std::to_string(i), Side::BUY, OrderType::MARKET, 1, 4 + i);
+        engine.process_order(&lifts.back());                        // 100, 101, 102
+    }
+    assert(trail.status == OrderStatus::OPEN);
+    Order hit("Rohit", Side::SELL, OrderType::MARKET, 5, 10);
+    engine.process_order(&hit);                                     // 99 <= 102 - 2
+    assert(trail.stop_price == 100.0);
+    assert(trail.type == OrderType::MARKET && trail.status == OrderStatus::COMPLETED);
+    assert(engine.trades.back().price == 98.0 && engine.trades.back().quantity == 2);
+    assert(book.trailing_stops.empty());
+    std::cout << "PASS  Trailing stop fires on the retrace and executes as MARKET\n\n";
+}
+
+void OrderBookTest::run_fee_interning_test() {
+    std::cout << "=== FEE INTERNING TEST ===\n";
+
+    // 1. Dense, stable ids; lookups by name do not intern
+    FeeCalculator fees;
+    const UserIndex a = fees.intern("Alice");
+    const UserIndex b = fees.intern("Bob");
+    assert(a == 0 && b == 1 && fees.intern("Alice") == a);
+    assert(fees.find("Carol") == kNoUser && fees.users.size() == 2);
+    assert(&fees.tier_for("Carol") == &fees.tiers[0]);
+    std::cout << "PASS  Participants intern to dense ids\n";
+
+    // 2. Ids are cached on the order at entry, or on first fill when placed directly
+    Order rest("Alice", "A1", Side::SELL, OrderType::LIMIT, 100.0, 600, 1);
+    book.insert_limit(&rest);
+    assert(rest.user_index == kNoUser);
+    Order take("Bob", "B1", Side::BUY, OrderType::LIMIT, 100.0, 600, 2);
+    engine.process_order(&take);
+    assert(take.user_index != kNoUser && rest.user_index != kNoUser);
+    assert(fee_calculator.users[rest.user_index].rolling_volume == 6000000);    // ledger ticks
+    std::cout << "PASS  Order entry interns once\n";
+
+    // 3. Volume accrues per participant across orders, not per order id
+    Order rest2("Alice", "A2", Side::SELL, OrderType::LIMIT, 100.0, 600, 3);
+    engine.process_order(&rest2);
+    Order take2("Bob", "B2", Side::BUY, OrderType::LIMIT, 100.0, 600, 4);
+    engine.process_order(&take2);
+    assert(fee_calculator.users[rest2.user_index].rolling_volume == 12000000);
+    assert(engine.trades.back().maker_fee == 60000.0 * -0.0001);    // tier 1 by combined volume
+    assert(engine.trades.back().taker_fee == 60000.0 * 0.0004);
+    assert(fee_calculator.tier_for("Alice").maker_bps == -1);
+    assert(fee_calculator.tier_for("Bob").taker_bps == 4);          // promoted on commit
+    std::cout << "PASS  Fee tiers follow the participant\n\n";
+}
+
+void OrderBookTest::run_fee_ledger_test() {
+    std::cout << "=== FEE LEDGER TEST ===\n";
+
+    // 1. Notional and fees are exact integers on the tick grid
+    FeeCalculator fees;
+    assert(fees.notional(100.05, 3) == 30015);
+    assert(fees.notional(0.1 + 0.2, 10) == 300);    // 0.30000000000000004 rounds to 30 ticks
+    assert(fees.to_currency(100000000) == 100.0);
+
+    // By name, volume is currency and lands on the same ledger scale
+    FeeCalculator named;
+    named.update_volume("N", 99999.99);
+    assert(named.users[named.find("N")].rolling_volume == named.notional(99999.99, 1));
+    assert(named.tier_for("N").maker_bps == 0);
+    named.update_volume("N", 0.01);
+    assert(named.tier_for("N").maker_bps == -1);                // exactly the 100,000 tier
+    std::cout << "PASS  Ticks x lots notional\n";
+
+    // 2. One sweep across several makers: each maker accrues per fill, the taker once.
+    //    Both sides are tiered per fill: the taker crosses Tier 1 (10,000,000) on fill 2
+    Order m1("M1", "L1", Side::SELL, OrderType::LIMIT, 100.00, 500, 1);
+    Order m2("M2", "L2", Side::SELL, OrderType::LIMIT, 100.01, 700, 2);
+    Order m3("M1", "L3", Side::SELL, OrderType::LIMIT, 100.02, 900, 3);
+    engine.process_order(&m1);
+    engine.process_order(&m2);
+    engine.process_order(&m3);
+    Order take("T", "T1", Side::BUY, OrderType::LIMIT, 100.02, 2000, 4);
+    engine.process_order(&take);
+    assert(engine.trades.size() == 3);
+
+    const UserFeeState& taker = fee_calculator.users[take.user_index];
+    uint64_t swept = 0;
+    int64_t taker_units = 0, all_units = 0;
+    for(const Trade& t : engine.trades) {
+        swept += fee_calculator.notional(t.price, t.quantity);
+        taker_units += t.taker_fee_units;
+        all_units += t.maker_fee_units + t.taker_fee_units;
+        const int64_t bps = (&t == &engine.trades[0]) ? 5 : 4;
+        assert(t.taker_fee_units == static_cast<int64_t>(fee_calculator.notional(t.price, t.quantity)) * bps);
+    }
+    assert(swept == 10000u * 500 + 10001u * 700 + 10002u * 800);
+    assert(taker.rolling_volume == swept && taker.accrued_fees == taker_units);
+    assert(taker.tier_index == 1);                  // the ledger agrees once the sweep commits
+    assert(fee_calculator.total_fees == all_units);
+    assert(fee_calculator.users[m1.user_index].accrued_fees ==
+           engine.trades[0].maker_fee_units + engine.trades[2].maker_fee_units);
+    std::cout << "PASS  Sweep commits once and reconciles with trades\n";
+
+    // 3. Self-trades pay fees but add no volume
+    Order self("M1", "T2", Side::BUY, OrderType::LIMIT, 100.02, 100, 5);
+    uint64_t before = fee_calculator.users[m1.user_index].rolling_volume;
+    engine.process_order(&self);
+    assert(engine.trades.size() == 4);
+    assert(fee_calculator.users[m1.user_index].rolling_volume == before);
+    assert(engine.trades.back().taker_fee_units > 0);
+    std::cout << "PASS  Self-trades add no volume\n\n";
+}
+
+void OrderBookTest::run_rolling_volume_test() {
+    std::cout << "=== ROLLING VOLUME TEST ===\n";
+
+    // 1. Volume counts for kWindowDays days, then expires with demotion
+    FeeCalculator fees;
+    const UserIndex u = fees.intern("U");
+    const uint64_t tier1 = fees.tiers[1].min_volume;
+    fees.advance_to(0);
+    fees.update_volume(u, tier1 / 2);
+    fees.advance_to(10 * kDayNs);
+    fees.update_volume(u, tier1 / 2);
+    assert(fees.users[u].tier_index == 1);
+    fees.advance_to(29 * kDayNs + kDayNs - 1);      // day 29: day 0 still in the window
+    assert(fees.tier_for("U").maker_bps == -1);
+    fees.advance_to(30 * kDayNs);                   // day 0 rolls out
+    assert(fees.tier_for("U").maker_bps == 0);
+    assert(fees.users[u].rolling_volume == tier1 / 2);
+    fees.advance_to(5 * kDayNs);                    // time never moves the ledger back
+    assert(fees.today == 30);
+    fees.advance_to(100 * kDayNs);                  // idle for a whole window
+    fees.refresh(u);
+    assert(fees.users[u].rolling_volume == 0 && fees.users[u].tier_index == 0);
+    std::cout << "PASS  Window expiry demotes\n";
+
+    // 2. Window sum matches a brute-force replay of the daily history
+    std::mt19937 rng(43);
+    FeeCalculator ref;
+    const UserIndex r = ref.intern("R");
+    std::vector<uint64_t> daily(400, 0);
+    uint32_t day = 0;
+    for(int i = 0; i < 5000; ++i) {
+        day += static_cast<uint32_t>(rng() % 3 == 0 ? rng() % 40 : 0);
+        if(day >= daily.size()) break;
+        uint64_t v = rng() % 3'000'000;
+        ref.advance_to(day * kDayNs);
+        ref.update_volume(r, v);
+        daily[day] += v;
+
+        uint64_t expect = 0;
+        for(uint32_t d = day >= kWindowDays - 1 ? day - (kWindowDays - 1) : 0; d <= day; ++d) expect += daily[d];
+        assert(ref.users[r].rolling_volume == expect);
+        size_t tier = 0;
+        while(tier + 1 < ref.tiers.size() && expect >= ref.tiers[tier + 1].min_volume) ++tier;
+        assert(ref.users[r].tier_index == tier);
+    }
+    std::cout << "PASS  Buckets match brute-force window\n";
+
+    // 3. Inactive users are not touched when the day rolls
+    FeeCalculator many;
+    many.advance_to(0);
+    for(int i = 0; i < 100000; ++i) many.update_volume(many.intern("user" + std::to_string(i)), 1);
+    many.advance_to(45 * kDayNs);
+    many.update_volume(many.intern("user7"), 1);
+    assert(many.users[7].day == 45 && many.users[8].day == 0);
+    assert(many.users[8].rolling_volume == 1);      // stale until refreshed
+    many.refresh(8);
+    assert(many.users[8].rolling_volume == 0);
+    std::cout << "PASS  Inactive users roll lazily\n";
+
+    // 4. The engine takes the ledger day from the event's wall stamp: days turn at UTC
+    //    midnight whatever the engine clock's origin
+    const uint64_t midnight = (TimeUtils::wall_time_ns() / kDayNs + 2) * kDayNs;
+    TimeUtils::VirtualClock clock(5, static_cast<int64_t>(midnight - 1'000'000'000) - 5);
+    engine.set_clock(&clock);                       // one second before a UTC midnight
+    Order s1("Maker", "S1", Side::SELL, OrderType::LIMIT, 100.0, 2000, 1);
+    engine.process_order(&s1);
+    Order b1("Taker", "B1", Side::BUY, OrderType::LIMIT, 100.0, 2000, 2);
+    engine.process_order(&b1);
+    assert(fee_calculator.today == midnight / kDayNs - 1);
+    assert(fee_calculator.tier_for("Maker").maker_bps == -1);
+    clock.advance(2'000'000'000);
+    Order s2("Maker", "S2", Side::SELL, OrderType::LIMIT, 100.0, 10, 3);
+    engine.process_order(&s2);
+    Order b2("Taker", "B2", Side::BUY, OrderType::LIMIT, 100.0, 10, 4);
+    engine.process_order(&b2);
+    assert(fee_calculator.today == midnight / kDayNs);             // next UTC day
+    assert(engine.trades.back().maker_fee_units == -1000 * 100);    // still tier 1
+    clock.advance(30 * kDayNs);
+    Order s3("Maker", "S3", Side::SELL, OrderType::LIMIT, 100.0, 10, 5);
+    engine.process_order(&s3);
+    Order b3("Taker", "B3", Side::BUY, OrderType::LIMIT, 100.0, 10, 6);
+    engine.process_order(&b3);
+    assert(engine.trades.back().maker_fee_units == 0);              // demoted to tier 0
+    assert(engine.trades.back().taker_fee_units == 1000 * 100 * 5);
+    engine.set_clock(nullptr);
+    std::cout << "PASS  Engine rolls at UTC midnight\n\n";
+}
+
+void OrderBookTest::run_fee_aggregation_test() {
+    std::cout << "=== FEE AGGREGATION TEST ===\n";
+
+    // 1. Tiers converge on volume across shards once both have merged
+    FeeAggregator agg(1000);
+    FeeCalculator a, b;
+    agg.attach(a);
+    agg.attach(b);
+    const uint64_t tier1 = a.tiers[1].min_volume;
+    const UserIndex xa = a.intern("X");
+    const UserIndex xb = b.intern("X");
+    a.update_volume(xa, tier1 * 6 / 10);
+    b.update_volume(xb, tier1 * 5 / 10);
+    assert(a.users[xa].tier_index == 0 && b.users[xb].tier_index == 0);
+    agg.maybe_merge(a, 500);                        // within the staleness bound: no merge
+    assert(a.dirty.size() == 1 && agg.volume_of("X") == 0);
+    agg.maybe_merge(a, 1000);
+    agg.maybe_merge(b, 1000);
+    assert(agg.volume_of("X") == tier1 * 11 / 10);
+    assert(a.dirty.empty() && a.users[xa].unmerged == 0);
+    assert(b.tier_for("X").maker_bps == -1);        // b adopted the latest snapshot
+    assert(a.tier_for("X").maker_bps == 0);         // a still reads the older one
+    agg.merge(a, 2000);
+    assert(a.tier_for("X").maker_bps == -1);
+    std::cout << "PASS  Tiers converge across shards\n";
+
+    // 2. Unmerged local volume counts at once; the global window expires it later
+    const UserIndex ya = a.intern("Y");
+    a.update_volume(ya, tier1);
+    assert(a.users[ya].tier_index == 1);
+    agg.merge(a, 3000);
+    assert(a.users[ya].tier_index == 1 && agg.volume_of("Y") == tier1);
+    a.advance_to(40 * kDayNs);
+    agg.merge(a, 40 * kDayNs);
+    assert(agg.volume_of("X") == 0 && a.tier_for("Y").maker_bps == 0);
+    std::cout << "PASS  Global window demotes\n";
+
+    // 3. Shards on their own threads: nothing lost or double counted
+    FeeAggregator shared(0);
+    std::vector<FeeCalculator> shards(4);
+    std::vector<std::thread> workers;
+    for(size_t s = 0; s < shards.size(); ++s) {
+        shared.attach(shards[s]);
+        workers.emplace_back([&shared, &shard = shards[s], s]() {
+            std::mt19937 rng(static_cast<unsigned>(s));
+            for(uint64_t i = 1; i <= 20000; ++i) {
+                shard.update_volume(shard.intern("P" + std::to_string(rng() % 50)), 1 + rng() % 100);
+                if(i % 64 == 0) shared.maybe_merge(shard, i);
+            }
+            shared.merge(shard, ~0ULL);
+        });
+    }
+    for(auto& w : workers) w.join();
+    for(int p = 0; p < 50; ++p) {
+        const std::string name = "P" + std::to_string(p);
+        uint64_t local = 0;
+        for(auto& shard : shards) {
+            UserIndex u = shard.find(name);
+            if(u != kNoUser) local += shard.users[u].rolling_volume;
+        }
+        assert(shared.volume_of(name) == local);
+    }
+    std::cout << "PASS  Concurrent merges reconcile\n";
+
+    // 4. Matching never merges; the engine's loop does, on a timed wake once it is idle
+    FeeAggregator eagg(1'000'000);
+    engine.set_fee_aggregator(&eagg);
+    Order s1("M", "S1", Side::SELL, OrderType::LIMIT, 100.0, 2000, 1);
+    engine.process_order(&s1);
+    Order b1("T", "B1", Side::BUY, OrderType::LIMIT, 100.0, 2000, 2);
+    engine.process_order(&b1);
+    assert(eagg.volume_of("M") == 0 && fee_calculator.dirty.size() == 2);
+    std::thread engine_thread([this] { engine.run(queue); });
+    for(int i = 0; i < 5000 && eagg.volume_of("T") == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(eagg.volume_of("M") == 20000000 && eagg.volume_of("T") == 20000000);
+    queue.push(EngineEvent::Stop());
+    engine_thread.join();
+    std::cout << "PASS  Idle engine merges on a timer\n";
+
+    // 5. Volume unmerged when the day turns is booked on the day it traded
+    FeeAggregator dagg(1000);
+    FeeCalculator c, d;
+    dagg.attach(c);
+    dagg.attach(d);
+    c.advance_to(10 * kDayNs);
+    const UserIndex zc = c.intern("Z");
+    c.update_volume(zc, 700);
+    c.advance_to(11 * kDayNs);                      // the day turns before c merges
+    c.update_volume(zc, 300);
+    assert(c.carried.size() == 1 && c.users[zc].unmerged == 1000);
+    dagg.merge(c, 1000);
+    assert(dagg.volume_of("Z") == 1000 && c.carried.empty() && c.users[zc].queued == 0);
+    d.advance_to(40 * kDayNs);                      // day 10 leaves the window, day 11 stays
+    dagg.merge(d, 1000);
+    assert(dagg.volume_of("Z") == 300);
+    std::cout << "PASS  Pending volume keeps its day\n";
+
+    // 6. A merge copies only the snapshot chunks holding changed volume
+    FeeAggregator cagg(0);
+    FeeCalculator e;
+    cagg.attach(e);
+    const std::string last = "C" + std::to_string(TierSnapshot::kChunk);
+    for(size_t i = 0; i <= TierSnapshot::kChunk; ++i) e.update_volume(e.intern("C" + std::to_string(i)), 1);
+    cagg.merge(e, 0);
+    auto before = cagg.snapshot();
+    assert(before->chunks.size() == 2);
+    e.update_volume(e.find(last), 1);
+    cagg.merge(e, 0);
+    auto after = cagg.snapshot();
+    assert(after->chunks[0] == before->chunks[0] && after->chunks[1] != before->chunks[1]);
+    assert(cagg.volume_of("C0") == 1 && cagg.volume_of(last) == 2);
+    assert(before->volume(TierSnapshot::kChunk) == 1);
+    std::cout << "PASS  Snapshot chunks are copy-on-write\n\n";
+}
+
+void OrderBookTest::run_shard_router_test() {
+    std::cout << "=== SHARD ROUTER TEST ===\n";
+
+    // 1. Symbols intern to dense ids and spread over shards
+    ShardRouter router(3, false);
+    std::vector<SymbolId> ids;
+    for(int s = 0; s < 12; ++s) ids.push_back(router.add_symbol("SYM" + std::to_string(s)));
+    assert(router.add_symbol("SYM3") == ids[3] && ids[11] == 11);
+    assert(router.symbols.find("SYM7") == 7 && router.symbols.find("NOPE") == kNoSymbol);
+    assert(router.symbols.name(5) == "SYM5");
+    std::vector<int> per_shard(3, 0);
+    for(SymbolId id : ids) ++per_shard[router.shard_of(id)];
+    assert(std::count(per_shard.begin(), per_shard.end(), 0) == 0);
+    std::cout << "PASS  Registry and static placement\n";
+
+    // 2. Each symbol's stream gives the same trades as a standalone engine
+    struct Reference {
+        OrderBook book;
+        FeeCalculator fees;
+        MatchingEngine engine{book, fees};
+    };
+    std::vector<std::unique_ptr<Reference>> refs;
+    for(size_t s = 0; s < ids.size(); ++s) refs.push_back(std::make_unique<Reference>());
+
+    std::deque<Order> routed, direct;
+    std::mt19937 rng(45);
+    router.start();
+    for(int i = 0; i < 6000; ++i) {
+        SymbolId sym = ids[rng() % ids.size()];
+        Side side = rng() % 2 ? Side::BUY : Side::SELL;
+        double px = 100.0 + static_cast<double>(rng() % 10) * 0.5;
+        uint64_t qty = 1 + rng() % 20;
+        std::string id = "O" + std::to_string(i);
+        if(rng() % 8 == 0 && i > 0) {
+            std::string victim = "O" + std::to_string(rng() % static_cast<unsigned>(i));
+            router.submit(sym, EngineEvent::Cancel(victim));
+            refs[sym]->engine.process_event(EngineEvent::Cancel(victim));
+            continue;
+        }
+        routed.emplace_back("U" + std::to_string(rng() % 7), id, side, OrderType::LIMIT, px, qty, 0);
+        direct.emplace_back(routed.back().user_id, id, side, OrderType::LIMIT, px, qty, 0);
+        router.submit(sym, EngineEvent::New(&routed.back()));
+        refs[sym]->engine.process_event(EngineEvent::New(&direct.back()));
+    }
+    router.stop();
+
+    size_t total_trades = 0;
+    for(SymbolId sym : ids) {
+        Instrument* inst = router.instrument(sym);
+        assert(inst && inst->symbol == sym);
+        const auto& got = inst->engine.trades;
+        const auto& want = refs[sym]->engine.trades;
+        assert(got.size() == want.size());
+        for(size_t k = 0; k < got.size(); ++k) {
+            assert(got[k].buy_order_id == want[k].buy_order_id);
+            assert(got[k].sell_order_id == want[k].sell_order_id);
+            assert(got[k].price == want[k].price && got[k].quantity == want[k].quantity);
+        }
+        assert(inst->book.get_bbo().bid_price == refs[sym]->book.get_bbo().bid_price);
+        total_trades += got.size();
+    }
+    assert(total_trades > 0);
+    std::cout << "PASS  Per-symbol sequence matches a single engine (" << total_trades << " trades)\n";
+
+    // 3. A symbol lives on its shard only; fee volume meets in the aggregator
+    uint64_t sequenced = 0;
+    for(SymbolId sym : ids) {
+        for(size_t sh = 0; sh < router.shards.size(); ++sh) {
+            const auto& list = router.shards[sh]->instruments;
+            bool here = sym < list.size() && list[sym];
+            assert(here == (sh == router.shard_of(sym)));
+        }
+        sequenced += router.instrument(sym)->sequence;
+    }
+    assert(sequenced == 6000);
+    assert(router.fee_aggregator.snapshot()->epoch >= 1);
+    std::cout << "PASS  Ownership and sequencing\n";
+
+    // 4. Each symbol's trades and depth reach its own publishers while the router runs
+    ShardRouter live(2, false);
+    SymbolId p0 = live.add_symbol("PUB0"), p1 = live.add_symbol("PUB1");
+    InMemoryTradePublisher trades0, trades1;
+    InMemoryMarketDataPublisher depth0;
+    live.set_publishers(p0, &trades0, &depth0);
+    live.set_publishers(p1, &trades1, nullptr);
+    std::deque<Order> flow;
+    live.start();
+    for(SymbolId sym : {p0, p1}) {
+        flow.emplace_back("A", "PS" + std::to_string(sym), Side::SELL, OrderType::LIMIT, 10.0, 5, 0);
+        live.submit(sym, EngineEvent::New(&flow.back()));
+        flow.emplace_back("B", "PB" + std::to_string(sym), Side::BUY, OrderType::LIMIT, 10.0, 3, 0);
+        live.submit(sym, EngineEvent::New(&flow.back()));
+    }
+    live.stop();
+    assert(trades0.events.size() == 1 && trades1.events.size() == 1);
+    assert(trades0.events[0].quantity == 3 && trades1.events[0].quantity == 3);
+    assert(!depth0.depth_updates.empty() && !depth0.bbo_updates.empty());
+    std::cout << "PASS  Per-symbol publishers\n";
+
+    // 5. A shard on a VirtualClock stamps and merges fee volume on replayed time only
+    ShardRouter replay(1, false);
+    TimeUtils::VirtualClock vclock(1'000);
+    replay.shards[0]->clock = &vclock;
+    replay.fee_aggregator.max_staleness_ns = 1'000'000;
+    SymbolId r0 = replay.add_symbol("REPLAY");
+    std::deque<Order> recorded;
+    replay.start();
+    recorded.emplace_back("A", "RS", Side::SELL, OrderType::LIMIT, 10.0, 5, 0);
+    replay.submit(r0, EngineEvent::New(&recorded.back()).at(2'000));
+    recorded.emplace_back("B", "RB", Side::BUY, OrderType::LIMIT, 10.0, 5, 0);
+    replay.submit(r0, EngineEvent::New(&recorded.back()).at(3'000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));     // idle wakes, replayed time still
+    assert(replay.fee_aggregator.volume_of("A") == 0);
+    recorded.emplace_back("A", "RS2", Side::SELL, OrderType::LIMIT, 11.0, 1, 0);
+    replay.submit(r0, EngineEvent::New(&recorded.back()).at(2'000'000));
+    for (int i = 0; i < 5000 && replay.fee_aggregator.volume_of("A") == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(replay.fee_aggregator.volume_of("A") == 5000);
+    replay.stop();
+    assert(replay.instrument(r0)->engine.trades.front().engine_ts == 3'000);
+    std::cout << "PASS  Shard clock drives stamps and merges\n";
+
+    // 6. A GTD quote arriving in a mass quote arms the shard's expiry poll; time moved
+    //    by another symbol's event expires it without a GTD new order on the shard
+    ShardRouter quoting(1, false);
+    TimeUtils::VirtualClock qclock(1'000'000);
+    quoting.shards[0]->clock = &qclock;
+    SymbolId q0 = quoting.add_symbol("QUOTED"), q1 = quoting.add_symbol("OTHER");
+    Order quote("MM", "Q1", Side::BUY, OrderType::LIMIT, 10.0, 5, 0);
+    quote.tif = TimeInForce::GTD;
+    quote.expire_ns = 5'000'000;
+    MassQuote mq{"MM", {&quote}};
+    Order other("B", "X1", Side::BUY, OrderType::LIMIT, 20.0, 1, 0);
+    quoting.start();
+    quoting.submit(q0, EngineEvent::Quotes(&mq).at(2'000'000));
+    quoting.submit(q1, EngineEvent::New(&other).at(10'000'000));
+    quoting.stop();
+    assert(quote.status == OrderStatus::CANCELLED && quote.price_level == nullptr);
+    assert(quoting.instrument(q0)->book.pending_expiries() == 0);
+    std::cout << "PASS  Mass-quoted GTD orders expire on the shard\n\n";
+}
+
+void OrderBookTest::run_shard_migration_test() {
+    std::cout << "=== SHARD MIGRATION TEST ===\n";
+
+    // 1. Symbols bounce between shards under live flow; nothing is lost or reordered
+    ShardRouter router(3, false);
+    std::vector<SymbolId> ids;
+    for(int s = 0; s < 6; ++s) ids.push_back(router.add_symbol("MIG" + std::to_string(s)));
+
+    struct Reference {
+        OrderBook book;
+        FeeCalculator fees;
+        MatchingEngine engine{book, fees};
+    };
+    std::vector<std::unique_ptr<Reference>> refs;
+    for(size_t s = 0; s < ids.size(); ++s) refs.push_back(std::make_unique<Reference>());
+
+    std::deque<Order> routed, direct;
+    std::atomic<bool> done{false};
+    constexpr int kEvents = 20000;
+    router.start();
+    std::thread producer([&]() {
+        std::mt19937 rng(46);
+        for(int i = 0; i < kEvents; ++i) {
+            SymbolId sym = ids[rng() % ids.size()];
+            Side side = rng() % 2 ? Side::BUY : Side::SELL;
+            double px = 50.0 + static_cast<double>(rng() % 8);
+            uint64_t qty = 1 + rng() % 9;
+            std::string id = "M" + std::to_string(i);
+            if(rng() % 6 == 0 && i > 0) {
+                std::string victim = "M" + std::to_string(rng() % static_cast<unsigned>(i));
+                router.submit(sym, EngineEvent::Cancel(victim));
+                refs[sym]->engine.process_event(EngineEvent::Cancel(victim));
+                continue;
+            }
+            routed.emplace_back("U" + std::to_string(rng() % 5), id, side, OrderType::LIMIT, px, qty, 0);
+            direct.emplace_back(routed.back().user_id, id, side, OrderType::LIMIT, px, qty, 0);
+            router.submit(sym, EngineEvent::New(&routed.back()));
+            refs[sym]->engine.process_event(EngineEvent::New(&direct.back()));
+        }
+        done = true;
+    });
+    std::mt19937 mover(7);
+    size_t moves = 0;
+    while(!done) {
+        SymbolId sym = ids[mover() % ids.size()];
+        if(router.migrate(sym, static_cast<uint32_t>(mover() % 3))) ++moves;
+        std::this_thread::yield();
+    }
+    producer.join();
+    router.stop();
+    assert(moves > 0 && router.migrations_in_flight() == 0);
+
+    uint64_t sequenced = 0;
+    for(SymbolId sym : ids) {
+        Instrument* inst = router.instrument(sym);
+        assert(inst);
+        for(size_t sh = 0; sh < router.shards.size(); ++sh) {
+            const auto& list = router.shards[sh]->instruments;
+            assert((sym < list.size() && list[sym]) == (sh == router.shard_of(sym)));
+        }
+        const auto& got = inst->engine.trades;
+        const auto& want = refs[sym]->engine.trades;
+        assert(got.size() == want.size());
+        for(size_t k = 0; k < got.size(); ++k) {
+            assert(got[k].buy_order_id == want[k].buy_order_id);
+            assert(got[k].sell_order_id == want[k].sell_order_id);
+            assert(got[k].quantity == want[k].quantity);
+        }
+        sequenced += inst->sequence;
+    }
+    assert(sequenced == static_cast<uint64_t>(kEvents));
+    std::cout << "PASS  " << moves << " live migrations, sequences intact\n";
+
+    // 2. A migrated book charges fees to its new shard's calculator
+    for(SymbolId sym : ids) {
+        Instrument* inst = router.instrument(sym);
+        FeeCalculator& home = router.shards[router.shard_of(sym)]->fees;
+        inst->book.for_each_order([&](Order* o) {
+            assert(o->user_index == kNoUser || home.names[o->user_index] == o->user_id);
+        });
+    }
+    std::cout << "PASS  Participant ids rebound\n";
+
+    // 3. Telemetry counts every applied event; the planner moves load off the hot shard
+    LoadReport report = router.sample();
+    uint64_t shard_total = 0, symbol_total = 0;
+    for(const ShardLoad& s : report.shards) { shard_total += s.events; assert(s.queue_depth == 0); }
+    for(const SymbolLoad& s : report.symbols) symbol_total += s.events;
+    assert(shard_total == static_cast<uint64_t>(kEvents) && symbol_total == shard_total);
+
+    LoadReport synthetic;
+    synthetic.shards.resize(3);
+    synthetic.symbols = {{0, 0, 0, 900.0}, {1, 0, 0, 300.0}, {2, 0, 0, 250.0},
+                         {3, 1, 0, 400.0}, {4, 2, 0, 100.0}};
+    auto move = ShardRouter::pick_move(synthetic, 0.2);
+    assert(move && move->first == 0 && move->second == 2);  // 1450 vs 100: 900 is nearest half the gap
+    synthetic.symbols = {{0, 0, 0, 1000.0}, {1, 1, 0, 10.0}, {2, 2, 0, 10.0}};
+    assert(!ShardRouter::pick_move(synthetic, 0.2));        // a lone hot name cannot be split
+    synthetic.symbols = {{0, 0, 0, 100.0}, {1, 1, 0, 100.0}, {2, 2, 0, 110.0}};
+    assert(!ShardRouter::pick_move(synthetic, 0.2));        // within tolerance
+    std::cout << "PASS  Telemetry and move planning\n\n";
+}
+
+void OrderBookTest::run_tsc_clock_test() {
+    std::cout << "=== TSC CLOCK TEST ===\n";
+    using namespace TimeUtils;
+
+    // 1. Strictly increasing per thread, and cheap
+    constexpr int kReads = 1'000'000;
+    Timestamp prev = now_ns();
+    auto t0 = std::chrono::steady_clock::now();
+    for(int i = 0; i < kReads; ++i) {
+        Timestamp t = now_ns();
+        assert(t > prev);
+        prev = t;
+    }
+    double per_read = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / kReads;
+    std::cout << "PASS  Monotonic (" << (tsc_available() ? "tsc" : "steady_clock")
+              << ", ~" << static_cast<int>(per_read) << " ns per read)\n";
+
+    // 2. Tracks steady_clock and system_clock, also across a forced recalibration
+    auto near = [](uint64_t a, uint64_t b, uint64_t tol) { return (a > b ? a - b : b - a) <= tol; };
+    for(int round = 0; round < 2; ++round) {
+        assert(near(now_ns(), steady_ns(), 1'000'000));
+        uint64_t sys = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+        assert(near(wall_time_ns(), sys, 5'000'000));
+        Timestamp before = now_ns();
+        this_thread_clock.sync(true);
+        assert(now_ns() > before);
+    }
+    std::cout << "PASS  Calibrated to steady and wall clocks\n";
+
+    // 3. Threads keep their own monotonic state and agree with each other in time
+    std::vector<std::thread> threads;
+    std::vector<Timestamp> last(4, 0);
+    for(size_t k = 0; k < last.size(); ++k) {
+        threads.emplace_back([&last, k]() {
+            Timestamp p = now_ns();
+            for(int i = 0; i < 200'000; ++i) {
+                Timestamp t = now_ns();
+                assert(t > p);
+                p = t;
+            }
+            last[k] = p;
+        });
+    }
+    for(auto& t : threads) t.join();
+    Timestamp after = now_ns();
+    for(Timestamp l : last) assert(l < after + 1'000'000);
+    std::cout << "PASS  Per-thread clocks\n\n";
+}
+
+// ─── Per-event stamp test ─────────────────────────────────────────────────────
+
+void OrderBookTest::run_event_stamp_test() {
+    std::cout << "=== EVENT STAMP TEST ===\n";
+
+    InMemoryTradePublisher tp;
+    InMemoryMarketDataPublisher md;
+    engine.set_trade_publisher(&tp);
+    engine.set_market_data_publisher(&md);
+
+    // 1. Every resting order is its own event: contiguous sequences
+    std::deque<Order> asks;
+    for(int i = 0; i < 200; ++i) {
+        asks.emplace_back("Maker", "S" + std::to_string(i), Side::SELL, OrderType::LIMIT,
+                          100.0 + i % 20, 1, 0);
+        engine.process_order(&asks.back());
+        assert(engine.stamp.sequence == static_cast<uint64_t>(i + 1));
+    }
+    assert(asks.front().timestamp_ns < asks.back().timestamp_ns);
+    std::cout << "PASS  One sequence per event\n";
+
+    // 2. A 200-fill sweep shares one stamp across trades, depth and BBO
+    md.depth_updates.clear();
+    md.bbo_updates.clear();
+    Order buy("Taker", "B1", Side::BUY, OrderType::MARKET, 0.0, 200, 0);
+    engine.process_event(EngineEvent::New(&buy));
+    const EventStamp sweep = engine.stamp;
+    assert(sweep.sequence == 201);
+    assert(buy.timestamp_ns == sweep.engine_ns);
+    assert(engine.trades.size() == 200 && tp.events.size() == 200);
+    for(size_t i = 0; i < 200; ++i) {
+        const Trade& t = engine.trades[i];
+        assert(t.event_sequence == sweep.sequence);
+        assert(t.engine_ts == sweep.engine_ns && t.wall_ts == sweep.wall_ns);
+        assert(tp.events[i].event_sequence == sweep.sequence);
+        assert(tp.events[i].engine_ts == sweep.engine_ns);
+    }
+    assert(!md.depth_updates.empty());
+    for(const DepthUpdate& d : md.depth_updates) {
+        assert(d.event_sequence == sweep.sequence && d.engine_ts == sweep.engine_ns);
+    }
+    assert(md.bbo_updates.size() == 1);
+    assert(md.bbo_updates.back().event_sequence == sweep.sequence);
+    std::cout << "PASS  Sweep fills share the event stamp\n";
+
+    // 3. Cancels and mass quotes take the next sequence; nested entry points reuse it
+    Order rest("Maker", "R1", Side::SELL, OrderType::LIMIT, 105.0, 5, 0);
+    engine.process_event(EngineEvent::New(&rest));
+    assert(engine.stamp.sequence == 202);
+    engine.process_event(EngineEvent::Cancel("R1"));
+    assert(engine.stamp.sequence == 203);
+    assert(md.depth_updates.back().quantity == 0);
+    assert(md.depth_updates.back().event_sequence == 203);
+    assert(engine.stamp.engine_ns > sweep.engine_ns);
+
+    Order q1("MM", "Q1", Side::BUY, OrderType::LIMIT, 99.0, 5, 0);
+    Order q2("MM", "Q2", Side::SELL, OrderType::LIMIT, 101.0, 5, 0);
+    MassQuote mq{"MM", {&q1, &q2}};
+    MassQuoteAck ack = engine.mass_quote(mq);
+    assert(ack.event_sequence == 204 && engine.event_sequence == 204);
+    assert(q1.timestamp_ns == q2.timestamp_ns);
+
+    // No-op polls and events publish nothing and take no sequence number
+    Order gtd("Maker", "G1", Side::SELL, OrderType::LIMIT, 107.0, 1, 0);
+    gtd.tif = TimeInForce::GTD;
+    gtd.expire_ns = TimeUtils::now_ns() + 3'600'000'000'000ULL;
+    engine.process_event(EngineEvent::New(&gtd));
+    assert(engine.event_sequence == 205);
+    for(int i = 0; i < 5; ++i) engine.expire_orders(TimeUtils::now_ns());
+    engine.process_event(EngineEvent::Cancel("nope"));
+    engine.process_event(EngineEvent::Modify("nope", 100.0, 1));
+    engine.process_event(EngineEvent::Modify("G1", 107.0, 1));
+    engine.process_event(EngineEvent::MassCancel("nobody"));
+    assert(engine.event_sequence == 205);
+    size_t expired = engine.expire_orders(gtd.expire_ns + TimingWheel::kDefaultTickNs);
+    assert(expired == 1 && engine.event_sequence == 206);
+    assert(md.depth_updates.back().event_sequence == 206);
+    std::cout << "PASS  Gap-free sequence across event types\n";
+
+    // 4. Stamps stay strictly increasing when the engine changes threads
+    const TimeUtils::Timestamp ahead = TimeUtils::now_ns() + 1'000'000'000;
+    engine.stamp.engine_ns = ahead;                 // last stamped on a thread reading ahead
+    Order late("Maker", "L1", Side::SELL, OrderType::LIMIT, 106.0, 1, 0);
+    engine.process_event(EngineEvent::New(&late));
+    assert(late.timestamp_ns == ahead + 1);
+    Order moved("Maker", "L2", Side::SELL, OrderType::LIMIT, 106.0, 1, 0);
+    std::thread other([&]() { engine.process_event(EngineEvent::New(&moved)); });
+    other.join();
+    assert(moved.timestamp_ns > late.timestamp_ns);
+    std::cout << "PASS  Stamps monotonic across threads\n\n";
+
+    engine.set_trade_publisher(nullptr);
+    engine.set_market_data_publisher(nullptr);
+}
+
+// ─── Virtual clock replay test ────────────────────────────────────────────────
+
+void OrderBookTest::run_virtual_clock_test() {
+    std::cout << "=== VIRTUAL CLOCK TEST ===\n";
+    using TimeUtils::Timestamp;
+    constexpr Timestamp T0 = 1'700'000'000'000'000'000ULL;   // recorded session start
+    constexpr int64_t kWallOffset = 1'000;
+    constexpr Timestamp kMs = 1'000'000;         // expiry resolves to whole wheel ticks
+
+    struct Session {
+        std::deque<Order> orders;
+        InMemoryTradePublisher tp;
+        InMemoryMarketDataPublisher md;
+        std::deque<Trade> trades;
+        uint64_t expired = 0;
+    };
+
+    // Replays one recorded session on a fresh engine driven by a VirtualClock
+    auto replay = [&](Session& s) {
+        FeeCalculator fees;
+        OrderBook b;
+        MatchingEngine e(b, fees);
+        TimeUtils::VirtualClock vclock(T0, kWallOffset);
+        e.set_clock(&vclock);
+        e.set_trade_publisher(&s.tp);
+        e.set_market_data_publisher(&s.md);
+
+        auto add = [&](const char* uid, const char* id, Side side, OrderType type, double px, uint64_t qty) {
+            s.orders.emplace_back(uid, id, side, type, px, qty, 0);
+            return &s.orders.back();
+        };
+        Order* s1 = add("A", "S1", Side::SELL, OrderType::LIMIT, 100.0, 5);
+        s1->tif = TimeInForce::GTD;
+        s1->expire_ns = T0 + 50 * kMs;
+        assert(s1->wall_timestamp_ns == 0);     // construction reads no clock
+
+        e.process_event(EngineEvent::New(s1).at(T0 + 10 * kMs));
+        e.process_event(EngineEvent::New(add("A", "S2", Side::SELL, OrderType::LIMIT, 101.0, 5)).at(T0 + 20 * kMs));
+        e.process_event(EngineEvent::New(add("B", "B1", Side::BUY, OrderType::LIMIT, 99.0, 3)).at(T0 + 30 * kMs));
+        e.process_event(EngineEvent::New(add("C", "B2", Side::BUY, OrderType::MARKET, 0.0, 4)).at(T0 + 60 * kMs));
+        e.process_event(EngineEvent::Modify("B1", 99.5, 6).at(T0 + 70 * kMs));
+        e.process_event(EngineEvent::Cancel("S2").at(T0 + 80 * kMs));
+        vclock.advance(20 * kMs);
+        e.expire_orders(e.clock_now_ns());
+
+        for(const Trade& t : e.trades) s.trades.push_back(t);
+        s.expired = e.expired_orders;
+        assert(s1->timestamp_ns == T0 + 10 * kMs);
+        assert(s1->wall_timestamp_ns == T0 + 10 * kMs + kWallOffset);
+    };
+
+    Session a;
+    replay(a);
+    assert(a.expired == 1);
+    assert(a.orders[0].status == OrderStatus::CANCELLED);
+    assert(a.trades.size() == 1);
+    assert(a.trades[0].price == 101.0 && a.trades[0].quantity == 4);
+    assert(a.trades[0].engine_ts == T0 + 60 * kMs);
+    assert(a.trades[0].wall_ts == T0 + 60 * kMs + kWallOffset);
+    std::cout << "PASS  Recorded times drive stamps and expiry\n";
+
+    Session b;
+    replay(b);
+    assert(a.trades.size() == b.trades.size() && a.tp.events.size() == b.tp.events.size());
+    for(size_t i = 0; i < a.tp.events.size(); ++i) {
+        const TradeEvent& x = a.tp.events[i];
+        const TradeEvent& y = b.tp.events[i];
+        assert(x.buy_order_id == y.buy_order_id && x.sell_order_id == y.sell_order_id);
+        assert(x.price == y.price && x.quantity == y.quantity);
+        assert(x.engine_ts == y.engine_ts && x.wall_ts == y.wall_ts);
+        assert(x.maker_fee == y.maker_fee && x.taker_fee == y.taker_fee);
+        assert(x.event_sequence == y.event_sequence);
+    }
+    assert(a.md.depth_updates.size() == b.md.depth_updates.size());
+    for(size_t i = 0; i < a.md.depth_updates.size(); ++i) {
+        const DepthUpdate& x = a.md.depth_updates[i];
+        const DepthUpdate& y = b.md.depth_updates[i];
+        assert(x.side == y.side && x.price == y.price && x.quantity == y.quantity);
+        assert(x.event_sequence == y.event_sequence && x.engine_ts == y.engine_ts);
+    }
+    assert(a.md.bbo_updates.size() == b.md.bbo_updates.size());
+    for(size_t i = 0; i < a.md.bbo_updates.size(); ++i) {
+        assert(a.md.bbo_updates[i].bbo == b.md.bbo_updates[i].bbo);
+        assert(a.md.bbo_updates[i].engine_ts == b.md.bbo_updates[i].engine_ts);
+    }
+    for(size_t i = 0; i < a.orders.size(); ++i) {
+        assert(a.orders[i].timestamp_ns == b.orders[i].timestamp_ns);
+        assert(a.orders[i].status == b.orders[i].status);
+    }
+    std::cout << "PASS  Replay is identical run to run\n\n";
+}
+
+// ─── ISO-8601 formatter test ──────────────────────────────────────────────────
+
+void OrderBookTest::run_iso8601_test() {
+    std::cout << "=== ISO-8601 FORMATTER TEST ===\n";
+    using namespace TimeUtils;
+
+    // gmtime_r reference, the formatter's previous implementation
+    auto reference = [](Timestamp ns, bool nanos) {
+        std::time_t tt = static_cast<std::time_t>(ns / 1'000'000'000);
+        std::tm tm{};
+        gmtime_r(&tt, &tm);
+        char buf[64];
+        uint64_t frac = ns % 1'000'000'000;
+        if(nanos) std::snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%09lluZ",
+                                tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+                                tm.tm_min, tm.tm_sec, static_cast<unsigned long long>(frac));
+        else std::snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%06lluZ",
+                           tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+                           tm.tm_min, tm.tm_sec, static_cast<unsigned long long>(frac / 1000));
+        return std::string(buf);
+    };
+
+    // 1. Calendar edges and random instants up to 2500, both precisions
+    std::vector<Timestamp> samples = {
+        0,                                  // 1970-01-01T00:00:00
+        951'782'399'999'999'999ULL,         // 2000-02-28T23:59:59.999999999
+        951'782'400'000'000'000ULL,         // 2000-02-29
+        4'107'542'400'000'000'000ULL,       // 2100-03-01 (2100 is not a leap year)
+        1'704'067'199'123'456'789ULL,       // 2023-12-31T23:59:59.123456789
+        wall_time_ns(),
+    };
+    std::mt19937_64 rng(7);
+    for(int i = 0; i < 100'000; ++i) samples.push_back(rng() % 16'725'225'600'000'000'000ULL);
+
+    Iso8601Formatter fmt;
+    char buf[kIso8601NsLength];
+    for(Timestamp ns : samples) {
+        assert(std::string(buf, fmt.format(ns, buf)) == reference(ns, false));
+        assert(std::string(buf, fmt.format_ns(ns, buf)) == reference(ns, true));
+        assert(to_iso8601(ns) == reference(ns, false));
+    }
+    assert(to_iso8601_ns(samples[1]) == "2000-02-28T23:59:59.999999999Z");
+    std::cout << "PASS  Matches gmtime for " << samples.size() << " instants\n";
+
+    // 2. Within one second only the fraction is written; crossing it refreshes the prefix
+    Timestamp base = 1'704'067'199'000'000'000ULL;
+    fmt.format(base, buf);
+    for(Timestamp step = 0; step < 1'000'000'000; step += 7'777'777) {
+        fmt.format_ns(base + step, buf);
+        assert(fmt.cached_second == base / 1'000'000'000);
+        assert(std::string(buf, kIso8601NsLength) == reference(base + step, true));
+    }
+    assert(std::string(buf, fmt.format(base + 1'000'000'000, buf)) == "2024-01-01T00:00:00.000000Z");
+    std::cout << "PASS  Cached second prefix\n";
+
+    // 3. Throughput of the trade-log case: consecutive wall stamps, no allocation
+    constexpr int kStamps = 1'000'000;
+    Timestamp t = wall_time_ns();
+    size_t bytes = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for(int i = 0; i < kStamps; ++i) bytes += format_iso8601_ns(t + static_cast<Timestamp>(i) * 997, buf) + buf[25];
+    double per = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / kStamps;
+    assert(bytes > 0);
+    std::cout << "PASS  ~" << static_cast<int>(per) << " ns per timestamp\n\n";
+}
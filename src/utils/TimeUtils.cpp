@@ -1,58 +1,93 @@
 #include "utils/TimeUtils.hpp"
-#include <iomanip>
-#include <sstream>
 #include <cassert>
-#include <ctime>
+#include <cstring>
 
 namespace MatchEngine::TimeUtils{
 
-Timestamp now_ns(){
-    static Timestamp last = 0;
+namespace{
 
-    auto now=EngineClock::now();
-    auto duration=now.time_since_epoch();
+constexpr uint64_t kNsPerSecond=1'000'000'000;
 
-    Timestamp current = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+// "00".."99"
+constexpr char kDigitPairs[]=
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
 
-    if(current <= last) current = last + 1; // Ensure monotonicity
-    last = current;
-
-    return current;
+inline void put2(char* out, uint32_t v){
+    std::memcpy(out, kDigitPairs+2*v, 2);
 }
 
-uint64_t wall_time_ns() {
-    auto now = WallClock::now();
-    auto duration = now.time_since_epoch();
-
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+// n digits of v, most significant first; n is even
+inline void put_even(char* out, uint32_t v, int n){
+    for(int i=n-2;i>=0;i-=2){
+        put2(out+i, v%100);
+        v/=100;
+    }
 }
 
-std::string to_iso8601(Timestamp timestamp_ns){
-
-    using namespace std::chrono;
-
-    nanoseconds total_ns(timestamp_ns);
-    seconds sec=duration_cast<seconds>(total_ns);
-    nanoseconds ns = total_ns - sec;
-
-    std::time_t tt=sec.count();
+}// namespace
+
+// Civil date from days since 1970-01-01 (proleptic Gregorian, H. Hinnant's algorithm)
+void Iso8601Formatter::refresh(uint64_t second){
+    cached_second=second;
+    uint32_t days=static_cast<uint32_t>(second/86400);
+    uint32_t sod=static_cast<uint32_t>(second%86400);
+
+    uint32_t z=days+719468;
+    uint32_t era=z/146097;
+    uint32_t doe=z-era*146097;
+    uint32_t yoe=(doe-doe/1460+doe/36524-doe/146096)/365;
+    uint32_t doy=doe-(365*yoe+yoe/4-yoe/100);
+    uint32_t mp=(5*doy+2)/153;
+    uint32_t day=doy-(153*mp+2)/5+1;
+    uint32_t month=mp<10 ? mp+3 : mp-9;
+    uint32_t year=yoe+era*400+(month<=2);
+    assert(year<=9999);
+
+    put_even(prefix, year, 4);
+    prefix[4]='-';
+    put2(prefix+5, month);
+    prefix[7]='-';
+    put2(prefix+8, day);
+    prefix[10]='T';
+    put2(prefix+11, sod/3600);
+    prefix[13]=':';
+    put2(prefix+14, sod/60%60);
+    prefix[16]=':';
+    put2(prefix+17, sod%60);
+}
 
-    std::tm utc_tm{};
-#if defined(_MSC_VER)
-    gmtime_s(&utc_tm, &tt);
-#else
-    gmtime_r(&tt, &utc_tm);
-#endif
+size_t Iso8601Formatter::format(Timestamp wall_ns, char* out){
+    uint64_t second=wall_ns/kNsPerSecond;
+    if(second!=cached_second) refresh(second);
+    std::memcpy(out, prefix, sizeof(prefix));
+    out[19]='.';
+    put_even(out+20, static_cast<uint32_t>(wall_ns%kNsPerSecond/1000), 6);
+    out[26]='Z';
+    return kIso8601Length;
+}
 
-    std::ostringstream oss;
-    oss << std::put_time(&utc_tm, "%Y-%m-%dT%H:%M:%S");
+size_t Iso8601Formatter::format_ns(Timestamp wall_ns, char* out){
+    uint64_t second=wall_ns/kNsPerSecond;
+    if(second!=cached_second) refresh(second);
+    std::memcpy(out, prefix, sizeof(prefix));
+    out[19]='.';
+    uint32_t ns=static_cast<uint32_t>(wall_ns%kNsPerSecond);
+    out[20]=static_cast<char>('0'+ns/100'000'000);
+    put_even(out+21, ns%100'000'000, 8);
+    out[29]='Z';
+    return kIso8601NsLength;
+}
 
-    // microseconds precision
-    auto micros=duration_cast<microseconds>(ns).count();
-    oss << "." << std::setw(6) << std::setfill('0') << micros; // microseconds
+std::string to_iso8601(Timestamp timestamp_ns){
+    char buf[kIso8601Length];
+    return std::string(buf, format_iso8601(timestamp_ns, buf));
+}
 
-    oss << "Z"; // UTC indicator
-    return oss.str();
+std::string to_iso8601_ns(Timestamp timestamp_ns){
+    char buf[kIso8601NsLength];
+    return std::string(buf, format_iso8601_ns(timestamp_ns, buf));
 }
 
-}// namespace MatchEngine
\ No newline at end of file
+}// namespace MatchEngine
@@ -0,0 +1,111 @@
+#include "utils/TscClock.hpp"
+
+#include <chrono>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace MatchEngine::TimeUtils{
+
+namespace{
+
+uint64_t wall_now_ns(){
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// Tick and steady_clock read back to back; the tighter of a few tries
+void sample_pair(bool use_tsc, uint64_t& ticks, uint64_t& ns){
+    uint64_t best=~0ULL;
+    for(int i=0;i<5;++i){
+        uint64_t t0=read_ticks(use_tsc);
+        uint64_t s=steady_ns();
+        uint64_t t1=read_ticks(use_tsc);
+        if(t1-t0<best){
+            best=t1-t0;
+            ticks=t0+(t1-t0)/2;
+            ns=s;
+        }
+    }
+}
+
+struct Calibrator{
+    std::mutex mtx;
+    bool ready=false;
+    uint64_t base_tsc=0, base_ns=0;         // first anchor; rate is fitted from here
+    ClockCalibration cal;
+
+    void anchor(){
+        sample_pair(cal.use_tsc, cal.tsc, cal.steady_ns);
+        cal.wall_offset_ns=static_cast<int64_t>(wall_now_ns())-static_cast<int64_t>(steady_ns());
+    }
+
+    void initialise(){
+        cal.use_tsc=tsc_available();
+        sample_pair(cal.use_tsc, base_tsc, base_ns);
+        if(cal.use_tsc){
+            uint64_t t=0, ns=0;
+            do sample_pair(true, t, ns); while(ns-base_ns<kInitialCalibrationNs);
+            cal.ns_per_tick=static_cast<double>(ns-base_ns)/static_cast<double>(t-base_tsc);
+        }
+        anchor();
+        ready=true;
+    }
+
+    void recalibrate(){
+        anchor();
+        if(cal.use_tsc && cal.tsc>base_tsc){
+            cal.ns_per_tick=static_cast<double>(cal.steady_ns-base_ns)/static_cast<double>(cal.tsc-base_tsc);
+        }
+    }
+
+    uint64_t ns_since_anchor(){
+        uint64_t now=steady_ns();
+        return now>cal.steady_ns ? now-cal.steady_ns : 0;
+    }
+};
+
+Calibrator& calibrator(){
+    static Calibrator c;
+    return c;
+}
+
+}// namespace
+
+uint64_t steady_ns(){
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+bool tsc_available(){
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool invariant=[]{
+        unsigned a=0, b=0, c=0, d=0;
+        return __get_cpuid(0x80000007, &a, &b, &c, &d) && (d & (1u<<8));
+    }();
+    return invariant;
+#else
+    return false;
+#endif
+}
+
+ClockCalibration current_calibration(bool force){
+    Calibrator& c=calibrator();
+    std::lock_guard<std::mutex> lock(c.mtx);
+    if(!c.ready) c.initialise();
+    else if(force || c.ns_since_anchor()>=kRecalibrationNs) c.recalibrate();
+    ClockCalibration out=c.cal;
+    out.sync_ticks=static_cast<uint64_t>(static_cast<double>(kSyncNs)/out.ns_per_tick);
+    return out;
+}
+
+uint64_t ThreadClock::sync(bool force){
+    cal=current_calibration(force);
+    uint64_t ticks=read_ticks(cal.use_tsc);
+    next_sync=ticks+cal.sync_ticks;
+    return ticks;
+}
+
+} // namespace MatchEngine::TimeUtils